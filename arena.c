@@ -0,0 +1,94 @@
+#include "arena.h"
+
+#include <string.h>
+
+#include "memory.h"
+
+// bump allocation from a list of chunks, everything is released together by free_arena
+
+
+ArenaChunk *_new_chunk(size_t capacity, ArenaChunk *next_chunk) {
+  ArenaChunk *chunk = memory_allocate(MemorySubsystemArena, sizeof(ArenaChunk) + capacity);
+
+  chunk->next_chunk = next_chunk;
+  chunk->capacity = capacity;
+  chunk->length = 0;
+
+  return chunk;
+}
+
+
+Arena *new_arena() {
+  Arena *arena = memory_allocate(MemorySubsystemArena, sizeof(Arena));
+
+  arena->chunk = _new_chunk(ARENA_CHUNK_SIZE, NULL);
+  arena->chunk_count = 1;
+  arena->allocated_bytes = 0;
+
+  return arena;
+}
+
+
+void *arena_allocate(Arena *arena, size_t size) {
+  size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+
+  if (arena->chunk->length + size > arena->chunk->capacity) {
+    // a big allocation gets a chunk of its own behind the current one, so the free space of the current one is kept
+    if (size > ARENA_CHUNK_SIZE / 4) {
+      arena->chunk->next_chunk = _new_chunk(size, arena->chunk->next_chunk);
+      arena->chunk_count++;
+      arena->allocated_bytes += size;
+
+      arena->chunk->next_chunk->length = size;
+
+      return arena->chunk->next_chunk->data;
+    }
+
+    arena->chunk = _new_chunk(ARENA_CHUNK_SIZE, arena->chunk);
+    arena->chunk_count++;
+  }
+
+  void *pointer = (char *) arena->chunk->data + arena->chunk->length;
+
+  arena->chunk->length += size;
+  arena->allocated_bytes += size;
+
+  return pointer;
+}
+
+
+// for arrays that are appended one item at a time, the capacity is the count rounded up to a power of two
+void *arena_grow_array(Arena *arena, void *items, size_t item_count, size_t item_size) {
+  if (item_count != 0 && (item_count & (item_count - 1)) != 0) return items;
+
+  void *grown_items = arena_allocate(arena, (item_count == 0 ? 1 : item_count * 2) * item_size);
+
+  if (item_count != 0) memcpy(grown_items, items, item_count * item_size);
+
+  return grown_items;
+}
+
+
+char *arena_copy_buffer(Arena *arena, const char *buffer, size_t buffer_length) {
+  char *string = arena_allocate(arena, buffer_length + 1);
+
+  memcpy(string, buffer, buffer_length);
+  string[buffer_length] = 0;
+
+  return string;
+}
+
+
+void free_arena(Arena *arena) {
+  ArenaChunk *chunk = arena->chunk;
+
+  while (chunk != NULL) {
+    ArenaChunk *next_chunk = chunk->next_chunk;
+
+    memory_free(chunk);
+
+    chunk = next_chunk;
+  }
+
+  memory_free(arena);
+}
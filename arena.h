@@ -0,0 +1,41 @@
+#ifndef PIELANG_ARENA_H
+#define PIELANG_ARENA_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaChunk {
+  struct ArenaChunk *next_chunk;
+  size_t capacity;
+  size_t length;
+  // long double gives the data the strictest alignment of the scalar types
+  long double data[];
+} ArenaChunk;
+
+typedef struct {
+  ArenaChunk *chunk;
+  size_t chunk_count;
+  size_t allocated_bytes;
+} Arena;
+
+
+Arena *new_arena();
+
+
+void *arena_allocate(Arena *arena, size_t size);
+
+
+void *arena_grow_array(Arena *arena, void *items, size_t item_count, size_t item_size);
+
+
+char *arena_copy_buffer(Arena *arena, const char *buffer, size_t buffer_length);
+
+
+void free_arena(Arena *arena);
+
+
+#endif //PIELANG_ARENA_H
@@ -1,16 +1,16 @@
 #include "ast.h"
 
 #include <string.h>
+#include <stdint.h>
 #include <signal.h>
 
 #include "bool.h"
 #include "lexer.h"
 #include "utils.h"
+#include "memory.h"
 
-#define MAX_BUFFER_SIZE 10000
 
-
-void printf_token(Token token) {
+void printf_token(Lexer *lexer, Token token) {
   switch (token.token_type) {
     case NULL_TOKEN: {
       printf(" null ");
@@ -18,32 +18,17 @@ void printf_token(Token token) {
       break;
     }
 
-    case IDENTIFIER_TOKEN: {
-      printf(" %s ", ((StringLiteral *)token.literal)->string_literal);
-
-      break;
-    }
-
-    case INTEGER_TOKEN: {
-      printf(" %lld ", ((IntegerLiteral *)token.literal)->integer_literal);
-
-      break;
-    }
-
-    case FLOAT_TOKEN: {
-      printf(" %Lf ", ((FloatLiteral *)token.literal)->float_literal);
-
-      break;
-    }
-
+    case IDENTIFIER_TOKEN:
+    case INTEGER_TOKEN:
+    case FLOAT_TOKEN:
     case BOOL_TOKEN: {
-      printf(" %s ", ((BoolLiteral *)token.literal)->bool_literal ? "true" : "false");
+      printf(" %.*s ", (int) token.length, get_token_text(lexer, token));
 
       break;
     }
 
     case STRING_LITERAL_TOKEN: {
-      printf(" \"%s\" ", ((StringLiteral *)token.literal)->string_literal);
+      printf(" \"%.*s\" ", (int) token.length, get_token_text(lexer, token));
 
       break;
     }
@@ -60,6 +45,41 @@ void printf_alignment(unsigned int alignment) {
 }
 
 
+void printf_infix_operator(Operator operator) {
+  if (operator == ADDITION_OP) { printf(" + "); }
+  else if (operator == SUBTRACTION_OP) { printf(" - "); }
+  else if (operator == MULTIPLICATION_OP) { printf(" * "); }
+  else if (operator == DIVISION_OP) { printf(" / "); }
+  else if (operator == MOD_OP) { printf(" %% "); }
+  else if (operator == EXPONENT_OP) { printf(" ^ "); }
+  else if (operator == ASSIGN_OP) { printf(" = "); }
+  else if (operator == ASSIGN_ADDITION_OP) { printf(" += "); }
+  else if (operator == ASSIGN_SUBTRACTION_OP) { printf(" -= "); }
+  else if (operator == ASSIGN_MULTIPLICATION_OP) { printf(" *= "); }
+  else if (operator == ASSIGN_DIVISION_OP) { printf(" /= "); }
+  else if (operator == ASSIGN_MOD_OP) { printf(" %%= "); }
+  else if (operator == ASSIGN_EXPONENT_OP) { printf(" ^= "); }
+  else if (operator == CHECK_EQUALITY_OP) { printf(" == "); }
+  else if (operator == CHECK_NOT_EQUALITY_OP) { printf(" != "); }
+  else if (operator == CHECK_SMALLER_OP) { printf(" < "); }
+  else if (operator == CHECK_SMALLER_EQUAL_OP) { printf(" <= "); }
+  else if (operator == CHECK_BIGGER_OP) { printf(" > "); }
+  else if (operator == CHECK_BIGGER_EQUAL_OP) { printf(" >= "); }
+  else if (operator == MEMBER_OP) { printf(" . "); }
+  else if (operator == IN_OP) { printf(" in "); }
+  else if (operator == COMMA_OP) { printf(" , "); }
+}
+
+
+void printf_prefix_operator(Operator operator) {
+  if (operator == NOT_OP) { printf("!"); }
+  else if (operator == ADDITION_OP) { printf("+"); }
+  else if (operator == SUBTRACTION_OP) { printf("-"); }
+  else if (operator == ASYNC_OP) { printf(" async "); }
+  else if (operator == AWAIT_OP) { printf(" await "); }
+}
+
+
 void printf_expression(Expression *expression, unsigned int alignment) {
   switch (expression->expression_type) {
     case ExpressionTypeInfixExpression: {
@@ -68,28 +88,7 @@ void printf_expression(Expression *expression, unsigned int alignment) {
       printf(" (");
       printf_expression(infix_expression->left_expression, alignment);
 
-      if (infix_expression->operator == ADDITION_OP) { printf(" + "); }
-      else if (infix_expression->operator == SUBTRACTION_OP) { printf(" - "); }
-      else if (infix_expression->operator == MULTIPLICATION_OP) { printf(" * "); }
-      else if (infix_expression->operator == DIVISION_OP) { printf(" / "); }
-      else if (infix_expression->operator == MOD_OP) { printf(" %% "); }
-      else if (infix_expression->operator == EXPONENT_OP) { printf(" ^ "); }
-      else if (infix_expression->operator == ASSIGN_OP) { printf(" = "); }
-      else if (infix_expression->operator == ASSIGN_ADDITION_OP) { printf(" += "); }
-      else if (infix_expression->operator == ASSIGN_SUBTRACTION_OP) { printf(" -= "); }
-      else if (infix_expression->operator == ASSIGN_MULTIPLICATION_OP) { printf(" *= "); }
-      else if (infix_expression->operator == ASSIGN_DIVISION_OP) { printf(" /= "); }
-      else if (infix_expression->operator == ASSIGN_MOD_OP) { printf(" %%= "); }
-      else if (infix_expression->operator == ASSIGN_EXPONENT_OP) { printf(" ^= "); }
-      else if (infix_expression->operator == CHECK_EQUALITY_OP) { printf(" == "); }
-      else if (infix_expression->operator == CHECK_NOT_EQUALITY_OP) { printf(" != "); }
-      else if (infix_expression->operator == CHECK_SMALLER_OP) { printf(" < "); }
-      else if (infix_expression->operator == CHECK_SMALLER_EQUAL_OP) { printf(" <= "); }
-      else if (infix_expression->operator == CHECK_BIGGER_OP) { printf(" > "); }
-      else if (infix_expression->operator == CHECK_BIGGER_EQUAL_OP) { printf(" >= "); }
-      else if (infix_expression->operator == MEMBER_OP) { printf(" . "); }
-      else if (infix_expression->operator == IN_OP) { printf(" in "); }
-      else if (infix_expression->operator == COMMA_OP) { printf(" , "); }
+      printf_infix_operator(infix_expression->operator);
 
       printf_expression(infix_expression->right_expression, alignment);
       printf(") ");
@@ -102,11 +101,7 @@ void printf_expression(Expression *expression, unsigned int alignment) {
 
       printf(" (");
 
-      if (prefix_expression->operator == NOT_OP) { printf("!"); }
-      else if (prefix_expression->operator == ADDITION_OP) { printf("+"); }
-      else if (prefix_expression->operator == SUBTRACTION_OP) { printf("-"); }
-      else if (prefix_expression->operator == ASYNC_OP) { printf(" async "); }
-      else if (prefix_expression->operator == AWAIT_OP) { printf(" await "); }
+      printf_prefix_operator(prefix_expression->operator);
 
       printf_expression(prefix_expression->right_expression, alignment);
       printf(") ");
@@ -180,7 +175,9 @@ void printf_expression(Expression *expression, unsigned int alignment) {
       }
       printf(")");
       printf("\n");
-      printf_block(function_expression->block, alignment);
+
+      if (function_expression->block != NULL) printf_block(function_expression->block, alignment);
+      else printf("{ ... }\n");
 
       break;
     }
@@ -365,199 +362,114 @@ void printf_ast(AST *ast) {
 }
 
 
-void free_expression(Expression *expression) {
-  switch (expression->expression_type) {
-    case ExpressionTypeNullExpression: {
-      break;
-    }
-
-    case ExpressionTypeIndexExpression: {
-      IndexExpression *index_expression = (IndexExpression *) expression;
-
-      free_expression(index_expression->left_expression);
-      free_expression(index_expression->right_expression);
-      free(index_expression);
-
-      break;
-    }
-
-    case ExpressionTypeInfixExpression: {
-      InfixExpression *infix_expression = (InfixExpression *)expression;
-
-      free_expression(infix_expression->left_expression);
-      free_expression(infix_expression->right_expression);
-      free(infix_expression);
+Block *new_block(Arena *arena) {
+  Block *block = arena_allocate(arena, sizeof(Block));
 
-      break;
-    }
-
-    case ExpressionTypePrefixExpression: {
-      PrefixExpression *prefix_expression = (PrefixExpression *)expression;
-
-      free_expression(prefix_expression->right_expression);
-      free(prefix_expression);
-
-      break;
-    }
-
-    case ExpressionTypeCallExpression: {
-      CallExpression *call_expression = (CallExpression *)expression;
-
-      free_expression(call_expression->identifier_expression);
-      free_expression(call_expression->tuple_expression);
-      free(call_expression);
-
-      break;
-    }
-
-    case ExpressionTypeArrayExpression: {
-      ArrayExpression *array_expression = (ArrayExpression *)expression;
+  block->statement_count = 0;
+  block->statements = NULL;
+  block->slot_count = 0;
+  block->slot_names = NULL;
+  block->slot_index = NULL;
+  block->slot_index_capacity = 0;
+  block->has_duplicate_slots = false;
+  block->arena = arena;
 
-      for (size_t i = 0; i < array_expression->expression_count; i++) {
-        free_expression(array_expression->expressions[i]);
-      }
+  return block;
+}
 
-      free(array_expression->expressions);
-      free(array_expression);
 
-      break;
-    }
+// symbols are unique, so the index hashes the pointer instead of the chars
+size_t _get_slot_index_position(Block *block, char *name) {
+  return (size_t) (((uintptr_t) name >> 4) * 11400714819323198485ull) & (block->slot_index_capacity - 1);
+}
 
-    case ExpressionTypeFunctionExpression: {
-      FunctionExpression *function_expression = (FunctionExpression *)expression;
 
-      for (size_t i = 0; i < function_expression->argument_count; i++) {
-        free(function_expression->arguments[i]);
-      }
-      free(function_expression->arguments);
+// the later slot of a name replaces the earlier one, so the index always gives the last slot
+void _index_slot(Block *block, size_t slot) {
+  size_t position = _get_slot_index_position(block, block->slot_names[slot]);
 
-      if (function_expression->identifier) free_expression(function_expression->identifier);
-      free_block(function_expression->block);
-      free(function_expression);
+  while (block->slot_index[position] != 0 && block->slot_names[block->slot_index[position] - 1] != block->slot_names[slot]) {
+    position = (position + 1) & (block->slot_index_capacity - 1);
+  }
 
-      break;
-    }
+  block->slot_index[position] = slot + 1;
+}
 
-    case ExpressionTypeBoolExpression:
-    case ExpressionTypeIntegerExpression:
-    case ExpressionTypeFloatExpression: {
-      free(expression->literal);
-      free(expression);
-      break;
-    }
 
-    case ExpressionTypeStringExpression:
-    case ExpressionTypeIdentifierExpression: {
-      free(((StringLiteral *) expression->literal)->string_literal);
-      free(expression->literal);
-      free(expression);
-      break;
-    }
-  }
-}
+// the index is kept at most half full, the old one stays in the arena like a grown array
+void _grow_slot_index(Block *block) {
+  block->slot_index_capacity = block->slot_index_capacity == 0 ? BLOCK_SLOT_INDEX_MIN_COUNT * 4 : block->slot_index_capacity * 2;
+  block->slot_index = arena_allocate(block->arena, block->slot_index_capacity * sizeof(size_t));
 
+  memset(block->slot_index, 0, block->slot_index_capacity * sizeof(size_t));
 
-void free_block(Block *block) {
-  for (size_t i = 0; i < block->statement_count; i++) {
-    free_statement(block->statements[i]);
+  for (size_t i = 0; i < block->slot_count; i++) {
+    _index_slot(block, i);
   }
-  free(block->statements);
-  free(block);
 }
 
 
-void free_block_definition(BlockDefinition *block_definition) {
-  switch (block_definition->block_definition_type) {
-    case BlockDefinitionTypeIfElseGroupBlock: {
-      IfElseGroupBlockDefinition *if_else_group_block_definition = (IfElseGroupBlockDefinition *)block_definition;
-
-      for (size_t i = 0; i < if_else_group_block_definition->if_block_definitions_length; i++) {
-        free_block_definition((BlockDefinition *) if_else_group_block_definition->if_block_definitions[i]);
-      }
-      free(if_else_group_block_definition->if_block_definitions);
+// the name is a symbol, so it is not copied
+size_t block_add_slot(Block *block, char *name) {
+  if (block_get_slot(block, name) != UNRESOLVED_SLOT) block->has_duplicate_slots = true;
 
-      if (if_else_group_block_definition->else_block_definition) free_block_definition((BlockDefinition *) if_else_group_block_definition->else_block_definition);
-      free(if_else_group_block_definition);
+  block->slot_names = arena_grow_array(block->arena, block->slot_names, block->slot_count, sizeof(char *));
+  block->slot_names[block->slot_count] = name;
 
-      break;
-    }
+  size_t slot = block->slot_count++;
 
-    case BlockDefinitionTypeIfBlock: {
-      IfBlockDefinition *if_block_definition = (IfBlockDefinition *)block_definition;
-
-      free_expression(if_block_definition->condition);
-      if (if_block_definition->pre_expression != NULL) free_expression(if_block_definition->pre_expression);
-      free_block(if_block_definition->block);
-      free(if_block_definition);
+  if (block->slot_count > BLOCK_SLOT_INDEX_MIN_COUNT) {
+    if (block->slot_count * 2 > block->slot_index_capacity) _grow_slot_index(block);
+    else _index_slot(block, slot);
+  }
 
-      break;
-    }
+  return slot;
+}
 
-    case BlockDefinitionTypeElseBlock: {
-      break;
-    }
 
-    case BlockDefinitionTypeForBlock: {
-      ForBlockDefinition *for_block_definition = (ForBlockDefinition *)block_definition;
+// the last slot wins when a name is declared twice, the same way a later hash table set replaces the earlier one
+// the name is a symbol, so it is compared by pointer
+size_t block_get_slot(Block *block, char *name) {
+  return block_get_slot_before(block, name, block->slot_count);
+}
 
-      free_expression(for_block_definition->condition);
-      if (for_block_definition->pre_expression != NULL) free_expression(for_block_definition->pre_expression);
-      if (for_block_definition->post_expression != NULL) free_expression(for_block_definition->post_expression);
-      free_block(for_block_definition->block);
-      free(for_block_definition);
 
-      break;
-    }
+size_t _get_indexed_slot(Block *block, char *name) {
+  size_t position = _get_slot_index_position(block, name);
 
-    default : {
+  while (block->slot_index[position] != 0) {
+    if (block->slot_names[block->slot_index[position] - 1] == name) return block->slot_index[position] - 1;
 
-    }
+    position = (position + 1) & (block->slot_index_capacity - 1);
   }
-}
 
+  return UNRESOLVED_SLOT;
+}
 
-void free_statement(Statement *statement) {
-  switch (statement->statement_type) {
-    case StatementTypeExpressionStatement: {
-      ExpressionStatement *expression_statement = (ExpressionStatement *)statement;
-
-      free_expression(expression_statement->expression);
-      free(expression_statement);
-
-      break;
-    }
 
-    case StatementTypeImportStatement: {
-      ImportStatement *import_statement = (ImportStatement *)statement;
+// only the first slot_count slots are searched, the ones that were declared by then
+size_t block_get_slot_before(Block *block, char *name, size_t slot_count) {
+  if (block->slot_index != NULL) {
+    size_t slot = _get_indexed_slot(block, name);
 
-      free_expression(import_statement->right_expression);
-      free(import_statement);
-      break;
+    // an earlier slot of the same name can only exist when the block declares a name twice
+    if (slot == UNRESOLVED_SLOT || slot < slot_count || !block->has_duplicate_slots) {
+      return slot < slot_count ? slot : UNRESOLVED_SLOT;
     }
+  }
 
-    case StatementTypeReturnStatement: {
-      ReturnStatement *return_statement = (ReturnStatement *)statement;
-
-      free_expression(return_statement->right_expression);
-      free(return_statement);
-      break;
-    }
-
-    case StatementTypeBlockDefinitionStatement: {
-      BlockDefinitionStatement *block_definition_statement = (BlockDefinitionStatement *)statement;
-
-      free_block_definition(block_definition_statement->block_definition);
-      free(block_definition_statement);
-      break;
-    }
+  for (size_t i = slot_count; i > 0; i--) {
+    if (block->slot_names[i - 1] == name) return i - 1;
   }
+
+  return UNRESOLVED_SLOT;
 }
 
 
+// every node, block and literal of the ast is in its arena, so they are all released together
 void free_ast(AST *ast) {
-  // no need to free block, because scope automatically frees it, TODO move maybe again here
-  free_block(ast->block);
-  free(ast);
+  free_arena(ast->arena);
+  memory_free(ast);
 }
 
 
@@ -665,6 +577,76 @@ Operator token_to_operator(Token token) {
 }
 
 
+Operator get_compound_assign_operator(Operator operator) {
+  switch (operator) {
+    case ASSIGN_ADDITION_OP: return ADDITION_OP;
+    case ASSIGN_SUBTRACTION_OP: return SUBTRACTION_OP;
+    case ASSIGN_MULTIPLICATION_OP: return MULTIPLICATION_OP;
+    case ASSIGN_DIVISION_OP: return DIVISION_OP;
+    case ASSIGN_INTEGER_DIVISION_OP: return INTEGER_DIVISION_OP;
+    case ASSIGN_EXPONENT_OP: return EXPONENT_OP;
+    case ASSIGN_MOD_OP: return MOD_OP;
+    default: return operator;
+  }
+}
+
+
+// an expression without calls and assignments, evaluating it can not change a variable
+bool is_pure_expression(Expression *expression) {
+  if (expression == NULL) return true;
+
+  switch (expression->expression_type) {
+    case ExpressionTypeInfixExpression: {
+      InfixExpression *infix_expression = (InfixExpression *) expression;
+
+      if (infix_expression->operator == ASSIGN_OP || get_compound_assign_operator(infix_expression->operator) != infix_expression->operator) return false;
+      if (infix_expression->operator == MEMBER_OP) return is_pure_expression(infix_expression->left_expression);
+
+      return is_pure_expression(infix_expression->left_expression) && is_pure_expression(infix_expression->right_expression);
+    }
+
+    case ExpressionTypePrefixExpression: {
+      return is_pure_expression(((PrefixExpression *) expression)->right_expression);
+    }
+
+    case ExpressionTypeIndexExpression: {
+      IndexExpression *index_expression = (IndexExpression *) expression;
+
+      return is_pure_expression(index_expression->left_expression) && is_pure_expression(index_expression->right_expression);
+    }
+
+    case ExpressionTypeArrayExpression: {
+      ArrayExpression *array_expression = (ArrayExpression *) expression;
+
+      for (size_t i = 0; i < array_expression->expression_count; i++) {
+        if (!is_pure_expression(array_expression->expressions[i])) return false;
+      }
+
+      return true;
+    }
+
+    case ExpressionTypeCallExpression:
+    case ExpressionTypeFunctionExpression: {
+      return false;
+    }
+
+    default: {
+      return true;
+    }
+  }
+}
+
+
+// no argument from this one on is followed by one that could change a variable, the ones before it may be
+size_t get_pure_arguments_start(ArrayExpression *array_expression) {
+  for (size_t i = array_expression->expression_count; i > 0; i--) {
+    if (!is_pure_expression(array_expression->expressions[i - 1])) return i - 1;
+  }
+
+  return 0;
+}
+
+
 bool check_if_token_is_operator(Token token) {
   return token_to_operator(token) != -1;
 }
@@ -812,7 +794,7 @@ void *parser_error() {
 void *parser_error_undefined_position() { //Lexer *lexer
   printf("Undefined position of token ");
 
-  //printf_token(peek_token(lexer));
+  //printf_token(lexer, peek_token(lexer));
 
   // at line
 
@@ -820,12 +802,12 @@ void *parser_error_undefined_position() { //Lexer *lexer
 }
 
 
-Expression *eval_token(Token token) {
+Expression *eval_token(Arena *arena, Token token) {
   static Expression *null_expression = NULL;
 
   if (token.token_type == NULL_TOKEN) {
     if (null_expression == NULL) {
-      null_expression = malloc(sizeof(Expression));
+      null_expression = memory_allocate(MemorySubsystemAST, sizeof(Expression));
 
       null_expression->literal = NULL;
       null_expression->expression_type = ExpressionTypeNullExpression;
@@ -834,14 +816,20 @@ Expression *eval_token(Token token) {
     return null_expression;
   }
 
-  Expression *expression = malloc(sizeof(Expression));
+  if (token.token_type == IDENTIFIER_TOKEN) {
+    IdentifierExpression *identifier_expression = arena_allocate(arena, sizeof(IdentifierExpression));
+
+    identifier_expression->expression = (Expression) {.expression_type = ExpressionTypeIdentifierExpression, .literal = token.literal};
+    identifier_expression->depth = 0;
+    identifier_expression->slot = UNRESOLVED_SLOT;
+
+    return (Expression *) identifier_expression;
+  }
+
+  Expression *expression = arena_allocate(arena, sizeof(Expression));
   expression->literal = token.literal;
 
   switch (token.token_type) {
-    case IDENTIFIER_TOKEN: {
-      expression->expression_type = ExpressionTypeIdentifierExpression;
-      break;
-    }
 
     case INTEGER_TOKEN: {
       expression->expression_type = ExpressionTypeIntegerExpression;
@@ -872,50 +860,49 @@ Expression *eval_token(Token token) {
 }
 
 
-Expression *force_array_expression(Expression *expression, ArrayExpressionType array_expression_type) {
-  if (expression == NULL) {
-    ArrayExpression *array_expression = malloc(sizeof(ArrayExpression));
+ArrayExpression *new_array_expression(Arena *arena, ArrayExpressionType array_expression_type) {
+  ArrayExpression *array_expression = arena_allocate(arena, sizeof(ArrayExpression));
 
-    array_expression->expression = (Expression){.expression_type = ExpressionTypeArrayExpression};
-    array_expression->expression_count = 0;
-    array_expression->expressions = malloc(0);
-    array_expression->array_expression_type = array_expression_type;
-    array_expression->has_finished = false;
+  array_expression->expression = (Expression){.expression_type = ExpressionTypeArrayExpression};
+  array_expression->expression_count = 0;
+  array_expression->expressions = NULL;
+  array_expression->array_expression_type = array_expression_type;
+  array_expression->has_finished = false;
 
-    return (Expression *) array_expression;
-  }
-  else if (expression->expression_type == ExpressionTypeArrayExpression) {
-    if (!((ArrayExpression *) expression)->has_finished) {
-      ((ArrayExpression *) expression)->array_expression_type = array_expression_type;
+  return array_expression;
+}
 
-      return expression;
-    }
 
-    ArrayExpression *array_expression = malloc(sizeof(ArrayExpression));
+void array_expression_add_expression(Arena *arena, ArrayExpression *array_expression, Expression *expression) {
+  array_expression->expressions = arena_grow_array(arena, array_expression->expressions, array_expression->expression_count, sizeof(Expression *));
+  array_expression->expressions[array_expression->expression_count++] = expression;
+}
 
-    array_expression->expression = (Expression){.expression_type = ExpressionTypeArrayExpression};
-    array_expression->expression_count = 1;
-    array_expression->expressions = malloc(sizeof(Expression *));
-    array_expression->array_expression_type = array_expression_type;
-    array_expression->has_finished = false;
 
-    array_expression->expressions[0] = expression;
+Expression *parse_token_expression(Lexer *lexer) {
+  Token token = next_token(lexer);
 
-    return (Expression *) array_expression;
-  }
-  else  {
-    ArrayExpression *array_expression = malloc(sizeof(ArrayExpression));
+  token.literal = get_token_literal(lexer, token);
 
-    array_expression->expression = (Expression){.expression_type = ExpressionTypeArrayExpression};
-    array_expression->expression_count = 1;
-    array_expression->expressions = malloc(sizeof(Expression *));
-    array_expression->array_expression_type = array_expression_type;
-    array_expression->has_finished = false;
+  return eval_token(lexer->arena, token);
+}
 
-    array_expression->expressions[0] = expression;
 
-    return (Expression *) array_expression;
+Expression *force_array_expression(Arena *arena, Expression *expression, ArrayExpressionType array_expression_type) {
+  if (expression == NULL) {
+    return (Expression *) new_array_expression(arena, array_expression_type);
   }
+  else if (expression->expression_type == ExpressionTypeArrayExpression && !((ArrayExpression *) expression)->has_finished) {
+    ((ArrayExpression *) expression)->array_expression_type = array_expression_type;
+
+    return expression;
+  }
+
+  ArrayExpression *array_expression = new_array_expression(arena, array_expression_type);
+
+  array_expression_add_expression(arena, array_expression, expression);
+
+  return (Expression *) array_expression;
 }
 
 
@@ -942,7 +929,7 @@ Expression *parse_list_expression(Lexer *lexer) {
   if (peek_token(lexer).token_type != L_BRACKET_TOKEN) return parser_error_undefined_position();
   next_token(lexer);
 
-  Expression *result = force_array_expression(parse_expression(lexer, 0, ARRAY_EXPRESSION_PARSER_LIMITER), ArrayExpressionTypeList);
+  Expression *result = force_array_expression(lexer->arena, parse_expression(lexer, 0, ARRAY_EXPRESSION_PARSER_LIMITER), ArrayExpressionTypeList);
 
   ArrayExpression *array_expression = (ArrayExpression *)result;
   array_expression->array_expression_type = ArrayExpressionTypeList;
@@ -967,7 +954,7 @@ Expression *parse_prefix_expression(Lexer *lexer, ParserLimiter limiter) {
 
   next_token(lexer);
 
-  PrefixExpression *prefix_expression = malloc(sizeof(PrefixExpression));
+  PrefixExpression *prefix_expression = arena_allocate(lexer->arena, sizeof(PrefixExpression));
 
   prefix_expression->expression = (Expression){.expression_type = ExpressionTypePrefixExpression};
   prefix_expression->operator = token_to_operator(curr_token);
@@ -984,27 +971,16 @@ Expression *parse_array_expression(Lexer *lexer, Expression *left) {
     array_expression = (ArrayExpression *)left;
   }
   else {
-    array_expression = malloc(sizeof(ArrayExpression));
-
-    array_expression->expression = (Expression){.expression_type = ExpressionTypeArrayExpression};
-    array_expression->expression_count = 1;
-    array_expression->expressions = malloc(array_expression->expression_count * sizeof(Expression *));
-    array_expression->array_expression_type = ArrayExpressionTypeTuple;
-    array_expression->has_finished = false;
-
-    array_expression->expressions[0] = left;
+    array_expression = new_array_expression(lexer->arena, ArrayExpressionTypeTuple);
 
+    array_expression_add_expression(lexer->arena, array_expression, left);
   }
 
   if (has_finished(peek_token(lexer), ARRAY_EXPRESSION_PARSER_LIMITER)) return (Expression *) array_expression;
 
   Expression *right = parse_expression(lexer, COMMA_PRECEDENCE, ARRAY_EXPRESSION_PARSER_LIMITER);
 
-  if (right != NULL) {
-    array_expression->expressions = realloc(array_expression->expressions, sizeof(Expression *) * (++array_expression->expression_count));
-
-    array_expression->expressions[array_expression->expression_count - 1] = right;
-  }
+  if (right != NULL) array_expression_add_expression(lexer->arena, array_expression, right);
 
   return (Expression *)array_expression;
 }
@@ -1019,7 +995,7 @@ Expression *parse_index_expression(Lexer *lexer, Expression *identifier) {
   if (peek_token(lexer).token_type != R_BRACKET_TOKEN) return parser_error_undefined_position();
   next_token(lexer);
 
-  IndexExpression *index_expression = malloc(sizeof(IndexExpression));
+  IndexExpression *index_expression = arena_allocate(lexer->arena, sizeof(IndexExpression));
 
   index_expression->expression = (Expression) {.expression_type = ExpressionTypeIndexExpression};
   index_expression->left_expression = identifier;
@@ -1033,11 +1009,11 @@ Expression *parse_call_expression(Lexer *lexer, Expression *identifier) {
   if (peek_token(lexer).token_type != L_PARENTHESIS_TOKEN) return parser_error_undefined_position();
   next_token(lexer);
 
-  CallExpression *call_expression = malloc(sizeof(CallExpression));
+  CallExpression *call_expression = arena_allocate(lexer->arena, sizeof(CallExpression));
   call_expression->expression = (Expression){.expression_type = ExpressionTypeCallExpression};
   call_expression->identifier_expression = identifier;
   call_expression->tuple_expression = force_array_expression(
-    parse_expression(lexer, 0, GROUPED_EXPRESSION_PARSER_LIMITER), ArrayExpressionTypeTuple);
+    lexer->arena, parse_expression(lexer, 0, GROUPED_EXPRESSION_PARSER_LIMITER), ArrayExpressionTypeTuple);
 
   if (peek_token(lexer).token_type != R_PARENTHESIS_TOKEN) return parser_error_undefined_position();
   next_token(lexer);
@@ -1063,7 +1039,7 @@ Expression *parse_infix_expression(Lexer *lexer, ParserLimiter limiter, Expressi
 
   next_token(lexer);
 
-  InfixExpression *infix_expression = malloc(sizeof(InfixExpression));
+  InfixExpression *infix_expression = arena_allocate(lexer->arena, sizeof(InfixExpression));
   infix_expression->expression = (Expression){.expression_type = ExpressionTypeInfixExpression};
   infix_expression->left_expression = left;
   infix_expression->operator = token_to_operator(curr_token);
@@ -1078,43 +1054,90 @@ Expression *parse_function_expression(Lexer *lexer) {
 
   Expression *identifier = NULL;
 
-  if (peek_token(lexer).token_type != L_PARENTHESIS_TOKEN) identifier = eval_token(next_token(lexer));
+  if (peek_token(lexer).token_type != L_PARENTHESIS_TOKEN) identifier = parse_token_expression(lexer);
 
   if (peek_token(lexer).token_type != L_PARENTHESIS_TOKEN) return parser_error_undefined_position();
   next_token(lexer);
 
-  ArrayExpression *arguments_expression = (ArrayExpression *) force_array_expression(parse_expression(lexer, 0, GROUPED_EXPRESSION_PARSER_LIMITER), ArrayExpressionTypeTuple);
+  ArrayExpression *arguments_expression = (ArrayExpression *) force_array_expression(lexer->arena, parse_expression(lexer, 0, GROUPED_EXPRESSION_PARSER_LIMITER), ArrayExpressionTypeTuple);
 
   if (peek_token(lexer).token_type != R_PARENTHESIS_TOKEN) return parser_error_undefined_position();
   next_token(lexer);
 
   if (peek_token(lexer).token_type != L_BRACE_TOKEN) return parser_error_undefined_position();
-  next_token(lexer);
 
-  Block *block = parse_block(lexer, DEFAULT_BLOCK_PARSER_LIMITER);
+  Block *block = NULL;
+  char *body = NULL;
+  size_t body_length = 0;
 
-  if (peek_token(lexer).token_type != R_BRACE_TOKEN) return parser_error_undefined_position();
-  next_token(lexer);
+  // a deferred body is only brace matched, its source is parsed on the first call
+  if (lexer->should_defer_function_bodies) {
+    next_token(lexer);
+
+    // punctuation tokens have no offset, the positions the lexer starts each token from bound the body instead
+    size_t body_offset = lexer->next_token_position;
+    size_t body_end = body_offset;
+    size_t depth = 1;
+    Token token;
 
-  char **arguments = malloc(arguments_expression->expression_count * sizeof(char *));
+    while (depth > 0) {
+      body_end = lexer->next_token_position;
+      token = next_token(lexer);
+
+      if (token.token_type == L_BRACE_TOKEN) depth++;
+      else if (token.token_type == R_BRACE_TOKEN) depth--;
+      else if (token.token_type == EOF_TOKEN) return parser_error_undefined_position();
+    }
+
+    body = lexer->content + (body_offset - lexer->content_offset);
+    body_length = body_end - body_offset;
+  }
+  else {
+    next_token(lexer);
+
+    block = parse_block(lexer, DEFAULT_BLOCK_PARSER_LIMITER);
+
+    if (peek_token(lexer).token_type != R_BRACE_TOKEN) return parser_error_undefined_position();
+    next_token(lexer);
+  }
+
+  char **arguments = arena_allocate(lexer->arena, arguments_expression->expression_count * sizeof(char *));
 
   for (size_t i = 0; i < arguments_expression->expression_count; i++) {
-    arguments[i] = copy_string(((StringLiteral *) arguments_expression->expressions[i]->literal)->string_literal);
+    arguments[i] = ((StringLiteral *) arguments_expression->expressions[i]->literal)->string_literal;
   }
 
-  FunctionExpression *function_expression = (FunctionExpression *)malloc(sizeof(FunctionExpression));
+  FunctionExpression *function_expression = arena_allocate(lexer->arena, sizeof(FunctionExpression));
   function_expression->expression = (Expression){.expression_type = ExpressionTypeFunctionExpression};
   function_expression->block = block;
   function_expression->identifier = identifier;
   function_expression->arguments = arguments;
   function_expression->argument_count = arguments_expression->expression_count;
-
-  free_expression((Expression *) arguments_expression);
+  function_expression->body = body;
+  function_expression->body_length = body_length;
+  function_expression->global_slot_count = 0;
+  function_expression->should_optimize = false;
+  function_expression->arena = lexer->arena;
 
   return (Expression *)function_expression;
 }
 
 
+// the functions inside a lazy body are deferred again
+Block *parse_function_body(FunctionExpression *function_expression) {
+  Lexer *lexer = new_lexer(function_expression->body, function_expression->body_length, function_expression->arena);
+
+  lexer->should_defer_function_bodies = true;
+
+  function_expression->block = parse_block(lexer, DEFAULT_BLOCK_PARSER_LIMITER);
+  function_expression->body = NULL;
+
+  free_lexer(lexer);
+
+  return function_expression->block;
+}
+
+
 Expression *parse_expression(Lexer *lexer, unsigned short precedence, ParserLimiter limiter) {
   Token curr_token = peek_token(lexer);
 
@@ -1125,7 +1148,7 @@ Expression *parse_expression(Lexer *lexer, unsigned short precedence, ParserLimi
   Expression *left;
 
   if (check_if_token_is_operator(curr_token)) left = parse_prefix_expression(lexer, limiter);
-  else left = eval_token(next_token(lexer));
+  else left = parse_token_expression(lexer);
 
   curr_token = peek_token(lexer);
   if (has_finished(curr_token, limiter)) return left;
@@ -1149,42 +1172,19 @@ Expression *parse_expression(Lexer *lexer, unsigned short precedence, ParserLimi
 
 
 Block *parse_block(Lexer *lexer, ParserLimiter limiter) {
-  Statement *items_buffer[MAX_BUFFER_SIZE];
-  size_t items_buffer_length = 0;
-
-  Block *block = malloc(sizeof(Block));
-
-  block->statement_count = 0;
-  block->statements = malloc(block->statement_count * sizeof(Statement *));
+  Block *block = new_block(lexer->arena);
 
   while (true) {
     while (peek_token(lexer).token_type == EOL_TOKEN) { next_token(lexer); }
 
     if (has_finished(peek_token(lexer), limiter)) { break; }
 
-    if (items_buffer_length == MAX_BUFFER_SIZE) {
-      block->statements = realloc(block->statements, block->statement_count * sizeof(Statement *));
-
-      memcpy(&block->statements[block->statement_count - items_buffer_length], items_buffer, items_buffer_length * sizeof(Statement *));
-
-      items_buffer_length = 0;
-    }
-
     Statement *statement = parse_statement(lexer);
 
     if (statement == NULL) continue;
 
-    items_buffer[items_buffer_length++] = statement;
-    block->statement_count++;
-  }
-
-  block->statements = realloc(block->statements, block->statement_count * sizeof(Statement *));
-
-  if (block->statement_count > MAX_BUFFER_SIZE) {
-    memcpy(&block->statements[block->statement_count - items_buffer_length], items_buffer, items_buffer_length * sizeof(Statement *));
-  }
-  else if (block->statement_count < MAX_BUFFER_SIZE) {
-    memcpy(block->statements, items_buffer, items_buffer_length * sizeof(Statement *));
+    block->statements = arena_grow_array(lexer->arena, block->statements, block->statement_count, sizeof(Statement *));
+    block->statements[block->statement_count++] = statement;
   }
 
   return block;
@@ -1192,12 +1192,12 @@ Block *parse_block(Lexer *lexer, ParserLimiter limiter) {
 
 
 BlockDefinition *parse_if_block_definition(Lexer *lexer, ParserLimiter limiter) {
-  IfElseGroupBlockDefinition *if_else_group_block_definition = malloc(sizeof(IfElseGroupBlockDefinition));
+  IfElseGroupBlockDefinition *if_else_group_block_definition = arena_allocate(lexer->arena, sizeof(IfElseGroupBlockDefinition));
 
   if_else_group_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeIfElseGroupBlock};
   if_else_group_block_definition->else_block_definition = NULL;
   if_else_group_block_definition->if_block_definitions_length = 0;
-  if_else_group_block_definition->if_block_definitions = malloc(0);
+  if_else_group_block_definition->if_block_definitions = NULL;
 
   while (peek_token(lexer).token_type == IF_TOKEN) {
     next_token(lexer);
@@ -1221,7 +1221,7 @@ BlockDefinition *parse_if_block_definition(Lexer *lexer, ParserLimiter limiter)
     if (peek_token(lexer).token_type != R_BRACE_TOKEN) return parser_error_undefined_position();
     next_token(lexer);
 
-    IfBlockDefinition *if_block_definition = malloc(sizeof(IfBlockDefinition));
+    IfBlockDefinition *if_block_definition = arena_allocate(lexer->arena, sizeof(IfBlockDefinition));
     if_block_definition->block_definition = (BlockDefinition){.block_definition_type = BlockDefinitionTypeIfBlock};
     if_block_definition->block = block;
 
@@ -1234,7 +1234,7 @@ BlockDefinition *parse_if_block_definition(Lexer *lexer, ParserLimiter limiter)
       if_block_definition->condition = expression2;
     }
 
-    if_else_group_block_definition->if_block_definitions = realloc(if_else_group_block_definition->if_block_definitions, (if_else_group_block_definition->if_block_definitions_length + 1) * sizeof(IfBlockDefinition *));
+    if_else_group_block_definition->if_block_definitions = arena_grow_array(lexer->arena, if_else_group_block_definition->if_block_definitions, if_else_group_block_definition->if_block_definitions_length, sizeof(IfBlockDefinition *));
     if_else_group_block_definition->if_block_definitions[if_else_group_block_definition->if_block_definitions_length++] = if_block_definition;
   }
 
@@ -1249,7 +1249,7 @@ BlockDefinition *parse_if_block_definition(Lexer *lexer, ParserLimiter limiter)
     if (peek_token(lexer).token_type != R_BRACE_TOKEN) return parser_error_undefined_position();
     next_token(lexer);
 
-    ElseBlockDefinition *else_block_definition = malloc(sizeof(ElseBlockDefinition));
+    ElseBlockDefinition *else_block_definition = arena_allocate(lexer->arena, sizeof(ElseBlockDefinition));
 
     else_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeElseBlock};
     else_block_definition->block = block;
@@ -1292,7 +1292,7 @@ BlockDefinition *parse_for_block_definition(Lexer *lexer, ParserLimiter limiter)
 
   next_token(lexer);
 
-  ForBlockDefinition *for_block_definition = malloc(sizeof(ForBlockDefinition));
+  ForBlockDefinition *for_block_definition = arena_allocate(lexer->arena, sizeof(ForBlockDefinition));
   for_block_definition->block_definition = (BlockDefinition){.block_definition_type = BlockDefinitionTypeForBlock};
   for_block_definition->block = block;
 
@@ -1331,7 +1331,7 @@ BlockDefinition *parse_block_definition(Lexer *lexer, ParserLimiter limiter) {
 
 
 Statement *parse_block_definition_statement(Lexer *lexer, ParserLimiter limiter) {
-  BlockDefinitionStatement *block_definition_statement = malloc(sizeof(BlockDefinitionStatement));
+  BlockDefinitionStatement *block_definition_statement = arena_allocate(lexer->arena, sizeof(BlockDefinitionStatement));
 
   block_definition_statement->statement = (Statement){.statement_type = StatementTypeBlockDefinitionStatement};
   block_definition_statement->block_definition = parse_block_definition(lexer, limiter);
@@ -1343,7 +1343,7 @@ Statement *parse_block_definition_statement(Lexer *lexer, ParserLimiter limiter)
 Statement *parse_return_statement(Lexer *lexer, ParserLimiter limiter) {
   next_token(lexer);
 
-  ReturnStatement *return_statement = malloc(sizeof(ReturnStatement));
+  ReturnStatement *return_statement = arena_allocate(lexer->arena, sizeof(ReturnStatement));
   return_statement->statement = (Statement){.statement_type = StatementTypeReturnStatement};
   return_statement->right_expression = parse_expression(lexer, 0, limiter);
 
@@ -1354,7 +1354,7 @@ Statement *parse_return_statement(Lexer *lexer, ParserLimiter limiter) {
 Statement *parse_import_statement(Lexer *lexer, ParserLimiter limiter) {
   next_token(lexer);
 
-  ImportStatement *import_statement = malloc(sizeof(ImportStatement));
+  ImportStatement *import_statement = arena_allocate(lexer->arena, sizeof(ImportStatement));
   import_statement->statement = (Statement){.statement_type = StatementTypeImportStatement};
   import_statement->right_expression = parse_expression(lexer, 0, limiter);
 
@@ -1363,7 +1363,7 @@ Statement *parse_import_statement(Lexer *lexer, ParserLimiter limiter) {
 
 
 Statement *parse_expression_statement(Lexer *lexer, ParserLimiter limiter) {
-  ExpressionStatement *expression_statement = malloc(sizeof(ExpressionStatement));
+  ExpressionStatement *expression_statement = arena_allocate(lexer->arena, sizeof(ExpressionStatement));
   expression_statement->statement = (Statement){.statement_type = StatementTypeExpressionStatement};
   expression_statement->expression = parse_expression(lexer, 0, limiter);
 
@@ -1399,8 +1399,9 @@ Statement *parse_statement(Lexer *lexer) {
 
 
 AST *parse_ast(Lexer *lexer) {
-  AST *ast = malloc(sizeof(AST));
+  AST *ast = memory_allocate(MemorySubsystemAST, sizeof(AST));
 
+  ast->arena = lexer->arena;
   ast->block = parse_block(lexer, DEFAULT_BLOCK_PARSER_LIMITER);
 
   return ast;
@@ -17,6 +17,14 @@
 #define RANGE_PRECEDENCE 13
 
 #include "lexer.h"
+#include "arena.h"
+
+// addresses given by the resolver, an identifier is found by going up depth scopes and reading slot
+#define UNRESOLVED_SLOT ((size_t) -1)
+#define GLOBAL_DEPTH ((size_t) -1)
+
+// a block with few names is searched in order, the index is only built past this count
+#define BLOCK_SLOT_INDEX_MIN_COUNT 8
 
 typedef enum {
   ASSIGN_OP = 1,
@@ -51,6 +59,8 @@ typedef enum {
   AWAIT_OP,
 } Operator;
 
+#define OPERATOR_COUNT (AWAIT_OP + 1)
+
 typedef enum {
   StatementTypeExpressionStatement = 1,
   StatementTypeBlockDefinitionStatement,
@@ -94,6 +104,12 @@ typedef struct {
   Literal *literal;
 } Expression;
 
+typedef struct {
+  Expression expression;
+  size_t depth;
+  size_t slot;
+} IdentifierExpression;
+
 typedef struct {
   Statement statement;
   Expression *expression;
@@ -144,6 +160,13 @@ typedef struct {
 typedef struct {
   Statement **statements;
   size_t statement_count;
+  char **slot_names;
+  size_t slot_count;
+  // open addressing index of the names once there are more than BLOCK_SLOT_INDEX_MIN_COUNT slots, an entry is a slot plus one
+  size_t *slot_index;
+  size_t slot_index_capacity;
+  bool has_duplicate_slots;
+  Arena *arena;
 } Block;
 
 typedef struct {
@@ -177,12 +200,19 @@ typedef struct {
   Expression *post_expression;
 } ForBlockDefinition;
 
+// a lazy function keeps the source of its body and has no block until it is first called
 typedef struct {
   Expression expression;
   Block *block;
   Expression *identifier;
   char **arguments;
   size_t argument_count;
+  char *body;
+  size_t body_length;
+  // how many slots of the main block were declared before the function, a lazy body only sees those
+  size_t global_slot_count;
+  bool should_optimize;
+  Arena *arena;
 } FunctionExpression;
 
 
@@ -193,6 +223,7 @@ typedef struct {
 
 typedef struct {
   Block *block;
+  Arena *arena;
 } AST;
 
 typedef enum {
@@ -209,6 +240,12 @@ typedef enum {
 void printf_alignment(unsigned int alignment);
 
 
+void printf_infix_operator(Operator operator);
+
+
+void printf_prefix_operator(Operator operator);
+
+
 void printf_expression(Expression *expression, unsigned int alignment);
 
 
@@ -224,16 +261,16 @@ void printf_statement(Statement *statement, unsigned int alignment);
 void printf_ast(AST *ast);
 
 
-void free_expression(Expression *expression);
+Block *new_block(Arena *arena);
 
 
-void free_statement(Statement *statement);
+size_t block_add_slot(Block *block, char *name);
 
 
-void free_block(Block *block);
+size_t block_get_slot(Block *block, char *name);
 
 
-void free_block_definition(BlockDefinition *block_definition);
+size_t block_get_slot_before(Block *block, char *name, size_t slot_count);
 
 
 void free_ast(AST *ast);
@@ -242,6 +279,15 @@ void free_ast(AST *ast);
 Operator token_to_operator(Token token);
 
 
+Operator get_compound_assign_operator(Operator operator);
+
+
+bool is_pure_expression(Expression *expression);
+
+
+size_t get_pure_arguments_start(ArrayExpression *array_expression);
+
+
 bool check_if_token_is_operator(Token token);
 
 
@@ -257,7 +303,10 @@ bool has_finished(Token token, ParserLimiter limiter);
 void *parser_error();
 
 
-Expression *eval_token(Token token);
+Expression *eval_token(Arena *arena, Token token);
+
+
+Expression *parse_token_expression(Lexer *lexer);
 
 
 Expression *parse_grouped_expression(Lexer *lexer);
@@ -284,6 +333,9 @@ Expression *parse_infix_expression(Lexer *lexer, ParserLimiter limiter, Expressi
 Expression *parse_function_expression(Lexer *lexer);
 
 
+Block *parse_function_body(FunctionExpression *function_expression);
+
+
 Expression *parse_expression(Lexer *lexer, unsigned short precedence, ParserLimiter limiter);
 
 
@@ -0,0 +1,199 @@
+#include "cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hashtable.h"
+#include "memory.h"
+
+
+// with the cache directory set the file is named by the hash of the source, otherwise it sits next to the script
+char *get_cache_path(const char *filename, uint64_t source_hash) {
+  char *directory = getenv(CACHE_DIRECTORY_VARIABLE);
+  char *cache_path;
+
+  if (directory != NULL && directory[0] != 0) {
+    size_t length = strlen(directory) + 32;
+
+    cache_path = memory_allocate(MemorySubsystemCache, length);
+    snprintf(cache_path, length, "%s/%016llx.piec", directory, (unsigned long long) source_hash);
+  }
+  else {
+    size_t length = strlen(filename) + strlen(CACHE_EXTENSION) + 1;
+
+    cache_path = memory_allocate(MemorySubsystemCache, length);
+    snprintf(cache_path, length, "%s%s", filename, CACHE_EXTENSION);
+  }
+
+  return cache_path;
+}
+
+
+size_t _get_payload_length(CacheHeader *header) {
+  return header->float_count * sizeof(long double)
+    + header->integer_count * sizeof(long long int)
+    + header->node_count * sizeof(FlatNode)
+    + header->child_count * sizeof(FlatIndex)
+    + header->string_length;
+}
+
+
+// the payload is only hashed after the counts are known to fit in the file, a stale or torn file is just a miss
+bool _is_valid_header(CacheHeader *header, size_t file_length, uint64_t source_hash, size_t source_length, bool is_optimized) {
+  if (memcmp(header->magic, CACHE_MAGIC, 4) != 0) return false;
+  if (header->version != CACHE_VERSION) return false;
+  if (header->float_size != sizeof(long double) || header->node_size != sizeof(FlatNode)) return false;
+  if (header->source_hash != source_hash || header->source_length != source_length) return false;
+  if (header->is_optimized != is_optimized) return false;
+  if (header->node_count == 0 || header->root >= header->node_count) return false;
+  if (header->node_count > file_length || header->child_count > file_length || header->integer_count > file_length || header->float_count > file_length) return false;
+  if (header->string_length > file_length) return false;
+
+  return sizeof(CacheHeader) + _get_payload_length(header) == file_length;
+}
+
+
+FlatAST *load_cache(const char *cache_path, uint64_t source_hash, size_t source_length, bool is_optimized) {
+  int fd = open(cache_path, O_RDONLY);
+
+  if (fd < 0) return NULL;
+
+  struct stat file_stat;
+
+  if (fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(CacheHeader)) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t file_length = (size_t) file_stat.st_size;
+  char *mapping = mmap(NULL, file_length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (mapping == MAP_FAILED) return NULL;
+
+  CacheHeader *header = (CacheHeader *) mapping;
+  char *payload = mapping + sizeof(CacheHeader);
+
+  if (!_is_valid_header(header, file_length, source_hash, source_length, is_optimized) || hash_string(payload, file_length - sizeof(CacheHeader)) != header->payload_hash) {
+    munmap(mapping, file_length);
+    return NULL;
+  }
+
+  FlatAST *flat_ast = memory_allocate_zeroed(MemorySubsystemCache, 1, sizeof(FlatAST));
+
+  flat_ast->mapping = mapping;
+  flat_ast->mapping_length = file_length;
+  flat_ast->root = header->root;
+
+  flat_ast->floats = (long double *) payload;
+  flat_ast->float_count = header->float_count;
+  payload += header->float_count * sizeof(long double);
+
+  flat_ast->integers = (long long int *) payload;
+  flat_ast->integer_count = header->integer_count;
+  payload += header->integer_count * sizeof(long long int);
+
+  flat_ast->nodes = (FlatNode *) payload;
+  flat_ast->node_count = header->node_count;
+  payload += header->node_count * sizeof(FlatNode);
+
+  flat_ast->children = (FlatIndex *) payload;
+  flat_ast->child_count = header->child_count;
+  payload += header->child_count * sizeof(FlatIndex);
+
+  flat_ast->strings = payload;
+  flat_ast->string_length = header->string_length;
+
+  // the payload hash only catches a torn file, the indices of a file that was written wrong are checked too
+  if (!is_valid_flat_ast(flat_ast)) {
+    free_flat_ast(flat_ast);
+    return NULL;
+  }
+
+  return flat_ast;
+}
+
+
+// an empty pool was never allocated, so it is skipped instead of copied from NULL
+char *_copy_section(char *cursor, const void *section, size_t length) {
+  if (length == 0) return cursor;
+
+  memcpy(cursor, section, length);
+
+  return cursor + length;
+}
+
+
+bool _write_section(int fd, const void *section, size_t length) {
+  const char *buffer = section;
+
+  while (length > 0) {
+    ssize_t written = write(fd, buffer, length);
+
+    if (written <= 0) return false;
+
+    buffer += written;
+    length -= (size_t) written;
+  }
+
+  return true;
+}
+
+
+// the file is written under a temporary name and renamed, so a reader never maps half of it
+bool save_cache(const char *cache_path, FlatAST *flat_ast, uint64_t source_hash, size_t source_length, bool is_optimized) {
+  CacheHeader header = {
+    .version = CACHE_VERSION,
+    .source_hash = source_hash,
+    .source_length = source_length,
+    .is_optimized = is_optimized,
+    .float_size = sizeof(long double),
+    .node_size = sizeof(FlatNode),
+    .root = flat_ast->root,
+    .node_count = flat_ast->node_count,
+    .child_count = flat_ast->child_count,
+    .integer_count = flat_ast->integer_count,
+    .float_count = flat_ast->float_count,
+    .string_length = flat_ast->string_length,
+  };
+
+  memcpy(header.magic, CACHE_MAGIC, 4);
+
+  size_t payload_length = _get_payload_length(&header);
+  char *payload = memory_allocate(MemorySubsystemCache, payload_length + 1);
+  char *cursor = payload;
+
+  cursor = _copy_section(cursor, flat_ast->floats, flat_ast->float_count * sizeof(long double));
+  cursor = _copy_section(cursor, flat_ast->integers, flat_ast->integer_count * sizeof(long long int));
+  cursor = _copy_section(cursor, flat_ast->nodes, flat_ast->node_count * sizeof(FlatNode));
+  cursor = _copy_section(cursor, flat_ast->children, flat_ast->child_count * sizeof(FlatIndex));
+  _copy_section(cursor, flat_ast->strings, flat_ast->string_length);
+
+  header.payload_hash = hash_string(payload, payload_length);
+
+  size_t temporary_length = strlen(cache_path) + 32;
+  char *temporary_path = memory_allocate(MemorySubsystemCache, temporary_length);
+
+  snprintf(temporary_path, temporary_length, "%s.%ld.tmp", cache_path, (long) getpid());
+
+  int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool is_saved = false;
+
+  if (fd >= 0) {
+    is_saved = _write_section(fd, &header, sizeof(CacheHeader)) && _write_section(fd, payload, payload_length);
+    close(fd);
+
+    if (is_saved) is_saved = rename(temporary_path, cache_path) == 0;
+    if (!is_saved) unlink(temporary_path);
+  }
+
+  memory_free(temporary_path);
+  memory_free(payload);
+
+  return is_saved;
+}
@@ -0,0 +1,44 @@
+#ifndef PIELANG_CACHE_H
+#define PIELANG_CACHE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bool.h"
+#include "flat.h"
+
+#define CACHE_MAGIC "PIEC"
+#define CACHE_VERSION 1u
+#define CACHE_EXTENSION "c"
+#define CACHE_DIRECTORY_VARIABLE "PIELANG_CACHE_DIR"
+
+// the header is a multiple of 16 bytes, so the float pool right after it stays aligned
+// the sections follow in the order floats, integers, nodes, children and strings
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint64_t source_hash;
+  uint64_t source_length;
+  uint64_t payload_hash;
+  uint8_t is_optimized;
+  uint8_t float_size;
+  uint16_t node_size;
+  FlatIndex root;
+  uint64_t node_count;
+  uint64_t child_count;
+  uint64_t integer_count;
+  uint64_t float_count;
+  uint64_t string_length;
+} CacheHeader;
+
+
+char *get_cache_path(const char *filename, uint64_t source_hash);
+
+
+FlatAST *load_cache(const char *cache_path, uint64_t source_hash, size_t source_length, bool is_optimized);
+
+
+bool save_cache(const char *cache_path, FlatAST *flat_ast, uint64_t source_hash, size_t source_length, bool is_optimized);
+
+
+#endif //PIELANG_CACHE_H
@@ -0,0 +1,812 @@
+#include "compiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "value.h"
+#include "gc.h"
+#include "memory.h"
+#include "hashtable.h"
+
+#define INITIAL_INSTRUCTION_CAPACITY 64
+#define INITIAL_CONSTANT_ENTRY_CAPACITY 16
+
+
+typedef struct {
+  Chunk *chunk;
+  // set once an operand does not fit its instruction, the chunk can not be run then
+  bool has_overflowed;
+  // open addressing over the constants of the chunk, an entry is the index of a constant plus one and 0 is empty
+  size_t *constant_entries;
+  size_t constant_entry_capacity;
+} Compiler;
+
+
+Chunk *new_chunk(Block *block) {
+  Chunk *chunk = memory_allocate(MemorySubsystemCompiler, sizeof(Chunk));
+
+  chunk->block = block;
+  chunk->instruction_count = 0;
+  chunk->instruction_capacity = INITIAL_INSTRUCTION_CAPACITY;
+  chunk->instructions = memory_allocate(MemorySubsystemCompiler, chunk->instruction_capacity * sizeof(Instruction));
+  chunk->constant_count = 0;
+  chunk->constants = NULL;
+  chunk->name_count = 0;
+  chunk->names = NULL;
+  chunk->function_count = 0;
+  chunk->functions = NULL;
+  chunk->block_count = 0;
+  chunk->blocks = NULL;
+
+  return chunk;
+}
+
+
+void free_chunk(Chunk *chunk) {
+  for (size_t i = 0; i < chunk->constant_count; i++) {
+    gc_unpin_value(chunk->constants[i]);
+  }
+
+  for (size_t i = 0; i < chunk->function_count; i++) {
+    free_chunk(chunk->functions[i].chunk);
+  }
+
+  memory_free(chunk->instructions);
+  memory_free(chunk->constants);
+  memory_free(chunk->names);
+  memory_free(chunk->functions);
+  memory_free(chunk->blocks);
+  memory_free(chunk);
+}
+
+
+size_t emit_instruction(Compiler *compiler, Instruction instruction) {
+  Chunk *chunk = compiler->chunk;
+
+  if (chunk->instruction_count == chunk->instruction_capacity) {
+    chunk->instruction_capacity *= 2;
+    chunk->instructions = memory_reallocate(MemorySubsystemCompiler, chunk->instructions, chunk->instruction_capacity * sizeof(Instruction));
+  }
+
+  chunk->instructions[chunk->instruction_count] = instruction;
+
+  return chunk->instruction_count++;
+}
+
+
+// an operand that does not fit is replaced by 0, the chunk is thrown away at the end anyway
+size_t check_operand(Compiler *compiler, size_t operand, size_t max_operand) {
+  if (operand <= max_operand) return operand;
+
+  compiler->has_overflowed = true;
+
+  return 0;
+}
+
+
+// jumps are emitted with an empty target and patched when the target is known
+void patch_jump(Compiler *compiler, size_t index, size_t target) {
+  Instruction instruction = compiler->chunk->instructions[index];
+
+  compiler->chunk->instructions[index] = INSTRUCTION_AX(GET_OPCODE(instruction), check_operand(compiler, target, MAX_AX));
+}
+
+
+// only literals are constants, so two of them are the same if their type and value are
+bool is_same_constant(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) != get_value_type(right_value)) return false;
+
+  switch (get_value_type(left_value)) {
+    case ValueTypeBoolValue: {
+      return get_bool_value(left_value) == get_bool_value(right_value);
+    }
+
+    case ValueTypeIntegerValue: {
+      return get_integer_value(left_value) == get_integer_value(right_value);
+    }
+
+    // 0.0 and -0.0 are equal, but print differently
+    case ValueTypeFloatValue: {
+      long double left_float = ((FloatValue *) left_value)->float_value;
+      long double right_float = ((FloatValue *) right_value)->float_value;
+
+      return left_float == right_float && signbit(left_float) == signbit(right_float);
+    }
+
+    case ValueTypeStringValue: {
+      StringValue *left_string_value = (StringValue *) left_value;
+      StringValue *right_string_value = (StringValue *) right_value;
+
+      if (left_string_value->length != right_string_value->length) return false;
+
+      return memcmp(get_string_chars(left_string_value), get_string_chars(right_string_value), left_string_value->length) == 0;
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+
+// equal constants hash the same, a float is hashed as a double since the padding of a long double is not set
+uint64_t get_constant_hash(Value *value) {
+  switch (get_value_type(value)) {
+    case ValueTypeIntegerValue: {
+      long long int integer = get_integer_value(value);
+      return hash_string((char *) &integer, sizeof(integer));
+    }
+
+    case ValueTypeFloatValue: {
+      double float_value = (double) ((FloatValue *) value)->float_value;
+      return hash_string((char *) &float_value, sizeof(float_value)) ^ ValueTypeFloatValue;
+    }
+
+    case ValueTypeStringValue: {
+      return get_string_value_hash((StringValue *) value) ^ ValueTypeStringValue;
+    }
+
+    default: {
+      return (uint64_t) get_bool_value(value) ^ get_value_type(value);
+    }
+  }
+}
+
+
+// the first entry that is either empty or holds a constant the same as the value
+size_t *find_constant_entry(Compiler *compiler, Value *value) {
+  size_t mask = compiler->constant_entry_capacity - 1;
+  size_t index = get_constant_hash(value) & mask;
+
+  while (compiler->constant_entries[index] != 0 && !is_same_constant(compiler->chunk->constants[compiler->constant_entries[index] - 1], value)) {
+    index = (index + 1) & mask;
+  }
+
+  return &compiler->constant_entries[index];
+}
+
+
+// the entries are kept at most half full
+void grow_constant_entries(Compiler *compiler) {
+  memory_free(compiler->constant_entries);
+
+  compiler->constant_entry_capacity = compiler->constant_entry_capacity == 0 ? INITIAL_CONSTANT_ENTRY_CAPACITY : compiler->constant_entry_capacity * 2;
+  compiler->constant_entries = memory_allocate_zeroed(MemorySubsystemCompiler, compiler->constant_entry_capacity, sizeof(size_t));
+
+  for (size_t i = 0; i < compiler->chunk->constant_count; i++) {
+    *find_constant_entry(compiler, compiler->chunk->constants[i]) = i + 1;
+  }
+}
+
+
+// a literal that is already a constant is not added again, the new value is left to the collector
+size_t add_constant(Compiler *compiler, Value *value) {
+  Chunk *chunk = compiler->chunk;
+
+  if ((chunk->constant_count + 1) * 2 > compiler->constant_entry_capacity) grow_constant_entries(compiler);
+
+  size_t *constant_entry = find_constant_entry(compiler, value);
+
+  if (*constant_entry != 0) return *constant_entry - 1;
+
+  *constant_entry = chunk->constant_count + 1;
+
+  // constants are pinned for the lifetime of the chunk, so the vm can push them without copying, and never changed in place
+  gc_pin_value(value);
+  share_value(value);
+
+  chunk->constants = memory_reallocate(MemorySubsystemCompiler, chunk->constants, (chunk->constant_count + 1) * sizeof(Value *));
+  chunk->constants[chunk->constant_count] = value;
+
+  return check_operand(compiler, chunk->constant_count++, MAX_AX);
+}
+
+
+size_t add_name(Compiler *compiler, char *name) {
+  Chunk *chunk = compiler->chunk;
+
+  for (size_t i = 0; i < chunk->name_count; i++) {
+    if (chunk->names[i] == name) return i;
+  }
+
+  chunk->names = memory_reallocate(MemorySubsystemCompiler, chunk->names, (chunk->name_count + 1) * sizeof(char *));
+  chunk->names[chunk->name_count] = name;
+
+  return check_operand(compiler, chunk->name_count++, MAX_B);
+}
+
+
+// the blocks of nested scopes, so that the vm knows how many slots a new scope has
+size_t add_block(Compiler *compiler, Block *block) {
+  Chunk *chunk = compiler->chunk;
+
+  chunk->blocks = memory_reallocate(MemorySubsystemCompiler, chunk->blocks, (chunk->block_count + 1) * sizeof(Block *));
+  chunk->blocks[chunk->block_count] = block;
+
+  return check_operand(compiler, chunk->block_count++, MAX_AX);
+}
+
+
+char *get_identifier_name(Expression *expression) {
+  return ((StringLiteral *) expression->literal)->string_literal;
+}
+
+
+// identifiers that were not resolved, or whose address does not fit the operands, are looked up by name
+bool has_slot_operands(IdentifierExpression *identifier_expression) {
+  if (identifier_expression->slot == UNRESOLVED_SLOT || identifier_expression->slot > MAX_B) return false;
+
+  return identifier_expression->depth == GLOBAL_DEPTH || identifier_expression->depth < GLOBAL_DEPTH_OPERAND;
+}
+
+
+Instruction slot_instruction(OpCode opcode, IdentifierExpression *identifier_expression) {
+  size_t depth = identifier_expression->depth == GLOBAL_DEPTH ? GLOBAL_DEPTH_OPERAND : identifier_expression->depth;
+
+  return INSTRUCTION(opcode, depth, identifier_expression->slot);
+}
+
+
+// consumes the value on top of the stack and leaves null in its place, like any assignment
+void compile_identifier_assignment(Compiler *compiler, Expression *expression) {
+  IdentifierExpression *identifier_expression = (IdentifierExpression *) expression;
+
+  if (has_slot_operands(identifier_expression)) {
+    emit_instruction(compiler, slot_instruction(OpCodeSetSlot, identifier_expression));
+  }
+  else {
+    emit_instruction(compiler, INSTRUCTION(OpCodeAssignName, ASSIGN_OP, add_name(compiler, get_identifier_name(expression))));
+  }
+}
+
+
+void compile_expression(Compiler *compiler, Expression *expression);
+
+
+void compile_statements(Compiler *compiler, Block *block);
+
+
+// a variable read only as an operand is not shared, since the value is not kept, a call shares the arguments it binds
+void compile_operand(Compiler *compiler, Expression *expression) {
+  if (expression == NULL || expression->expression_type != ExpressionTypeIdentifierExpression) {
+    compile_expression(compiler, expression);
+  }
+  else if (has_slot_operands((IdentifierExpression *) expression)) {
+    emit_instruction(compiler, slot_instruction(OpCodeReadSlot, (IdentifierExpression *) expression));
+  }
+  else {
+    emit_instruction(compiler, INSTRUCTION(OpCodeGetName, true, add_name(compiler, get_identifier_name(expression))));
+  }
+}
+
+
+// NULL if the block is too large for the operands of its instructions
+Chunk *compile_block(Block *block) {
+  Compiler compiler = {
+      .chunk = new_chunk(block),
+      .has_overflowed = false,
+      .constant_entries = NULL,
+      .constant_entry_capacity = 0,
+  };
+
+  compile_statements(&compiler, block);
+  emit_instruction(&compiler, INSTRUCTION_AX(OpCodeEnd, 0));
+
+  memory_free(compiler.constant_entries);
+
+  if (compiler.has_overflowed) {
+    free_chunk(compiler.chunk);
+    return NULL;
+  }
+
+  return compiler.chunk;
+}
+
+
+void compile_infix_expression(Compiler *compiler, InfixExpression *infix_expression) {
+  Operator operator = infix_expression->operator;
+
+  if (operator == ASSIGN_OP ||
+    operator == ASSIGN_ADDITION_OP ||
+    operator == ASSIGN_SUBTRACTION_OP ||
+    operator == ASSIGN_MULTIPLICATION_OP ||
+    operator == ASSIGN_DIVISION_OP ||
+    operator == ASSIGN_INTEGER_DIVISION_OP ||
+    operator == ASSIGN_EXPONENT_OP ||
+    operator == ASSIGN_MOD_OP) {
+
+    if (infix_expression->left_expression->expression_type == ExpressionTypeIdentifierExpression) {
+      IdentifierExpression *identifier_expression = (IdentifierExpression *) infix_expression->left_expression;
+
+      if (has_slot_operands(identifier_expression)) {
+        // the value is read without being shared and the infix may change it in place, it goes back to the same slot
+        if (operator != ASSIGN_OP) {
+          emit_instruction(compiler, slot_instruction(OpCodeUpdateSlot, identifier_expression));
+        }
+
+        compile_expression(compiler, infix_expression->right_expression);
+
+        if (operator != ASSIGN_OP) {
+          emit_instruction(compiler, INSTRUCTION(OpCodeInfix, get_compound_assign_operator(operator), true));
+        }
+
+        emit_instruction(compiler, slot_instruction(OpCodeSetSlot, identifier_expression));
+      }
+      else {
+        size_t name = add_name(compiler, get_identifier_name(infix_expression->left_expression));
+
+        compile_expression(compiler, infix_expression->right_expression);
+        emit_instruction(compiler, INSTRUCTION(OpCodeAssignName, operator, name));
+      }
+    }
+    else if (infix_expression->left_expression->expression_type == ExpressionTypeIndexExpression) {
+      IndexExpression *index_expression = (IndexExpression *) infix_expression->left_expression;
+
+      compile_expression(compiler, index_expression->left_expression);
+      compile_expression(compiler, index_expression->right_expression);
+
+      // compound assignments read the current item first, keeping the container and the index on the stack
+      if (operator != ASSIGN_OP) {
+        emit_instruction(compiler, INSTRUCTION(OpCodeIndex, true, 0));
+      }
+
+      compile_expression(compiler, infix_expression->right_expression);
+      emit_instruction(compiler, INSTRUCTION(OpCodeAssignIndex, operator, 0));
+    }
+    else {
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeNull, 0));
+    }
+
+    return;
+  }
+  else if (operator == MEMBER_OP) {
+    size_t name = add_name(compiler, get_identifier_name(infix_expression->right_expression));
+
+    compile_operand(compiler, infix_expression->left_expression);
+    emit_instruction(compiler, INSTRUCTION(OpCodeMember, 0, name));
+
+    return;
+  }
+
+  // the left side may be read from a variable that the right side reassigns or changes in place
+  if (is_pure_expression(infix_expression->right_expression)) compile_operand(compiler, infix_expression->left_expression);
+  else compile_expression(compiler, infix_expression->left_expression);
+
+  compile_operand(compiler, infix_expression->right_expression);
+  emit_instruction(compiler, INSTRUCTION(OpCodeInfix, operator, 0));
+}
+
+
+void compile_expression(Compiler *compiler, Expression *expression) {
+  if (expression == NULL) {
+    emit_instruction(compiler, INSTRUCTION_AX(OpCodeNull, 0));
+    return;
+  }
+
+  switch (expression->expression_type) {
+    case ExpressionTypeNullExpression: {
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeNull, 0));
+      break;
+    }
+
+    case ExpressionTypeBoolExpression: {
+      size_t constant = add_constant(compiler, new_bool_value_from_literal((BoolLiteral *) expression->literal));
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeConstant, constant));
+      break;
+    }
+
+    case ExpressionTypeIntegerExpression: {
+      size_t constant = add_constant(compiler, new_integer_value_from_literal((IntegerLiteral *) expression->literal));
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeConstant, constant));
+      break;
+    }
+
+    case ExpressionTypeFloatExpression: {
+      size_t constant = add_constant(compiler, new_float_value_from_literal((FloatLiteral *) expression->literal));
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeConstant, constant));
+      break;
+    }
+
+    case ExpressionTypeStringExpression: {
+      size_t constant = add_constant(compiler, new_string_value_from_literal((StringLiteral *) expression->literal));
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeConstant, constant));
+      break;
+    }
+
+    case ExpressionTypeIdentifierExpression: {
+      if (has_slot_operands((IdentifierExpression *) expression)) {
+        emit_instruction(compiler, slot_instruction(OpCodeGetSlot, (IdentifierExpression *) expression));
+      }
+      else {
+        size_t name = add_name(compiler, get_identifier_name(expression));
+        emit_instruction(compiler, INSTRUCTION(OpCodeGetName, 0, name));
+      }
+      break;
+    }
+
+    case ExpressionTypeInfixExpression: {
+      compile_infix_expression(compiler, (InfixExpression *) expression);
+      break;
+    }
+
+    case ExpressionTypePrefixExpression: {
+      PrefixExpression *prefix_expression = (PrefixExpression *) expression;
+
+      compile_operand(compiler, prefix_expression->right_expression);
+      emit_instruction(compiler, INSTRUCTION(OpCodePrefix, prefix_expression->operator, 0));
+      break;
+    }
+
+    case ExpressionTypeIndexExpression: {
+      IndexExpression *index_expression = (IndexExpression *) expression;
+
+      compile_expression(compiler, index_expression->left_expression);
+      compile_expression(compiler, index_expression->right_expression);
+      emit_instruction(compiler, INSTRUCTION(OpCodeIndex, false, 0));
+      break;
+    }
+
+    case ExpressionTypeArrayExpression: {
+      ArrayExpression *array_expression = (ArrayExpression *) expression;
+
+      for (size_t i = 0; i < array_expression->expression_count; i++) {
+        compile_expression(compiler, array_expression->expressions[i]);
+      }
+
+      // the lowest bit of the operand keeps has_finished, the rest is the item count
+      size_t operand = check_operand(compiler, (array_expression->expression_count << 1u) | array_expression->has_finished, MAX_AX);
+
+      if (array_expression->array_expression_type == ArrayExpressionTypeTuple) {
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeBuildTuple, operand));
+      }
+      else {
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeBuildList, operand));
+      }
+      break;
+    }
+
+    case ExpressionTypeCallExpression: {
+      CallExpression *call_expression = (CallExpression *) expression;
+
+      ArrayExpression *tuple_expression = (ArrayExpression *) call_expression->tuple_expression;
+      size_t operand_start = get_pure_arguments_start(tuple_expression);
+
+      compile_expression(compiler, call_expression->identifier_expression);
+
+      for (size_t i = 0; i < tuple_expression->expression_count; i++) {
+        if (i >= operand_start) compile_operand(compiler, tuple_expression->expressions[i]);
+        else compile_expression(compiler, tuple_expression->expressions[i]);
+      }
+
+      size_t operand = check_operand(compiler, (tuple_expression->expression_count << 1u) | tuple_expression->has_finished, MAX_AX);
+
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeBuildTuple, operand));
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeCall, 0));
+      break;
+    }
+
+    case ExpressionTypeFunctionExpression: {
+      FunctionExpression *function_expression = (FunctionExpression *) expression;
+      Chunk *chunk = compiler->chunk;
+
+      Chunk *function_chunk = compile_block(function_expression->block);
+
+      // the chunk of a body that did not compile is not kept, the whole program is given up
+      if (function_chunk == NULL) {
+        compiler->has_overflowed = true;
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeNull, 0));
+        break;
+      }
+
+      chunk->functions = memory_reallocate(MemorySubsystemCompiler, chunk->functions, (chunk->function_count + 1) * sizeof(ChunkFunction));
+      chunk->functions[chunk->function_count] = (ChunkFunction) {
+        .function_expression = function_expression,
+        .chunk = function_chunk,
+      };
+
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeFunction, check_operand(compiler, chunk->function_count++, MAX_AX)));
+
+      // a named function is bound and still evaluates to the function itself
+      if (function_expression->identifier != NULL) {
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeDuplicate, 0));
+        compile_identifier_assignment(compiler, function_expression->identifier);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+      }
+      break;
+    }
+  }
+}
+
+
+void compile_block_definition(Compiler *compiler, BlockDefinition *block_definition) {
+  switch (block_definition->block_definition_type) {
+    case BlockDefinitionTypeIfElseGroupBlock: {
+      IfElseGroupBlockDefinition *if_else_group_block_definition = (IfElseGroupBlockDefinition *) block_definition;
+
+      size_t *end_jumps = memory_allocate(MemorySubsystemCompiler, if_else_group_block_definition->if_block_definitions_length * sizeof(size_t));
+
+      for (size_t i = 0; i < if_else_group_block_definition->if_block_definitions_length; i++) {
+        IfBlockDefinition *if_block_definition = if_else_group_block_definition->if_block_definitions[i];
+
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeEnterScope, add_block(compiler, if_block_definition->block)));
+
+        if (if_block_definition->pre_expression != NULL) {
+          compile_expression(compiler, if_block_definition->pre_expression);
+          emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+        }
+
+        compile_expression(compiler, if_block_definition->condition);
+        size_t false_jump = emit_instruction(compiler, INSTRUCTION_AX(OpCodeJumpIfFalse, 0));
+
+        compile_statements(compiler, if_block_definition->block);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeLeaveScope, 0));
+        end_jumps[i] = emit_instruction(compiler, INSTRUCTION_AX(OpCodeJump, 0));
+
+        patch_jump(compiler, false_jump, compiler->chunk->instruction_count);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeLeaveScope, 0));
+      }
+
+      if (if_else_group_block_definition->else_block_definition != NULL) {
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeEnterScope, add_block(compiler, if_else_group_block_definition->else_block_definition->block)));
+        compile_statements(compiler, if_else_group_block_definition->else_block_definition->block);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeLeaveScope, 0));
+      }
+
+      for (size_t i = 0; i < if_else_group_block_definition->if_block_definitions_length; i++) {
+        patch_jump(compiler, end_jumps[i], compiler->chunk->instruction_count);
+      }
+
+      memory_free(end_jumps);
+      break;
+    }
+
+    case BlockDefinitionTypeForBlock: {
+      ForBlockDefinition *for_block_definition = (ForBlockDefinition *) block_definition;
+
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeEnterScope, add_block(compiler, for_block_definition->block)));
+
+      if (for_block_definition->pre_expression != NULL) {
+        compile_expression(compiler, for_block_definition->pre_expression);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+      }
+
+      if (for_block_definition->condition != NULL && for_block_definition->condition->expression_type == ExpressionTypeInfixExpression && (((InfixExpression *) for_block_definition->condition)->operator == IN_OP)) {
+        InfixExpression *in_infix_expression = (InfixExpression *) for_block_definition->condition;
+        Expression *iterated_expression = in_infix_expression->right_expression;
+
+        size_t loop_start, exit_jump;
+
+        if (iterated_expression->expression_type == ExpressionTypeInfixExpression && ((InfixExpression *) iterated_expression)->operator == RANGE_OP) {
+          // a numeric range keeps its next and its end number on the stack instead of allocating a generator
+          compile_expression(compiler, ((InfixExpression *) iterated_expression)->left_expression);
+          compile_expression(compiler, ((InfixExpression *) iterated_expression)->right_expression);
+          emit_instruction(compiler, INSTRUCTION_AX(OpCodeRangeIterator, 0));
+
+          loop_start = compiler->chunk->instruction_count;
+          exit_jump = emit_instruction(compiler, INSTRUCTION_AX(OpCodeForRange, 0));
+        }
+        else {
+          // the iterated value stays on the stack below its generator until the loop ends
+          compile_expression(compiler, iterated_expression);
+          emit_instruction(compiler, INSTRUCTION_AX(OpCodeIterator, 0));
+
+          loop_start = compiler->chunk->instruction_count;
+          exit_jump = emit_instruction(compiler, INSTRUCTION_AX(OpCodeForIterator, 0));
+        }
+
+        compile_identifier_assignment(compiler, in_infix_expression->left_expression);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+
+        compile_statements(compiler, for_block_definition->block);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeJump, check_operand(compiler, loop_start, MAX_AX)));
+
+        patch_jump(compiler, exit_jump, compiler->chunk->instruction_count);
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+      }
+      else {
+        size_t loop_start = compiler->chunk->instruction_count;
+
+        compile_expression(compiler, for_block_definition->condition);
+        size_t exit_jump = emit_instruction(compiler, INSTRUCTION_AX(OpCodeJumpIfFalse, 0));
+
+        compile_statements(compiler, for_block_definition->block);
+
+        if (for_block_definition->post_expression != NULL) {
+          compile_expression(compiler, for_block_definition->post_expression);
+          emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+        }
+
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeJump, check_operand(compiler, loop_start, MAX_AX)));
+        patch_jump(compiler, exit_jump, compiler->chunk->instruction_count);
+      }
+
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeLeaveScope, 0));
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void compile_statement(Compiler *compiler, Statement *statement) {
+  switch (statement->statement_type) {
+    case StatementTypeExpressionStatement: {
+      compile_expression(compiler, ((ExpressionStatement *) statement)->expression);
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodePop, 0));
+      break;
+    }
+
+    case StatementTypeReturnStatement: {
+      compile_expression(compiler, ((ReturnStatement *) statement)->right_expression);
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeReturn, 0));
+      break;
+    }
+
+    // a bare name is the name of the script, like in the evaluator
+    case StatementTypeImportStatement: {
+      Expression *expression = ((ImportStatement *) statement)->right_expression;
+
+      if (expression->expression_type == ExpressionTypeIdentifierExpression) {
+        emit_instruction(compiler, INSTRUCTION_AX(OpCodeConstant, add_constant(compiler, new_string_value_from_literal((StringLiteral *) expression->literal))));
+      }
+      else {
+        compile_expression(compiler, expression);
+      }
+
+      emit_instruction(compiler, INSTRUCTION_AX(OpCodeImport, 0));
+      break;
+    }
+
+    case StatementTypeBlockDefinitionStatement: {
+      compile_block_definition(compiler, ((BlockDefinitionStatement *) statement)->block_definition);
+      break;
+    }
+  }
+}
+
+
+void compile_statements(Compiler *compiler, Block *block) {
+  for (size_t i = 0; i < block->statement_count; i++) {
+    compile_statement(compiler, block->statements[i]);
+  }
+}
+
+
+Chunk *compile_ast(AST *ast) {
+  return compile_block(ast->block);
+}
+
+
+char *opcode_to_string(OpCode opcode) {
+  switch (opcode) {
+    case OpCodeEnd: return "END";
+    case OpCodeNull: return "NULL";
+    case OpCodeConstant: return "CONSTANT";
+    case OpCodePop: return "POP";
+    case OpCodeDuplicate: return "DUPLICATE";
+    case OpCodeGetName: return "GET_NAME";
+    case OpCodeAssignName: return "ASSIGN_NAME";
+    case OpCodeGetSlot: return "GET_SLOT";
+    case OpCodeSetSlot: return "SET_SLOT";
+    case OpCodeUpdateSlot: return "UPDATE_SLOT";
+    case OpCodeReadSlot: return "READ_SLOT";
+    case OpCodeAssignIndex: return "ASSIGN_INDEX";
+    case OpCodeMember: return "MEMBER";
+    case OpCodeIndex: return "INDEX";
+    case OpCodeInfix: return "INFIX";
+    case OpCodePrefix: return "PREFIX";
+    case OpCodeBuildTuple: return "BUILD_TUPLE";
+    case OpCodeBuildList: return "BUILD_LIST";
+    case OpCodeCall: return "CALL";
+    case OpCodeFunction: return "FUNCTION";
+    case OpCodeReturn: return "RETURN";
+    case OpCodeEnterScope: return "ENTER_SCOPE";
+    case OpCodeLeaveScope: return "LEAVE_SCOPE";
+    case OpCodeJump: return "JUMP";
+    case OpCodeJumpIfFalse: return "JUMP_IF_FALSE";
+    case OpCodeIterator: return "ITERATOR";
+    case OpCodeForIterator: return "FOR_ITERATOR";
+    case OpCodeRangeIterator: return "RANGE_ITERATOR";
+    case OpCodeForRange: return "FOR_RANGE";
+    case OpCodeImport: return "IMPORT";
+    default: return "UNKNOWN";
+  }
+}
+
+
+void printf_chunk(Chunk *chunk, unsigned int alignment) {
+  for (size_t i = 0; i < chunk->instruction_count; i++) {
+    Instruction instruction = chunk->instructions[i];
+    OpCode opcode = GET_OPCODE(instruction);
+
+    printf_alignment(alignment);
+    printf("%04zu %-14s", i, opcode_to_string(opcode));
+
+    switch (opcode) {
+      case OpCodeConstant: {
+        char *s = convert_to_string(chunk->constants[GET_AX(instruction)]);
+        printf(" %u (%s)", GET_AX(instruction), s);
+        memory_free(s);
+        break;
+      }
+
+      case OpCodeGetName:
+      case OpCodeMember: {
+        printf(" %s", chunk->names[GET_B(instruction)]);
+        if (GET_A(instruction)) printf(" operand");
+        break;
+      }
+
+      case OpCodeAssignName: {
+        printf(" %s op=%u", chunk->names[GET_B(instruction)], GET_A(instruction));
+        break;
+      }
+
+      case OpCodeGetSlot:
+      case OpCodeSetSlot:
+      case OpCodeUpdateSlot:
+      case OpCodeReadSlot: {
+        if (GET_A(instruction) == GLOBAL_DEPTH_OPERAND) {
+          printf(" global:%u", GET_B(instruction));
+        }
+        else {
+          printf(" %u:%u", GET_A(instruction), GET_B(instruction));
+        }
+        break;
+      }
+
+      case OpCodeIndex: {
+        if (GET_A(instruction)) printf(" keep");
+        break;
+      }
+
+      case OpCodeInfix: {
+        printf(" op=%u", GET_A(instruction));
+        if (GET_B(instruction)) printf(" in place");
+        break;
+      }
+
+      case OpCodeAssignIndex:
+      case OpCodePrefix: {
+        printf(" op=%u", GET_A(instruction));
+        break;
+      }
+
+      case OpCodeBuildTuple:
+      case OpCodeBuildList: {
+        printf(" %u", GET_AX(instruction) >> 1u);
+        break;
+      }
+
+      case OpCodeFunction:
+      case OpCodeEnterScope:
+      case OpCodeJump:
+      case OpCodeJumpIfFalse:
+      case OpCodeForIterator:
+      case OpCodeForRange: {
+        printf(" %u", GET_AX(instruction));
+        break;
+      }
+
+      default: {
+        break;
+      }
+    }
+
+    printf("\n");
+  }
+
+  for (size_t i = 0; i < chunk->function_count; i++) {
+    printf_alignment(alignment);
+    printf("function %zu:\n", i);
+    printf_chunk(chunk->functions[i].chunk, alignment + 1u);
+  }
+}
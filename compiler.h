@@ -0,0 +1,101 @@
+#ifndef PIELANG_COMPILER_H
+#define PIELANG_COMPILER_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "value.h"
+
+// every instruction is one 32 bit word, the low 8 bits are the opcode and the rest is either
+// a single 24 bit operand (ax) or an 8 bit operand (a) followed by a 16 bit operand (b)
+#define INSTRUCTION(opcode, a, b) ((Instruction) (opcode) | ((Instruction) (a) << 8u) | ((Instruction) (b) << 16u))
+#define INSTRUCTION_AX(opcode, ax) ((Instruction) (opcode) | ((Instruction) (ax) << 8u))
+
+#define GET_OPCODE(instruction) ((OpCode) ((instruction) & 0xFFu))
+#define GET_A(instruction) (((instruction) >> 8u) & 0xFFu)
+#define GET_B(instruction) ((instruction) >> 16u)
+#define GET_AX(instruction) ((instruction) >> 8u)
+
+#define MAX_AX 0xFFFFFFu
+#define MAX_B 0xFFFFu
+
+// slot instructions keep the scope depth in a and the slot in b, the largest depth stands for the global scope
+#define GLOBAL_DEPTH_OPERAND 0xFFu
+#define GET_DEPTH(instruction) (GET_A(instruction) == GLOBAL_DEPTH_OPERAND ? GLOBAL_DEPTH : GET_A(instruction))
+
+typedef uint32_t Instruction;
+
+typedef enum {
+  OpCodeEnd = 0,
+  OpCodeNull,
+  OpCodeConstant,
+  OpCodePop,
+  OpCodeDuplicate,
+  OpCodeGetName,
+  OpCodeAssignName,
+  OpCodeGetSlot,
+  OpCodeSetSlot,
+  OpCodeUpdateSlot,
+  OpCodeReadSlot,
+  OpCodeAssignIndex,
+  OpCodeMember,
+  OpCodeIndex,
+  OpCodeInfix,
+  OpCodePrefix,
+  OpCodeBuildTuple,
+  OpCodeBuildList,
+  OpCodeCall,
+  OpCodeFunction,
+  OpCodeReturn,
+  OpCodeEnterScope,
+  OpCodeLeaveScope,
+  OpCodeJump,
+  OpCodeJumpIfFalse,
+  OpCodeIterator,
+  OpCodeForIterator,
+  OpCodeRangeIterator,
+  OpCodeForRange,
+  OpCodeImport,
+} OpCode;
+
+struct Chunk;
+
+typedef struct {
+  FunctionExpression *function_expression;
+  struct Chunk *chunk;
+} ChunkFunction;
+
+typedef struct Chunk {
+  Block *block;
+  Instruction *instructions;
+  size_t instruction_count;
+  size_t instruction_capacity;
+  Value **constants;
+  size_t constant_count;
+  char **names;
+  size_t name_count;
+  ChunkFunction *functions;
+  size_t function_count;
+  Block **blocks;
+  size_t block_count;
+} Chunk;
+
+
+Chunk *new_chunk(Block *block);
+
+
+void free_chunk(Chunk *chunk);
+
+
+void printf_chunk(Chunk *chunk, unsigned int alignment);
+
+
+Chunk *compile_block(Block *block);
+
+
+Chunk *compile_ast(AST *ast);
+
+
+#endif //PIELANG_COMPILER_H
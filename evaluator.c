@@ -8,349 +8,188 @@
 #include "ast.h"
 #include "scope.h"
 #include "value.h"
+#include "gc.h"
 #include "system.h"
 #include "utils.h"
+#include "optimizer.h"
+#include "resolver.h"
+#include "module.h"
+#include "memory.h"
 
-Value *_evaluate_or_apply_index_operation(Scope *scope, IndexExpression *index_expression, Value *assign_value) {
+Value *apply_index_operation(Value *left_value, Value *right_value, Value *assign_value) {
   Value *result_value = new_null_value();
 
-  Value *index_expression_left_value = evaluate_expression(scope, index_expression->left_expression);
-  Value *index_expression_right_value = evaluate_expression(scope, index_expression->right_expression);
+  long long int index_value = convert_to_integer(right_value);
 
-  IntegerValue *right_integer_value = (IntegerValue *) index_expression_right_value;
-
-  if (index_expression_left_value->value_type == ValueTypeStringValue) {
+  if (get_value_type(left_value) == ValueTypeStringValue) {
     if (assign_value != NULL) return new_null_value();
 
-    StringValue *string_value = (StringValue *) index_expression_left_value;
-
-    char *s = create_string_from_char(string_value->string_value[right_integer_value->integer_value]);
+    StringValue *string_value = (StringValue *) left_value;
 
-    result_value = new_string_value(s, 1);
+    result_value = new_char_string_value(get_string_chars(string_value)[index_value]);
   }
-  else if (index_expression_left_value->value_type == ValueTypeTupleValue) {
+  else if (get_value_type(left_value) == ValueTypeTupleValue) {
     if (assign_value != NULL) return new_null_value();
 
-    TupleValue *tuple_value = (TupleValue *) index_expression_left_value;
+    TupleValue *tuple_value = (TupleValue *) left_value;
 
-    result_value = tuple_value->items[normalize_index(right_integer_value->integer_value, tuple_value->length)];
+    result_value = share_value(tuple_value->items[normalize_index(index_value, tuple_value->length)]);
   }
-  else if (index_expression_left_value->value_type == ValueTypeListValue) {
-    ListValue *list_value = (ListValue *) index_expression_left_value;
+  else if (get_value_type(left_value) == ValueTypeListValue) {
+    ListValue *list_value = (ListValue *) left_value;
 
-    size_t index = normalize_index(right_integer_value->integer_value, list_value->length);
+    size_t index = normalize_index(index_value, list_value->length);
 
     if (assign_value == NULL) {
-      result_value = list_value->items[index];
+      result_value = share_value(list_value->items[index]);
     }
     else {
-      Value *old_value = list_value->items[index];
       list_value->items[index] = assign_value;
-
-      old_value->linked_variable_count--;
-      assign_value->linked_variable_count++;
-
-      free_value(old_value);
     }
   }
 
-  free_value(index_expression_left_value);
-  free_value(index_expression_right_value);
-
   return result_value;
 }
 
 
-Value *call_system_function(Scope *scope, SystemFunctionValue *system_function_value, TupleValue *parameter_values) {
-  return system_function_value->callback(system_function_value->value.context_value, parameter_values);
-}
+Value *_evaluate_or_apply_index_operation(Scope *scope, IndexExpression *index_expression, Value *assign_value) {
+  Value *index_expression_left_value = evaluate_expression(scope, index_expression->left_expression);
 
+  // the container may be read from a variable that the index expression reassigns
+  gc_push_root(index_expression_left_value);
 
-Value *call_function(Scope *scope, FunctionValue *function_value, TupleValue *parameter_values) {
-  Scope *function_scope = new_scope(scope, function_value->block, ScopeTypeFunctionScope);
+  Value *index_expression_right_value = evaluate_expression(scope, index_expression->right_expression);
 
-  if (parameter_values->length > function_value->argument_count) return new_null_value();
+  return apply_index_operation(index_expression_left_value, index_expression_right_value, assign_value);
+}
 
-  Value *variable_value;
 
-  for (size_t i = 0; i < function_value->argument_count; i++) {
-    if (parameter_values->length <= i) {
-      variable_value = new_null_value();
-    }
-    else {
-      variable_value = parameter_values->items[i];
-    }
+Variable *_get_identifier_variable(Scope *scope, Expression *expression) {
+  IdentifierExpression *identifier_expression = (IdentifierExpression *) expression;
 
-    scope_set_variable(function_scope, ValueTypeNullValue, function_value->arguments[i], variable_value, true);
+  if (identifier_expression->slot != UNRESOLVED_SLOT) {
+    return scope_get_slot(scope, identifier_expression->depth, identifier_expression->slot);
   }
 
-  Value *result = evaluate_scope(function_scope);
-  free_scope(function_scope);
-
-  return result;
+  return scope_get_variable(scope, ValueTypeNullValue, ((StringLiteral *) expression->literal)->string_literal);
 }
 
 
-Value *apply_prefix_not_operation(Value *right_value) {
-  if (right_value->value_type == ValueTypeBoolValue) {
-    return new_bool_value(!((BoolValue *) right_value)->bool_value);
-  }
-  else if (right_value->value_type == ValueTypeIntegerValue) {
-    return new_integer_value(!((IntegerValue *) right_value)->integer_value);
-  }
-
-  return new_bool_value(!convert_to_bool(right_value));
-}
-
+void _set_identifier_value(Scope *scope, Expression *expression, Value *value) {
+  IdentifierExpression *identifier_expression = (IdentifierExpression *) expression;
 
-Value *apply_prefix_plus_operation(Value *right_value) {
-  if (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue) {
-    return copy_value(right_value);
+  if (identifier_expression->slot != UNRESOLVED_SLOT) {
+    scope_set_slot(scope, identifier_expression->depth, identifier_expression->slot, value);
+  }
+  else {
+    scope_set_variable(scope, ValueTypeNullValue, ((StringLiteral *) expression->literal)->string_literal, value, false);
   }
-
-  return new_null_value();
 }
 
 
-Value *apply_prefix_minus_operation(Value *right_value) {
-  if (right_value->value_type == ValueTypeIntegerValue) {
-    return new_integer_value(-((IntegerValue *) right_value)->integer_value);
-  }
-  else if (right_value->value_type == ValueTypeFloatValue) {
-    return new_float_value(-((FloatValue *) right_value)->float_value);
-  }
-
-  return new_null_value();
+Value *call_system_function(Scope *scope, SystemFunctionValue *system_function_value, TupleValue *parameter_values) {
+  return system_function_value->callback(system_function_value->value.context_value, parameter_values);
 }
 
 
-Value *apply_index_operation(Scope *scope, IndexExpression *index_expression, Value *assign_value) {
-  return _evaluate_or_apply_index_operation(scope, index_expression, assign_value);
-}
+// a lazy body is parsed, optimized and resolved on the first call, the other values of the same expression share it
+Block *_load_function_block(Scope *global_scope, FunctionExpression *function_expression) {
+  if (function_expression->block == NULL) {
+    parse_function_body(function_expression);
 
+    if (function_expression->should_optimize) optimize_block(function_expression->block);
 
-Value *apply_range_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_generator_value(GeneratorValueTypeNumber, left_value, right_value);
+    resolve_function_body(global_scope->block, function_expression);
   }
 
-  return new_null_value();
+  return function_expression->block;
 }
 
 
-Value *apply_addition_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeStringValue || right_value->value_type == ValueTypeStringValue) {
-    char *s1 = convert_to_string(left_value);
-    char *s2 = convert_to_string(right_value);
-
-    size_t length = strlen(s1) + strlen(s2);
-
-    char *result_string = calloc(length + 1, sizeof(char));
-
-    strcpy(result_string, s1);
-    strcat(result_string, s2);
-
-    free(s1);
-    free(s2);
+Value *call_function(Scope *scope, FunctionValue *function_value, TupleValue *parameter_values) {
+  if (parameter_values->length > function_value->argument_count) return new_null_value();
 
-    return new_string_value(result_string, length);
-  }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-      return new_integer_value(((IntegerValue *) left_value)->integer_value + ((IntegerValue *) right_value)->integer_value);
-    }
-    else {
-      long double left_float, right_float;
+  Scope *global_scope = function_value->global_scope != NULL ? function_value->global_scope : scope->global_scope;
 
-      if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-      else left_float = ((IntegerValue *) left_value)->integer_value;
+  if (function_value->block == NULL) function_value->block = _load_function_block(global_scope, function_value->function_expression);
 
-      if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-      else right_float = ((IntegerValue *) right_value)->integer_value;
+  Scope *function_scope = new_scope(scope, function_value->block, ScopeTypeFunctionScope);
 
-      return new_float_value(left_float + right_float);
-    }
-  }
-  else if ((left_value->value_type == ValueTypeTupleValue || left_value->value_type == ValueTypeListValue) && (right_value->value_type == ValueTypeTupleValue || right_value->value_type == ValueTypeListValue)) {
-    Value **left_array_items, **right_array_items, **result_items;
-    size_t left_array_item_length, right_array_item_length;
+  function_scope->global_scope = global_scope;
 
-    if (left_value->value_type == ValueTypeListValue) {
-      left_array_items = ((ListValue *) left_value)->items;
-      left_array_item_length = ((ListValue *) left_value)->length;
-    }
-    else {
-      left_array_items = ((TupleValue *) left_value)->items;
-      left_array_item_length = ((TupleValue *) left_value)->length;
-    }
+  Value *variable_value;
 
-    if (right_value->value_type == ValueTypeListValue) {
-      right_array_items = ((ListValue *) right_value)->items;
-      right_array_item_length = ((ListValue *) right_value)->length;
+  for (size_t i = 0; i < function_value->argument_count; i++) {
+    if (parameter_values->length <= i) {
+      variable_value = new_null_value();
     }
     else {
-      right_array_items = ((TupleValue *) right_value)->items;
-      right_array_item_length = ((TupleValue *) right_value)->length;
+      variable_value = share_value(parameter_values->items[i]);
     }
 
-    result_items = malloc((left_array_item_length + right_array_item_length) * sizeof(Value *));
-
-    for (int i = 0; i < left_array_item_length; i++) {
-      result_items[i] = left_array_items[i];
-      result_items[i]->linked_variable_count++;
-    }
-
-    for (int i = 0; i < right_array_item_length; i++) {
-      result_items[i + left_array_item_length] = right_array_items[i];
-      result_items[i + left_array_item_length]->linked_variable_count++;
-    }
-
-    return new_list_value(result_items, left_array_item_length + right_array_item_length, true);
-  }
-
-  return new_null_value();
-}
-
-
-Value *apply_subtraction_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_integer_value(((IntegerValue *) left_value)->integer_value - ((IntegerValue *) right_value)->integer_value);
+    // the resolver gives the arguments the first slots of the function block
+    scope_declare_slot(function_scope, i, variable_value);
   }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
 
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
+  Value *result = evaluate_scope(function_scope);
 
-    return new_float_value(left_float - right_float);
-  }
+  // the statements of the function dropped their temporary roots, keep the result alive for the caller
+  gc_push_root(result);
+  free_scope(function_scope);
 
-  return new_null_value();
+  return result;
 }
 
 
-Value *apply_multiplication_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_integer_value(((IntegerValue *) left_value)->integer_value * ((IntegerValue *) right_value)->integer_value);
+Value *apply_prefix_not_operation(Value *right_value) {
+  if (get_value_type(right_value) == ValueTypeBoolValue) {
+    return new_bool_value(!get_bool_value(right_value));
   }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
-
-    return new_float_value(left_float * right_float);
+  else if (get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_integer_value(!get_integer_value(right_value));
   }
 
-  return new_null_value();
+  return new_bool_value(!convert_to_bool(right_value));
 }
 
 
-Value *apply_division_operation(Value *left_value, Value *right_value, bool is_integer_division) {
-  if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float, result;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
-
-    result = left_float / right_float;
-
-    if (is_integer_division || ceil(result) == floor(result)) {
-      return new_integer_value((long long int) result);
-    }
-    else {
-      return new_float_value(result);
-    }
+Value *apply_prefix_plus_operation(Value *right_value) {
+  if (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue) {
+    return copy_value(right_value);
   }
 
   return new_null_value();
 }
 
 
-Value *apply_exponent_operation(Value *left_value, Value *right_value) {
-  if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float, result;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
-
-    result = pow(left_float, right_float);
-
-    if (ceil(result) == floor(result)) {
-      return new_integer_value((long long int) result);
-    }
-    else {
-      return new_float_value(result);
-    }
+Value *apply_prefix_minus_operation(Value *right_value) {
+  if (get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_integer_value(-get_integer_value(right_value));
   }
-
-  return new_null_value();
-}
-
-
-Value *apply_mod_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_integer_value(((IntegerValue *) left_value)->integer_value % ((IntegerValue *) right_value)->integer_value);
+  else if (get_value_type(right_value) == ValueTypeFloatValue) {
+    return new_float_value(-((FloatValue *) right_value)->float_value);
   }
 
   return new_null_value();
 }
 
 
-Value *apply_assign_operation(Value *left_value, Value *right_value, Operator operator) {
-  Value *result_value = NULL;
+Value *apply_prefix_operation(Operator operator, Value *right_value) {
+  Value *result_value;
 
   switch (operator) {
-    case ASSIGN_OP: {
-      result_value = right_value;
-      break;
-    }
-
-    case ASSIGN_ADDITION_OP:{
-      result_value = apply_addition_operation(left_value, right_value);
-
-      break;
-    }
-
-    case ASSIGN_SUBTRACTION_OP:{
-      result_value = apply_subtraction_operation(left_value, right_value);
-      break;
-    }
-
-    case ASSIGN_MULTIPLICATION_OP:{
-      result_value = apply_multiplication_operation(left_value, right_value);
-      break;
-    }
-
-    case ASSIGN_DIVISION_OP:{
-      result_value = apply_division_operation(left_value, right_value, false);
-      break;
-    }
-
-    case ASSIGN_INTEGER_DIVISION_OP:{
-      result_value = apply_division_operation(left_value, right_value, true);
+    case NOT_OP: {
+      result_value = apply_prefix_not_operation(right_value);
       break;
     }
 
-    case ASSIGN_EXPONENT_OP:{
-      result_value = apply_exponent_operation(left_value, right_value);
+    case ADDITION_OP: {
+      result_value = apply_prefix_plus_operation(right_value);
       break;
     }
 
-    case ASSIGN_MOD_OP:{
-      result_value = apply_mod_operation(left_value, right_value);
+    case SUBTRACTION_OP: {
+      result_value = apply_prefix_minus_operation(right_value);
       break;
     }
 
@@ -364,149 +203,66 @@ Value *apply_assign_operation(Value *left_value, Value *right_value, Operator op
 }
 
 
-Value *apply_check_equality_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_bool_value(((IntegerValue *) left_value)->integer_value == ((IntegerValue *) right_value)->integer_value);
-  }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
-
-    return new_bool_value(left_float == right_float);
-  }
-  else if (left_value->value_type == ValueTypeStringValue  && right_value->value_type == ValueTypeStringValue) {
-    return new_bool_value(strcmp(((StringValue *) left_value)->string_value, ((StringValue *) left_value)->string_value) == 0);
-  }
-
-  return new_bool_value(convert_to_integer(left_value) == convert_to_integer(right_value));
-}
-
-
-Value *apply_check_not_equality_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_bool_value(((IntegerValue *) left_value)->integer_value != ((IntegerValue *) right_value)->integer_value);
-  }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
-
-    return new_bool_value(left_float != right_float);
-  }
-  else if (left_value->value_type == ValueTypeStringValue  && right_value->value_type == ValueTypeStringValue) {
-    return new_bool_value(strcmp(((StringValue *) left_value)->string_value, ((StringValue *) left_value)->string_value) == 0);
-  }
-
-  return new_bool_value(convert_to_integer(left_value) != convert_to_integer(right_value));
-}
-
-
-Value *apply_check_bigger_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_bool_value(((IntegerValue *) left_value)->integer_value > ((IntegerValue *) right_value)->integer_value);
-  }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
+// the left value is the one in the variable that is assigned, it is changed in place when nothing else sees it
+Value *apply_assign_operation(Value *left_value, Value *right_value, Operator operator) {
+  if (operator == ASSIGN_OP) return right_value;
 
-    return new_bool_value(left_float > right_float);
-  }
+  if (apply_in_place_operation(get_compound_assign_operator(operator), left_value, right_value)) return left_value;
 
-  return new_bool_value(convert_to_integer(left_value) > convert_to_integer(right_value));
+  return apply_infix_operation(get_compound_assign_operator(operator), left_value, right_value);
 }
 
 
-Value *apply_check_bigger_equal_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_bool_value(((IntegerValue *) left_value)->integer_value >= ((IntegerValue *) right_value)->integer_value);
-  }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
+// a variable read only as an operand is not shared, since the value is not kept, a call shares the arguments it binds
+Value *_evaluate_operand(Scope *scope, Expression *expression) {
+  if (expression->expression_type != ExpressionTypeIdentifierExpression) return evaluate_expression(scope, expression);
 
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
+  Variable *variable = _get_identifier_variable(scope, expression);
 
-    return new_bool_value(left_float >= right_float);
-  }
-
-  return new_bool_value(convert_to_integer(left_value) >= convert_to_integer(right_value));
+  return variable == NULL ? new_null_value() : variable->value;
 }
 
 
-Value *apply_check_smaller_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_bool_value(((IntegerValue *) left_value)->integer_value < ((IntegerValue *) right_value)->integer_value);
-  }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
-
-    return new_bool_value(left_float < right_float);
-  }
-
-  return new_bool_value(convert_to_integer(left_value) < convert_to_integer(right_value));
-}
+Value *_evaluate_array_expression(Scope *scope, ArrayExpression *array_expression, size_t operand_start) {
+  Value **items = memory_allocate_zeroed(MemorySubsystemValue, array_expression->expression_count, sizeof(Value *));
 
+  for (size_t i = 0; i < array_expression->expression_count; i++) {
+    if (i >= operand_start) items[i] = _evaluate_operand(scope, array_expression->expressions[i]);
+    else items[i] = evaluate_expression(scope, array_expression->expressions[i]);
 
-Value *apply_check_smaller_equal_operation(Value *left_value, Value *right_value) {
-  if (left_value->value_type == ValueTypeIntegerValue && right_value->value_type == ValueTypeIntegerValue) {
-    return new_bool_value(((IntegerValue *) left_value)->integer_value <= ((IntegerValue *) right_value)->integer_value);
+    // the items are not reachable from the array until it is allocated
+    gc_push_root(items[i]);
   }
-  else if ((left_value->value_type == ValueTypeIntegerValue || left_value->value_type == ValueTypeFloatValue) && (right_value->value_type == ValueTypeIntegerValue || right_value->value_type == ValueTypeFloatValue)) {
-    long double left_float, right_float;
-
-    if (left_value->value_type == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
-    else left_float = ((IntegerValue *) left_value)->integer_value;
-
-    if (right_value->value_type == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
-    else right_float = ((IntegerValue *) right_value)->integer_value;
 
-    return new_bool_value(left_float <= right_float);
+  if (array_expression->array_expression_type == ArrayExpressionTypeTuple) {
+    return new_tuple_value(items, array_expression->expression_count, array_expression->has_finished);
   }
 
-  return new_bool_value(convert_to_integer(left_value) <= convert_to_integer(right_value));
+  return new_list_value(items, array_expression->expression_count, array_expression->has_finished);
 }
 
 
 Value *evaluate_call_expression(Scope *scope, CallExpression *call_expression) {
   Value *identifier_value = evaluate_expression(scope, call_expression->identifier_expression);
-  Value *parameter_values = evaluate_expression(scope, call_expression->tuple_expression);
+
+  gc_push_root(identifier_value);
+
+  ArrayExpression *tuple_expression = (ArrayExpression *) call_expression->tuple_expression;
+  Value *parameter_values = _evaluate_array_expression(scope, tuple_expression, get_pure_arguments_start(tuple_expression));
 
   Value *result_value = new_null_value();
 
-  if (parameter_values->value_type == ValueTypeTupleValue) {
-    if (identifier_value->value_type == ValueTypeFunctionValue) {
+  if (get_value_type(parameter_values) == ValueTypeTupleValue) {
+    if (get_value_type(identifier_value) == ValueTypeFunctionValue) {
       result_value = call_function(scope, (FunctionValue *) identifier_value, (TupleValue *) parameter_values);
     }
-    if (identifier_value->value_type == ValueTypeSystemFunctionValue) {
+    if (get_value_type(identifier_value) == ValueTypeSystemFunctionValue) {
       result_value = call_system_function(scope, (SystemFunctionValue *) identifier_value, (TupleValue *) parameter_values);
     }
   }
 
-  free_value(identifier_value);
-  free_value(parameter_values);
+  // a system function may return a value it just unlinked, like the item removed by pop
+  gc_push_root(result_value);
 
   return result_value;
 }
@@ -532,9 +288,7 @@ Value *evaluate_infix_expression(Scope *scope, InfixExpression *infix_expression
     operator == ASSIGN_MOD_OP) {
 
     if (infix_expression->left_expression->expression_type == ExpressionTypeIdentifierExpression) {
-      char *identifier = ((StringLiteral *) infix_expression->left_expression->literal)->string_literal;
-
-      Variable *variable = scope_get_variable(scope, ValueTypeNullValue, identifier);
+      Variable *variable = _get_identifier_variable(scope, infix_expression->left_expression);
 
       left_value = new_null_value();
 
@@ -542,27 +296,28 @@ Value *evaluate_infix_expression(Scope *scope, InfixExpression *infix_expression
         left_value = variable->value;
       }
 
+      gc_push_root(left_value);
+
       right_value = evaluate_expression(scope, infix_expression->right_expression);
       result_value = apply_assign_operation(left_value, right_value, operator);
 
-      scope_set_variable(scope, ValueTypeNullValue, identifier, result_value, false);
-
-      free_value(right_value);
+      _set_identifier_value(scope, infix_expression->left_expression, result_value);
 
       return new_null_value();
     }
     else if (infix_expression->left_expression->expression_type == ExpressionTypeIndexExpression) {
       if (infix_expression->operator != ASSIGN_OP) {
         left_value = evaluate_expression(scope, infix_expression->left_expression);
+
+        gc_push_root(left_value);
       }
 
       right_value = evaluate_expression(scope, infix_expression->right_expression);
       result_value = apply_assign_operation(left_value, right_value, infix_expression->operator);
 
-      free_value(apply_index_operation(scope, (IndexExpression *) infix_expression->left_expression, result_value));
+      gc_push_root(result_value);
 
-      if (left_value != NULL) free_value(left_value);
-      free_value(right_value);
+      _evaluate_or_apply_index_operation(scope, (IndexExpression *) infix_expression->left_expression, result_value);
 
       return new_null_value();
     }
@@ -570,13 +325,11 @@ Value *evaluate_infix_expression(Scope *scope, InfixExpression *infix_expression
     return new_null_value();
   }
   else if (operator == MEMBER_OP) {
-    left_value = evaluate_expression(scope, infix_expression->left_expression);
+    left_value = _evaluate_operand(scope, infix_expression->left_expression);
 
     char *identifier = ((StringLiteral *) infix_expression->right_expression->literal)->string_literal;
 
-    Variable *variable = scope_get_variable(scope, left_value->value_type, identifier);
-
-    free_value(left_value);
+    Variable *variable = scope_get_variable(scope, get_value_type(left_value), identifier);
 
     if (variable == NULL) return new_null_value();
 
@@ -585,122 +338,22 @@ Value *evaluate_infix_expression(Scope *scope, InfixExpression *infix_expression
     return variable->value;
   }
 
-  left_value = evaluate_expression(scope, infix_expression->left_expression);
-  right_value = evaluate_expression(scope, infix_expression->right_expression);
-
-  switch (infix_expression->operator) {
-    case ADDITION_OP: {
-      result_value = apply_addition_operation(left_value, right_value);
-      break;
-    }
-
-    case SUBTRACTION_OP: {
-      result_value = apply_subtraction_operation(left_value, right_value);
-      break;
-    }
-
-    case MULTIPLICATION_OP: {
-      result_value = apply_multiplication_operation(left_value, right_value);
-      break;
-    }
-
-    case DIVISION_OP: {
-      result_value = apply_division_operation(left_value, right_value, false);
-      break;
-    }
-
-    case INTEGER_DIVISION_OP: {
-      result_value = apply_division_operation(left_value, right_value, true);
-      break;
-    }
-
-    case EXPONENT_OP: {
-      result_value = apply_exponent_operation(left_value, right_value);
-      break;
-    }
-
-    case MOD_OP: {
-      result_value = apply_mod_operation(left_value, right_value);
-      break;
-    }
-
-    case RANGE_OP: {
-      result_value = apply_range_operation(left_value, right_value);
-      break;
-    }
-
-    case CHECK_EQUALITY_OP: {
-      result_value = apply_check_equality_operation(left_value, right_value);
-      break;
-    }
-
-    case CHECK_NOT_EQUALITY_OP: {
-      result_value = apply_check_not_equality_operation(left_value, right_value);
-      break;
-    }
-
-    case CHECK_BIGGER_OP: {
-      result_value = apply_check_bigger_operation(left_value, right_value);
-      break;
-    }
+  // the left side may be read from a variable that the right side reassigns or changes in place
+  if (is_pure_expression(infix_expression->right_expression)) left_value = _evaluate_operand(scope, infix_expression->left_expression);
+  else left_value = evaluate_expression(scope, infix_expression->left_expression);
 
-    case CHECK_BIGGER_EQUAL_OP: {
-      result_value = apply_check_bigger_equal_operation(left_value, right_value);
-      break;
-    }
-
-    case CHECK_SMALLER_OP: {
-      result_value = apply_check_smaller_operation(left_value, right_value);
-      break;
-    }
-
-    case CHECK_SMALLER_EQUAL_OP: {
-      result_value = apply_check_smaller_equal_operation(left_value, right_value);
-      break;
-    }
-
-    default: {
-      result_value = new_null_value();
-    }
-  }
+  gc_push_root(left_value);
 
-  free_value(left_value);
-  free_value(right_value);
+  right_value = _evaluate_operand(scope, infix_expression->right_expression);
 
-  return result_value;
+  return apply_infix_operation(operator, left_value, right_value);
 }
 
 
 Value *evaluate_prefix_expression(Scope *scope, PrefixExpression *prefix_expression) {
-  Value *result_value;
+  Value *right_value = _evaluate_operand(scope, prefix_expression->right_expression);
 
-  Value *right_value = evaluate_expression(scope, prefix_expression->right_expression);
-
-  switch (prefix_expression->operator) {
-    case NOT_OP: {
-      result_value = apply_prefix_not_operation(right_value);
-      break;
-    }
-
-    case ADDITION_OP: {
-      result_value = apply_prefix_plus_operation(right_value);
-      break;
-    }
-
-    case SUBTRACTION_OP: {
-      result_value = apply_prefix_minus_operation(right_value);
-      break;
-    }
-
-    default: {
-      result_value = new_null_value();
-      break;
-    }
-  }
-
-  free_value(right_value);
-
-  return result_value;
+  return apply_prefix_operation(prefix_expression->operator, right_value);
 }
 
 
@@ -740,34 +393,21 @@ Value *evaluate_expression(Scope *scope, Expression *expression) {
       return evaluate_index_expression(scope, index_expression);
     }
 
+    // the items are kept by the array, so none of them is read as an operand
     case ExpressionTypeArrayExpression: {
       ArrayExpression *array_expression = (ArrayExpression *) expression;
 
-      Value **items = calloc(array_expression->expression_count, sizeof(Value *));
-
-      for (size_t i = 0; i < array_expression->expression_count; i++) {
-        items[i] = evaluate_expression(scope, array_expression->expressions[i]);
-        items[i]->linked_variable_count++;
-      }
-
-      if (array_expression->array_expression_type == ArrayExpressionTypeTuple) {
-        return new_tuple_value(items, array_expression->expression_count, array_expression->has_finished);
-      }
-      else if (array_expression->array_expression_type == ArrayExpressionTypeList) {
-        return new_list_value(items, array_expression->expression_count, array_expression->has_finished);
-      }
+      return _evaluate_array_expression(scope, array_expression, array_expression->expression_count);
     }
 
     case ExpressionTypeIdentifierExpression: {
-      StringLiteral *string_literal = (StringLiteral *) expression->literal;
-
-      Variable *variable = scope_get_variable(scope, ValueTypeNullValue, string_literal->string_literal);
+      Variable *variable = _get_identifier_variable(scope, expression);
 
       if (variable == NULL) {
         return new_null_value();
       }
 
-      return variable->value;
+      return share_value(variable->value);
     }
 
     case ExpressionTypeCallExpression: {
@@ -777,12 +417,12 @@ Value *evaluate_expression(Scope *scope, Expression *expression) {
     case ExpressionTypeFunctionExpression: {
       FunctionExpression *function_expression = (FunctionExpression *) expression;
 
-      FunctionValue *function_value = (FunctionValue *) new_function_value(function_expression->block, function_expression->arguments, function_expression->argument_count);
+      FunctionValue *function_value = (FunctionValue *) new_function_value(function_expression);
 
-      if (function_expression->identifier != NULL) {
-        char *function_name = ((StringLiteral *) function_expression->identifier->literal)->string_literal;
+      function_value->global_scope = scope->global_scope;
 
-        scope_set_variable(scope, ValueTypeNullValue, function_name, (Value *) function_value, false);
+      if (function_expression->identifier != NULL) {
+        _set_identifier_value(scope, function_expression->identifier, (Value *) function_value);
       }
 
       return (Value *) function_value;
@@ -792,6 +432,85 @@ Value *evaluate_expression(Scope *scope, Expression *expression) {
   return new_null_value();
 }
 
+// numeric ranges and arrays are walked in place, so an iteration only writes the loop variable and allocates nothing
+void _evaluate_for_in_block(Scope *block_scope, InfixExpression *in_infix_expression) {
+  Expression *iterated_expression = in_infix_expression->right_expression;
+  size_t root_count;
+
+  if (iterated_expression->expression_type == ExpressionTypeInfixExpression && ((InfixExpression *) iterated_expression)->operator == RANGE_OP) {
+    Value *start_value = evaluate_expression(block_scope, ((InfixExpression *) iterated_expression)->left_expression);
+
+    gc_push_root(start_value);
+
+    Value *end_value = evaluate_expression(block_scope, ((InfixExpression *) iterated_expression)->right_expression);
+
+    // a range of anything else is null, which is not iterated
+    if (get_value_type(start_value) != ValueTypeIntegerValue || get_value_type(end_value) != ValueTypeIntegerValue) return;
+
+    long long int index = get_integer_value(start_value);
+    long long int end_index = get_integer_value(end_value);
+    long long int step = index < end_index ? 1 : -1;
+
+    root_count = gc_save_roots();
+
+    for (; index != end_index; index += step) {
+      _set_identifier_value(block_scope, in_infix_expression->left_expression, new_integer_value(index));
+
+      evaluate_scope(block_scope);
+      gc_restore_roots(root_count);
+
+      if (block_scope->has_returned) break;
+    }
+
+    return;
+  }
+
+  Value *right_value = evaluate_expression(block_scope, iterated_expression);
+
+  // the iterated value may be read from a variable that the loop body reassigns
+  gc_push_root(right_value);
+
+  root_count = gc_save_roots();
+
+  if (get_value_type(right_value) == ValueTypeTupleValue || get_value_type(right_value) == ValueTypeListValue) {
+    size_t length;
+    size_t end_index = get_array_items(right_value, &length) == NULL ? 0 : length;
+
+    for (size_t index = 0; index < end_index; index++) {
+      Value **items = get_array_items(right_value, &length);
+
+      // a null item ends the iteration, as it does for a generator
+      if (index >= length || get_value_type(items[index]) == ValueTypeNullValue) break;
+
+      // the item stays in the container, so the loop variable must not change it in place
+      _set_identifier_value(block_scope, in_infix_expression->left_expression, share_value(items[index]));
+
+      evaluate_scope(block_scope);
+      gc_restore_roots(root_count);
+
+      if (block_scope->has_returned) break;
+    }
+
+    return;
+  }
+
+  // values that can not be iterated are null, which is not a heap value to read from
+  if (get_value_type(right_value) != ValueTypeGeneratorValue) return;
+
+  GeneratorValue *generator_value = (GeneratorValue *) right_value;
+  Value *for_block_value;
+
+  while (get_value_type(for_block_value = fetch_value_from_generator_value(generator_value)) != ValueTypeNullValue) {
+    _set_identifier_value(block_scope, in_infix_expression->left_expression, for_block_value);
+
+    evaluate_scope(block_scope);
+    gc_restore_roots(root_count);
+
+    if (block_scope->has_returned) break;
+  }
+}
+
+
 // return value means if true move on
 bool evaluate_block_definition(Scope *scope, BlockDefinition *block_definition) {
   Scope *block_scope = NULL;
@@ -821,17 +540,16 @@ bool evaluate_block_definition(Scope *scope, BlockDefinition *block_definition)
       block_scope = new_scope(scope, if_block_definition->block, ScopeTypeNormalScope);
 
       if (if_block_definition->pre_expression != NULL) {
-        free_value(evaluate_expression(block_scope, if_block_definition->pre_expression));
+        evaluate_expression(block_scope, if_block_definition->pre_expression);
       }
 
       Value *condition_value = evaluate_expression(block_scope, if_block_definition->condition);
       bool condition = convert_to_bool(condition_value);
 
       if (condition) {
-        free_value(evaluate_scope(block_scope));
+        evaluate_scope(block_scope);
       }
 
-      free_value(condition_value);
       free_scope(block_scope);
 
       return condition;
@@ -842,7 +560,7 @@ bool evaluate_block_definition(Scope *scope, BlockDefinition *block_definition)
 
       block_scope = new_scope(scope, else_block_definition->block, ScopeTypeNormalScope);
 
-      free_value(evaluate_scope(block_scope));
+      evaluate_scope(block_scope);
       free_scope(block_scope);
 
       return true;
@@ -854,54 +572,31 @@ bool evaluate_block_definition(Scope *scope, BlockDefinition *block_definition)
       block_scope = new_scope(scope, for_block_definition->block, ScopeTypeNormalScope);
 
       if (for_block_definition->pre_expression != NULL) {
-        free_value(evaluate_expression(block_scope, for_block_definition->pre_expression));
+        evaluate_expression(block_scope, for_block_definition->pre_expression);
       }
 
       if (for_block_definition->condition->expression_type == ExpressionTypeInfixExpression && (((InfixExpression *) for_block_definition->condition)->operator == IN_OP)) {
         InfixExpression *in_infix_expression = (InfixExpression *) for_block_definition->condition;
 
-        char *identifier = ((StringLiteral *) in_infix_expression->left_expression->literal)->string_literal;
+        _evaluate_for_in_block(block_scope, in_infix_expression);
 
-        Value *right_value = evaluate_expression(block_scope, in_infix_expression->right_expression);
-        GeneratorValue *generator_value;
-
-        if (right_value->value_type == ValueTypeGeneratorValue) {
-          generator_value = (GeneratorValue *) right_value;
-          right_value = NULL;
-        }
-        else {
-          generator_value = (GeneratorValue *) convert_to_generator_value(right_value);
-        }
-
-        Value *for_block_value;
-
-        while ((for_block_value = fetch_value_from_generator_value(generator_value))->value_type != ValueTypeNullValue) {
-          scope_set_variable(block_scope, ValueTypeNullValue, identifier, for_block_value, false);
-
-          free_value(evaluate_scope(block_scope));
-        }
-
-        free_value((Value *) generator_value);
-        if (right_value != NULL) free_value(right_value);
         free_scope(block_scope);
       }
       else {
-        Value *condition_value = evaluate_expression(block_scope, for_block_definition->condition);
+        size_t root_count = gc_save_roots();
 
-        while (convert_to_bool(condition_value)) {
-          free_value(condition_value);
+        while (convert_to_bool(evaluate_expression(block_scope, for_block_definition->condition))) {
+          evaluate_scope(block_scope);
 
-          Value *value = evaluate_scope(block_scope);
-          free_value(value);
+          if (block_scope->has_returned) break;
 
           if (for_block_definition->post_expression != NULL) {
-            free_value(evaluate_expression(block_scope, for_block_definition->post_expression));
+            evaluate_expression(block_scope, for_block_definition->post_expression);
           }
 
-          condition_value = evaluate_expression(block_scope, for_block_definition->condition);
+          gc_restore_roots(root_count);
         }
 
-        free_value(condition_value);
         free_scope(block_scope);
       }
 
@@ -915,20 +610,32 @@ bool evaluate_block_definition(Scope *scope, BlockDefinition *block_definition)
 }
 
 
+// a bare name imports the script of that name, anything else has to evaluate to a path
+Module *_import_module(Scope *scope, Expression *expression) {
+  if (expression->expression_type == ExpressionTypeIdentifierExpression) {
+    return import_module(((StringLiteral *) expression->literal)->string_literal);
+  }
+
+  Value *value = evaluate_expression(scope, expression);
+
+  if (get_value_type(value) != ValueTypeStringValue) return NULL;
+
+  return import_module(get_string_chars((StringValue *) value));
+}
+
+
 bool evaluate_statement(Scope *scope, Statement *statement, bool print_if_not_null) {
 
   switch (statement->statement_type) {
     case StatementTypeExpressionStatement: {
       Value *value = evaluate_expression(scope, ((ExpressionStatement *) statement)->expression);
 
-      if (print_if_not_null && value->value_type != ValueTypeNullValue) {
+      if (print_if_not_null && get_value_type(value) != ValueTypeNullValue) {
         char *s = convert_to_string(value);
         printf("%s\n", s);
-        free(s);
+        memory_free(s);
       }
 
-      free_value(value);
-
       return true;
     }
 
@@ -939,7 +646,9 @@ bool evaluate_statement(Scope *scope, Statement *statement, bool print_if_not_nu
     }
 
     case StatementTypeImportStatement: {
-      ImportStatement *import_statement = (ImportStatement *) statement;
+      Module *module = _import_module(scope, ((ImportStatement *) statement)->right_expression);
+
+      if (module != NULL) bind_module(scope, module);
 
       return true;
     }
@@ -963,7 +672,13 @@ bool evaluate_statement(Scope *scope, Statement *statement, bool print_if_not_nu
 
 Value *evaluate_scope(Scope *scope) {
   for (size_t i = 0; i < scope->block->statement_count; i++) {
-    if (!evaluate_statement(scope, scope->block->statements[i], false)) break;
+    // the temporaries of a statement are unreachable once it has been evaluated
+    size_t root_count = gc_save_roots();
+    bool should_continue = evaluate_statement(scope, scope->block->statements[i], false);
+
+    gc_restore_roots(root_count);
+
+    if (!should_continue || scope->has_returned) break;
   }
 
   return scope->return_value;
@@ -974,9 +689,10 @@ void evaluate_ast(AST *ast) {
   Scope *main_scope = new_scope(NULL, ast->block, ScopeTypeNormalScope);
 
   build_main_scope(main_scope);
+  register_main_module(main_scope);
 
-  Value *value = evaluate_scope(main_scope);
+  evaluate_scope(main_scope);
 
-  free_value(value);
   free_scope(main_scope);
+  gc_collect();
 }
\ No newline at end of file
@@ -5,6 +5,16 @@
 #include "ast.h"
 #include "scope.h"
 #include "value.h"
+#include "operation.h"
+
+Value *apply_prefix_operation(Operator operator, Value *right_value);
+
+
+Value *apply_index_operation(Value *left_value, Value *right_value, Value *assign_value);
+
+
+Value *apply_assign_operation(Value *left_value, Value *right_value, Operator operator);
+
 
 Value *evaluate_call_expression(Scope *scope, CallExpression *call_expression);
 
@@ -0,0 +1,941 @@
+#include "flat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "lexer.h"
+#include "symbol.h"
+#include "memory.h"
+
+// the tree is flattened before it is resolved, the resolver runs again on the rebuilt tree
+
+#define FLAT_MIN_CAPACITY 64
+
+
+void *_grow_flat_array(void *items, size_t *capacity, size_t length, size_t item_size) {
+  if (length <= *capacity) return items;
+
+  while (*capacity < length) {
+    *capacity = *capacity == 0 ? FLAT_MIN_CAPACITY : *capacity * 2;
+  }
+
+  return memory_reallocate(MemorySubsystemCache, items, *capacity * item_size);
+}
+
+
+FlatIndex _add_node(FlatAST *flat_ast, FlatNodeType node_type, uint8_t operator, FlatIndex first, FlatIndex count) {
+  flat_ast->nodes = _grow_flat_array(flat_ast->nodes, &flat_ast->node_capacity, flat_ast->node_count + 1, sizeof(FlatNode));
+  flat_ast->nodes[flat_ast->node_count] = (FlatNode) {.node_type = node_type, .operator = operator, .first = first, .count = count};
+
+  return (FlatIndex) flat_ast->node_count++;
+}
+
+
+// the run of children is reserved before they are flattened, so the children of a node stay next to each other
+FlatIndex _reserve_children(FlatAST *flat_ast, size_t count) {
+  size_t first = flat_ast->child_count;
+
+  flat_ast->child_count += count;
+  flat_ast->children = _grow_flat_array(flat_ast->children, &flat_ast->child_capacity, flat_ast->child_count, sizeof(FlatIndex));
+
+  return (FlatIndex) first;
+}
+
+
+// the child is flattened first, since flattening it can move the children array
+void _set_child(FlatAST *flat_ast, size_t i, FlatIndex child) {
+  flat_ast->children[i] = child;
+}
+
+
+FlatIndex _add_string(FlatAST *flat_ast, char *string, size_t length) {
+  size_t offset = flat_ast->string_length;
+
+  flat_ast->string_length += length + 1;
+  flat_ast->strings = _grow_flat_array(flat_ast->strings, &flat_ast->string_capacity, flat_ast->string_length, sizeof(char));
+
+  memcpy(flat_ast->strings + offset, string, length);
+  flat_ast->strings[offset + length] = 0;
+
+  return (FlatIndex) offset;
+}
+
+
+FlatIndex _add_string_node(FlatAST *flat_ast, FlatNodeType node_type, StringLiteral *string_literal) {
+  FlatIndex offset = _add_string(flat_ast, string_literal->string_literal, string_literal->length);
+
+  return _add_node(flat_ast, node_type, 0, offset, (FlatIndex) string_literal->length);
+}
+
+
+FlatIndex _flatten_block(FlatAST *flat_ast, Block *block);
+
+
+FlatIndex _flatten_expression(FlatAST *flat_ast, Expression *expression) {
+  if (expression == NULL) return FLAT_NULL_INDEX;
+
+  switch (expression->expression_type) {
+    case ExpressionTypeNullExpression: {
+      return _add_node(flat_ast, FlatNodeTypeNullExpression, 0, 0, 0);
+    }
+
+    case ExpressionTypeBoolExpression: {
+      return _add_node(flat_ast, FlatNodeTypeBoolExpression, 0, ((BoolLiteral *) expression->literal)->bool_literal, 0);
+    }
+
+    case ExpressionTypeIntegerExpression: {
+      flat_ast->integers = _grow_flat_array(flat_ast->integers, &flat_ast->integer_capacity, flat_ast->integer_count + 1, sizeof(long long int));
+      flat_ast->integers[flat_ast->integer_count] = ((IntegerLiteral *) expression->literal)->integer_literal;
+
+      return _add_node(flat_ast, FlatNodeTypeIntegerExpression, 0, (FlatIndex) flat_ast->integer_count++, 0);
+    }
+
+    case ExpressionTypeFloatExpression: {
+      flat_ast->floats = _grow_flat_array(flat_ast->floats, &flat_ast->float_capacity, flat_ast->float_count + 1, sizeof(long double));
+      // the padding of a long double is cleared, so a flat ast written out is the same for the same script
+      memset(&flat_ast->floats[flat_ast->float_count], 0, sizeof(long double));
+      flat_ast->floats[flat_ast->float_count] = ((FloatLiteral *) expression->literal)->float_literal;
+
+      return _add_node(flat_ast, FlatNodeTypeFloatExpression, 0, (FlatIndex) flat_ast->float_count++, 0);
+    }
+
+    case ExpressionTypeStringExpression: {
+      return _add_string_node(flat_ast, FlatNodeTypeStringExpression, (StringLiteral *) expression->literal);
+    }
+
+    case ExpressionTypeIdentifierExpression: {
+      return _add_string_node(flat_ast, FlatNodeTypeIdentifierExpression, (StringLiteral *) expression->literal);
+    }
+
+    case ExpressionTypeInfixExpression: {
+      InfixExpression *infix_expression = (InfixExpression *) expression;
+      FlatIndex first = _reserve_children(flat_ast, 2);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, infix_expression->left_expression));
+      _set_child(flat_ast, first + 1, _flatten_expression(flat_ast, infix_expression->right_expression));
+
+      return _add_node(flat_ast, FlatNodeTypeInfixExpression, (uint8_t) infix_expression->operator, first, 2);
+    }
+
+    case ExpressionTypePrefixExpression: {
+      PrefixExpression *prefix_expression = (PrefixExpression *) expression;
+      FlatIndex first = _reserve_children(flat_ast, 1);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, prefix_expression->right_expression));
+
+      return _add_node(flat_ast, FlatNodeTypePrefixExpression, (uint8_t) prefix_expression->operator, first, 1);
+    }
+
+    case ExpressionTypeIndexExpression: {
+      IndexExpression *index_expression = (IndexExpression *) expression;
+      FlatIndex first = _reserve_children(flat_ast, 2);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, index_expression->left_expression));
+      _set_child(flat_ast, first + 1, _flatten_expression(flat_ast, index_expression->right_expression));
+
+      return _add_node(flat_ast, FlatNodeTypeIndexExpression, 0, first, 2);
+    }
+
+    case ExpressionTypeCallExpression: {
+      CallExpression *call_expression = (CallExpression *) expression;
+      FlatIndex first = _reserve_children(flat_ast, 2);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, call_expression->identifier_expression));
+      _set_child(flat_ast, first + 1, _flatten_expression(flat_ast, call_expression->tuple_expression));
+
+      return _add_node(flat_ast, FlatNodeTypeCallExpression, 0, first, 2);
+    }
+
+    case ExpressionTypeArrayExpression: {
+      ArrayExpression *array_expression = (ArrayExpression *) expression;
+      FlatIndex first = _reserve_children(flat_ast, array_expression->expression_count);
+
+      for (size_t i = 0; i < array_expression->expression_count; i++) {
+        _set_child(flat_ast, first + i, _flatten_expression(flat_ast, array_expression->expressions[i]));
+      }
+
+      return _add_node(flat_ast, FlatNodeTypeArrayExpression, (uint8_t) array_expression->array_expression_type, first, (FlatIndex) array_expression->expression_count);
+    }
+
+    // the identifier and the block come before the arguments
+    case ExpressionTypeFunctionExpression: {
+      FunctionExpression *function_expression = (FunctionExpression *) expression;
+      FlatIndex first = _reserve_children(flat_ast, 2 + function_expression->argument_count);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, function_expression->identifier));
+      _set_child(flat_ast, first + 1, _flatten_block(flat_ast, function_expression->block));
+
+      for (size_t i = 0; i < function_expression->argument_count; i++) {
+        char *argument = function_expression->arguments[i];
+
+        _set_child(flat_ast, first + 2 + i, _add_node(flat_ast, FlatNodeTypeIdentifierExpression, 0, _add_string(flat_ast, argument, strlen(argument)), (FlatIndex) strlen(argument)));
+      }
+
+      return _add_node(flat_ast, FlatNodeTypeFunctionExpression, 0, first, (FlatIndex) (2 + function_expression->argument_count));
+    }
+  }
+
+  return FLAT_NULL_INDEX;
+}
+
+
+FlatIndex _flatten_block_definition(FlatAST *flat_ast, BlockDefinition *block_definition) {
+  if (block_definition == NULL) return FLAT_NULL_INDEX;
+
+  switch (block_definition->block_definition_type) {
+    // the else block comes before the if blocks
+    case BlockDefinitionTypeIfElseGroupBlock: {
+      IfElseGroupBlockDefinition *if_else_group_block_definition = (IfElseGroupBlockDefinition *) block_definition;
+      size_t length = if_else_group_block_definition->if_block_definitions_length;
+      FlatIndex first = _reserve_children(flat_ast, 1 + length);
+
+      _set_child(flat_ast, first, _flatten_block_definition(flat_ast, (BlockDefinition *) if_else_group_block_definition->else_block_definition));
+
+      for (size_t i = 0; i < length; i++) {
+        _set_child(flat_ast, first + 1 + i, _flatten_block_definition(flat_ast, (BlockDefinition *) if_else_group_block_definition->if_block_definitions[i]));
+      }
+
+      return _add_node(flat_ast, FlatNodeTypeIfElseGroupBlock, 0, first, (FlatIndex) (1 + length));
+    }
+
+    case BlockDefinitionTypeIfBlock: {
+      IfBlockDefinition *if_block_definition = (IfBlockDefinition *) block_definition;
+      FlatIndex first = _reserve_children(flat_ast, 3);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, if_block_definition->pre_expression));
+      _set_child(flat_ast, first + 1, _flatten_expression(flat_ast, if_block_definition->condition));
+      _set_child(flat_ast, first + 2, _flatten_block(flat_ast, if_block_definition->block));
+
+      return _add_node(flat_ast, FlatNodeTypeIfBlock, 0, first, 3);
+    }
+
+    case BlockDefinitionTypeElseBlock: {
+      FlatIndex first = _reserve_children(flat_ast, 1);
+
+      _set_child(flat_ast, first, _flatten_block(flat_ast, ((ElseBlockDefinition *) block_definition)->block));
+
+      return _add_node(flat_ast, FlatNodeTypeElseBlock, 0, first, 1);
+    }
+
+    case BlockDefinitionTypeForBlock: {
+      ForBlockDefinition *for_block_definition = (ForBlockDefinition *) block_definition;
+      FlatIndex first = _reserve_children(flat_ast, 4);
+
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, for_block_definition->pre_expression));
+      _set_child(flat_ast, first + 1, _flatten_expression(flat_ast, for_block_definition->condition));
+      _set_child(flat_ast, first + 2, _flatten_expression(flat_ast, for_block_definition->post_expression));
+      _set_child(flat_ast, first + 3, _flatten_block(flat_ast, for_block_definition->block));
+
+      return _add_node(flat_ast, FlatNodeTypeForBlock, 0, first, 4);
+    }
+  }
+
+  return FLAT_NULL_INDEX;
+}
+
+
+FlatIndex _flatten_statement(FlatAST *flat_ast, Statement *statement) {
+  FlatIndex first = _reserve_children(flat_ast, 1);
+  FlatNodeType node_type;
+
+  switch (statement->statement_type) {
+    case StatementTypeExpressionStatement: {
+      node_type = FlatNodeTypeExpressionStatement;
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, ((ExpressionStatement *) statement)->expression));
+      break;
+    }
+
+    case StatementTypeReturnStatement: {
+      node_type = FlatNodeTypeReturnStatement;
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, ((ReturnStatement *) statement)->right_expression));
+      break;
+    }
+
+    case StatementTypeImportStatement: {
+      node_type = FlatNodeTypeImportStatement;
+      _set_child(flat_ast, first, _flatten_expression(flat_ast, ((ImportStatement *) statement)->right_expression));
+      break;
+    }
+
+    default: {
+      node_type = FlatNodeTypeBlockDefinitionStatement;
+      _set_child(flat_ast, first, _flatten_block_definition(flat_ast, ((BlockDefinitionStatement *) statement)->block_definition));
+      break;
+    }
+  }
+
+  return _add_node(flat_ast, node_type, 0, first, 1);
+}
+
+
+FlatIndex _flatten_block(FlatAST *flat_ast, Block *block) {
+  FlatIndex first = _reserve_children(flat_ast, block->statement_count);
+
+  for (size_t i = 0; i < block->statement_count; i++) {
+    _set_child(flat_ast, first + i, _flatten_statement(flat_ast, block->statements[i]));
+  }
+
+  return _add_node(flat_ast, FlatNodeTypeBlock, 0, first, (FlatIndex) block->statement_count);
+}
+
+
+FlatAST *flatten_ast(AST *ast) {
+  FlatAST *flat_ast = memory_allocate_zeroed(MemorySubsystemCache, 1, sizeof(FlatAST));
+
+  flat_ast->root = _flatten_block(flat_ast, ast->block);
+
+  return flat_ast;
+}
+
+
+FlatIndex _get_child(FlatAST *flat_ast, FlatNode *node, size_t i) {
+  return flat_ast->children[node->first + i];
+}
+
+
+Block *_unflatten_block(FlatAST *flat_ast, Arena *arena, FlatIndex index);
+
+
+StringLiteral *_unflatten_string_literal(FlatAST *flat_ast, Arena *arena, FlatNode *node, bool is_symbol) {
+  StringLiteral *string_literal = arena_allocate(arena, sizeof(StringLiteral));
+  char *string = flat_ast->strings + node->first;
+
+  string_literal->literal = (Literal) {.literal_type = LiteralTypeStringLiteral};
+  string_literal->string_literal = is_symbol ? intern_symbol(string, node->count) : arena_copy_buffer(arena, string, node->count);
+  string_literal->length = node->count;
+
+  return string_literal;
+}
+
+
+Expression *_unflatten_expression(FlatAST *flat_ast, Arena *arena, FlatIndex index) {
+  if (index == FLAT_NULL_INDEX) return NULL;
+
+  FlatNode *node = &flat_ast->nodes[index];
+
+  switch (node->node_type) {
+    case FlatNodeTypeBoolExpression: {
+      BoolLiteral *bool_literal = arena_allocate(arena, sizeof(BoolLiteral));
+
+      bool_literal->literal = (Literal) {.literal_type = LiteralTypeBoolLiteral};
+      bool_literal->bool_literal = node->first != 0;
+
+      return eval_token(arena, (Token) {.token_type = BOOL_TOKEN, .literal = (Literal *) bool_literal});
+    }
+
+    case FlatNodeTypeIntegerExpression: {
+      IntegerLiteral *integer_literal = arena_allocate(arena, sizeof(IntegerLiteral));
+
+      integer_literal->literal = (Literal) {.literal_type = LiteralTypeIntegerLiteral};
+      integer_literal->integer_literal = flat_ast->integers[node->first];
+
+      return eval_token(arena, (Token) {.token_type = INTEGER_TOKEN, .literal = (Literal *) integer_literal});
+    }
+
+    case FlatNodeTypeFloatExpression: {
+      FloatLiteral *float_literal = arena_allocate(arena, sizeof(FloatLiteral));
+
+      float_literal->literal = (Literal) {.literal_type = LiteralTypeFloatLiteral};
+      float_literal->float_literal = flat_ast->floats[node->first];
+
+      return eval_token(arena, (Token) {.token_type = FLOAT_TOKEN, .literal = (Literal *) float_literal});
+    }
+
+    case FlatNodeTypeStringExpression: {
+      return eval_token(arena, (Token) {.token_type = STRING_LITERAL_TOKEN, .literal = (Literal *) _unflatten_string_literal(flat_ast, arena, node, false)});
+    }
+
+    case FlatNodeTypeIdentifierExpression: {
+      return eval_token(arena, (Token) {.token_type = IDENTIFIER_TOKEN, .literal = (Literal *) _unflatten_string_literal(flat_ast, arena, node, true)});
+    }
+
+    case FlatNodeTypeInfixExpression: {
+      InfixExpression *infix_expression = arena_allocate(arena, sizeof(InfixExpression));
+
+      infix_expression->expression = (Expression) {.expression_type = ExpressionTypeInfixExpression};
+      infix_expression->operator = (Operator) node->operator;
+      infix_expression->left_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+      infix_expression->right_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 1));
+
+      return (Expression *) infix_expression;
+    }
+
+    case FlatNodeTypePrefixExpression: {
+      PrefixExpression *prefix_expression = arena_allocate(arena, sizeof(PrefixExpression));
+
+      prefix_expression->expression = (Expression) {.expression_type = ExpressionTypePrefixExpression};
+      prefix_expression->operator = (Operator) node->operator;
+      prefix_expression->right_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+
+      return (Expression *) prefix_expression;
+    }
+
+    case FlatNodeTypeIndexExpression: {
+      IndexExpression *index_expression = arena_allocate(arena, sizeof(IndexExpression));
+
+      index_expression->expression = (Expression) {.expression_type = ExpressionTypeIndexExpression};
+      index_expression->left_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+      index_expression->right_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 1));
+
+      return (Expression *) index_expression;
+    }
+
+    case FlatNodeTypeCallExpression: {
+      CallExpression *call_expression = arena_allocate(arena, sizeof(CallExpression));
+
+      call_expression->expression = (Expression) {.expression_type = ExpressionTypeCallExpression};
+      call_expression->identifier_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+      call_expression->tuple_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 1));
+
+      return (Expression *) call_expression;
+    }
+
+    case FlatNodeTypeArrayExpression: {
+      ArrayExpression *array_expression = arena_allocate(arena, sizeof(ArrayExpression));
+
+      array_expression->expression = (Expression) {.expression_type = ExpressionTypeArrayExpression};
+      array_expression->expression_count = node->count;
+      array_expression->expressions = arena_allocate(arena, node->count * sizeof(Expression *));
+      array_expression->array_expression_type = (ArrayExpressionType) node->operator;
+      array_expression->has_finished = true;
+
+      for (size_t i = 0; i < node->count; i++) {
+        array_expression->expressions[i] = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, i));
+      }
+
+      return (Expression *) array_expression;
+    }
+
+    case FlatNodeTypeFunctionExpression: {
+      FunctionExpression *function_expression = arena_allocate(arena, sizeof(FunctionExpression));
+
+      function_expression->expression = (Expression) {.expression_type = ExpressionTypeFunctionExpression};
+      function_expression->identifier = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+      function_expression->block = _unflatten_block(flat_ast, arena, _get_child(flat_ast, node, 1));
+      function_expression->argument_count = node->count - 2;
+      function_expression->body = NULL;
+      function_expression->body_length = 0;
+      function_expression->global_slot_count = 0;
+      function_expression->should_optimize = false;
+      function_expression->arena = arena;
+      function_expression->arguments = arena_allocate(arena, function_expression->argument_count * sizeof(char *));
+
+      for (size_t i = 0; i < function_expression->argument_count; i++) {
+        FlatNode *argument = &flat_ast->nodes[_get_child(flat_ast, node, 2 + i)];
+
+        function_expression->arguments[i] = intern_symbol(flat_ast->strings + argument->first, argument->count);
+      }
+
+      return (Expression *) function_expression;
+    }
+
+    default: {
+      return eval_token(arena, (Token) {.token_type = NULL_TOKEN});
+    }
+  }
+}
+
+
+BlockDefinition *_unflatten_block_definition(FlatAST *flat_ast, Arena *arena, FlatIndex index) {
+  if (index == FLAT_NULL_INDEX) return NULL;
+
+  FlatNode *node = &flat_ast->nodes[index];
+
+  switch (node->node_type) {
+    case FlatNodeTypeIfElseGroupBlock: {
+      IfElseGroupBlockDefinition *if_else_group_block_definition = arena_allocate(arena, sizeof(IfElseGroupBlockDefinition));
+
+      if_else_group_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeIfElseGroupBlock};
+      if_else_group_block_definition->else_block_definition = (ElseBlockDefinition *) _unflatten_block_definition(flat_ast, arena, _get_child(flat_ast, node, 0));
+      if_else_group_block_definition->if_block_definitions_length = node->count - 1;
+      if_else_group_block_definition->if_block_definitions = arena_allocate(arena, (node->count - 1) * sizeof(IfBlockDefinition *));
+
+      for (size_t i = 1; i < node->count; i++) {
+        if_else_group_block_definition->if_block_definitions[i - 1] = (IfBlockDefinition *) _unflatten_block_definition(flat_ast, arena, _get_child(flat_ast, node, i));
+      }
+
+      return (BlockDefinition *) if_else_group_block_definition;
+    }
+
+    case FlatNodeTypeIfBlock: {
+      IfBlockDefinition *if_block_definition = arena_allocate(arena, sizeof(IfBlockDefinition));
+
+      if_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeIfBlock};
+      if_block_definition->pre_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+      if_block_definition->condition = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 1));
+      if_block_definition->block = _unflatten_block(flat_ast, arena, _get_child(flat_ast, node, 2));
+
+      return (BlockDefinition *) if_block_definition;
+    }
+
+    case FlatNodeTypeElseBlock: {
+      ElseBlockDefinition *else_block_definition = arena_allocate(arena, sizeof(ElseBlockDefinition));
+
+      else_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeElseBlock};
+      else_block_definition->block = _unflatten_block(flat_ast, arena, _get_child(flat_ast, node, 0));
+
+      return (BlockDefinition *) else_block_definition;
+    }
+
+    case FlatNodeTypeForBlock: {
+      ForBlockDefinition *for_block_definition = arena_allocate(arena, sizeof(ForBlockDefinition));
+
+      for_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeForBlock};
+      for_block_definition->pre_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 0));
+      for_block_definition->condition = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 1));
+      for_block_definition->post_expression = _unflatten_expression(flat_ast, arena, _get_child(flat_ast, node, 2));
+      for_block_definition->block = _unflatten_block(flat_ast, arena, _get_child(flat_ast, node, 3));
+
+      return (BlockDefinition *) for_block_definition;
+    }
+
+    default: {
+      return NULL;
+    }
+  }
+}
+
+
+Statement *_unflatten_statement(FlatAST *flat_ast, Arena *arena, FlatIndex index) {
+  FlatNode *node = &flat_ast->nodes[index];
+  FlatIndex child = _get_child(flat_ast, node, 0);
+
+  switch (node->node_type) {
+    case FlatNodeTypeReturnStatement:
+    case FlatNodeTypeImportStatement: {
+      ReturnStatement *return_statement = arena_allocate(arena, sizeof(ReturnStatement));
+
+      return_statement->statement = (Statement) {.statement_type = node->node_type == FlatNodeTypeReturnStatement ? StatementTypeReturnStatement : StatementTypeImportStatement};
+      return_statement->right_expression = _unflatten_expression(flat_ast, arena, child);
+
+      return (Statement *) return_statement;
+    }
+
+    case FlatNodeTypeBlockDefinitionStatement: {
+      BlockDefinitionStatement *block_definition_statement = arena_allocate(arena, sizeof(BlockDefinitionStatement));
+
+      block_definition_statement->statement = (Statement) {.statement_type = StatementTypeBlockDefinitionStatement};
+      block_definition_statement->block_definition = _unflatten_block_definition(flat_ast, arena, child);
+
+      return (Statement *) block_definition_statement;
+    }
+
+    default: {
+      ExpressionStatement *expression_statement = arena_allocate(arena, sizeof(ExpressionStatement));
+
+      expression_statement->statement = (Statement) {.statement_type = StatementTypeExpressionStatement};
+      expression_statement->expression = _unflatten_expression(flat_ast, arena, child);
+
+      return (Statement *) expression_statement;
+    }
+  }
+}
+
+
+Block *_unflatten_block(FlatAST *flat_ast, Arena *arena, FlatIndex index) {
+  FlatNode *node = &flat_ast->nodes[index];
+  Block *block = new_block(arena);
+
+  block->statement_count = node->count;
+  block->statements = arena_allocate(arena, node->count * sizeof(Statement *));
+
+  for (size_t i = 0; i < node->count; i++) {
+    block->statements[i] = _unflatten_statement(flat_ast, arena, _get_child(flat_ast, node, i));
+  }
+
+  return block;
+}
+
+
+// a child always comes before its node, which also keeps a bad file from making a cycle
+bool _is_valid_child(FlatAST *flat_ast, FlatIndex index, size_t i, FlatNodeType min_node_type, FlatNodeType max_node_type, bool is_optional) {
+  FlatIndex child = _get_child(flat_ast, &flat_ast->nodes[index], i);
+
+  if (child == FLAT_NULL_INDEX) return is_optional;
+  if (child >= index) return false;
+
+  return flat_ast->nodes[child].node_type >= min_node_type && flat_ast->nodes[child].node_type <= max_node_type;
+}
+
+
+bool _are_valid_children(FlatAST *flat_ast, FlatIndex index, size_t first, FlatNodeType min_node_type, FlatNodeType max_node_type, bool is_optional) {
+  for (size_t i = first; i < flat_ast->nodes[index].count; i++) {
+    if (!_is_valid_child(flat_ast, index, i, min_node_type, max_node_type, is_optional)) return false;
+  }
+
+  return true;
+}
+
+
+// the parser only makes an infix, index or call expression after its left side
+bool _is_valid_binary_node(FlatAST *flat_ast, FlatIndex index) {
+  return flat_ast->nodes[index].count == 2
+    && _is_valid_child(flat_ast, index, 0, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, false)
+    && _is_valid_child(flat_ast, index, 1, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true);
+}
+
+
+// checks one node against the shape unflatten_ast expects, every index it reads has to be inside its pool
+bool _is_valid_node(FlatAST *flat_ast, FlatIndex index) {
+  FlatNode *node = &flat_ast->nodes[index];
+
+  if (node->node_type >= FlatNodeTypeInfixExpression && (size_t) node->first + node->count > flat_ast->child_count) return false;
+
+  switch (node->node_type) {
+    case FlatNodeTypeNullExpression:
+    case FlatNodeTypeBoolExpression: {
+      return true;
+    }
+
+    case FlatNodeTypeIntegerExpression: {
+      return node->first < flat_ast->integer_count;
+    }
+
+    case FlatNodeTypeFloatExpression: {
+      return node->first < flat_ast->float_count;
+    }
+
+    // the string is followed by its terminator
+    case FlatNodeTypeStringExpression:
+    case FlatNodeTypeIdentifierExpression: {
+      return (size_t) node->first + node->count < flat_ast->string_length;
+    }
+
+    case FlatNodeTypePrefixExpression: {
+      if (node->operator == 0 || node->operator >= OPERATOR_COUNT) return false;
+
+      return node->count == 1 && _is_valid_child(flat_ast, index, 0, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true);
+    }
+
+    case FlatNodeTypeInfixExpression: {
+      if (node->operator == 0 || node->operator >= OPERATOR_COUNT) return false;
+
+      return _is_valid_binary_node(flat_ast, index);
+    }
+
+    case FlatNodeTypeIndexExpression:
+    case FlatNodeTypeCallExpression: {
+      return _is_valid_binary_node(flat_ast, index);
+    }
+
+    case FlatNodeTypeArrayExpression: {
+      if (node->operator != ArrayExpressionTypeList && node->operator != ArrayExpressionTypeTuple) return false;
+
+      return _are_valid_children(flat_ast, index, 0, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true);
+    }
+
+    case FlatNodeTypeFunctionExpression: {
+      return node->count >= 2
+        && _is_valid_child(flat_ast, index, 0, FlatNodeTypeIdentifierExpression, FlatNodeTypeIdentifierExpression, true)
+        && _is_valid_child(flat_ast, index, 1, FlatNodeTypeBlock, FlatNodeTypeBlock, false)
+        && _are_valid_children(flat_ast, index, 2, FlatNodeTypeIdentifierExpression, FlatNodeTypeIdentifierExpression, false);
+    }
+
+    case FlatNodeTypeExpressionStatement:
+    case FlatNodeTypeReturnStatement:
+    case FlatNodeTypeImportStatement: {
+      return node->count == 1 && _is_valid_child(flat_ast, index, 0, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true);
+    }
+
+    case FlatNodeTypeBlockDefinitionStatement: {
+      return node->count == 1 && _is_valid_child(flat_ast, index, 0, FlatNodeTypeIfElseGroupBlock, FlatNodeTypeForBlock, false);
+    }
+
+    case FlatNodeTypeIfElseGroupBlock: {
+      return node->count >= 1
+        && _is_valid_child(flat_ast, index, 0, FlatNodeTypeElseBlock, FlatNodeTypeElseBlock, true)
+        && _are_valid_children(flat_ast, index, 1, FlatNodeTypeIfBlock, FlatNodeTypeIfBlock, false);
+    }
+
+    case FlatNodeTypeIfBlock: {
+      return node->count == 3
+        && _is_valid_child(flat_ast, index, 0, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true)
+        && _is_valid_child(flat_ast, index, 1, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true)
+        && _is_valid_child(flat_ast, index, 2, FlatNodeTypeBlock, FlatNodeTypeBlock, false);
+    }
+
+    case FlatNodeTypeElseBlock: {
+      return node->count == 1 && _is_valid_child(flat_ast, index, 0, FlatNodeTypeBlock, FlatNodeTypeBlock, false);
+    }
+
+    case FlatNodeTypeForBlock: {
+      return node->count == 4
+        && _is_valid_child(flat_ast, index, 0, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true)
+        && _is_valid_child(flat_ast, index, 1, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true)
+        && _is_valid_child(flat_ast, index, 2, FlatNodeTypeNullExpression, FlatNodeTypeFunctionExpression, true)
+        && _is_valid_child(flat_ast, index, 3, FlatNodeTypeBlock, FlatNodeTypeBlock, false);
+    }
+
+    case FlatNodeTypeBlock: {
+      return _are_valid_children(flat_ast, index, 0, FlatNodeTypeExpressionStatement, FlatNodeTypeBlockDefinitionStatement, false);
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+
+bool is_valid_flat_ast(FlatAST *flat_ast) {
+  if (flat_ast->root >= flat_ast->node_count || flat_ast->nodes[flat_ast->root].node_type != FlatNodeTypeBlock) return false;
+
+  for (size_t i = 0; i < flat_ast->node_count; i++) {
+    if (!_is_valid_node(flat_ast, (FlatIndex) i)) return false;
+  }
+
+  return true;
+}
+
+
+// the rebuilt tree is owned by the returned ast, the flat one can be freed right after
+AST *unflatten_ast(FlatAST *flat_ast, Arena *arena) {
+  AST *ast = memory_allocate(MemorySubsystemCache, sizeof(AST));
+
+  ast->arena = arena;
+  ast->block = _unflatten_block(flat_ast, arena, flat_ast->root);
+
+  return ast;
+}
+
+
+void _printf_flat_block(FlatAST *flat_ast, FlatIndex index, unsigned int alignment);
+
+
+// prints the same as printf_expression does for the tree
+void _printf_flat_expression(FlatAST *flat_ast, FlatIndex index, unsigned int alignment) {
+  FlatNode *node = &flat_ast->nodes[index];
+
+  switch (node->node_type) {
+    case FlatNodeTypeInfixExpression: {
+      printf(" (");
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+      printf_infix_operator((Operator) node->operator);
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 1), alignment);
+      printf(") ");
+      break;
+    }
+
+    case FlatNodeTypePrefixExpression: {
+      printf(" (");
+      printf_prefix_operator((Operator) node->operator);
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+      printf(") ");
+      break;
+    }
+
+    case FlatNodeTypeIndexExpression: {
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+      printf("[");
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 1), alignment);
+      printf("] ");
+      break;
+    }
+
+    case FlatNodeTypeCallExpression: {
+      printf(" `");
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+      printf("->");
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 1), alignment);
+      printf("` ");
+      break;
+    }
+
+    case FlatNodeTypeArrayExpression: {
+      printf(node->operator == ArrayExpressionTypeList ? " [" : " T(");
+
+      for (size_t i = 0; i < node->count; i++) {
+        _printf_flat_expression(flat_ast, _get_child(flat_ast, node, i), alignment);
+
+        if (i < node->count - 1) printf(",");
+      }
+
+      printf(node->operator == ArrayExpressionTypeList ? "] " : ") ");
+      break;
+    }
+
+    case FlatNodeTypeFunctionExpression: {
+      printf("FUNCTION");
+
+      if (_get_child(flat_ast, node, 0) != FLAT_NULL_INDEX) _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+
+      printf("(");
+
+      for (size_t i = 2; i < node->count; i++) {
+        printf("%s", flat_ast->strings + flat_ast->nodes[_get_child(flat_ast, node, i)].first);
+
+        if (i != node->count - 1) printf(", ");
+      }
+
+      printf(")");
+      printf("\n");
+      _printf_flat_block(flat_ast, _get_child(flat_ast, node, 1), alignment);
+      break;
+    }
+
+    case FlatNodeTypeBoolExpression: {
+      printf(" %s ", node->first ? "true" : "false");
+      break;
+    }
+
+    case FlatNodeTypeIntegerExpression: {
+      printf(" %lld ", flat_ast->integers[node->first]);
+      break;
+    }
+
+    case FlatNodeTypeFloatExpression: {
+      printf(" %Lf ", flat_ast->floats[node->first]);
+      break;
+    }
+
+    case FlatNodeTypeStringExpression: {
+      printf(" \"%s\" ", flat_ast->strings + node->first);
+      break;
+    }
+
+    case FlatNodeTypeIdentifierExpression: {
+      printf(" %s ", flat_ast->strings + node->first);
+      break;
+    }
+
+    case FlatNodeTypeNullExpression: {
+      printf(" %s ", "null");
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void _printf_flat_block_definition(FlatAST *flat_ast, FlatIndex index, unsigned int alignment) {
+  FlatNode *node = &flat_ast->nodes[index];
+
+  switch (node->node_type) {
+    case FlatNodeTypeIfElseGroupBlock: {
+      for (size_t i = 1; i < node->count; i++) {
+        _printf_flat_block_definition(flat_ast, _get_child(flat_ast, node, i), alignment);
+      }
+
+      if (_get_child(flat_ast, node, 0) != FLAT_NULL_INDEX) _printf_flat_block_definition(flat_ast, _get_child(flat_ast, node, 0), alignment);
+      break;
+    }
+
+    case FlatNodeTypeIfBlock: {
+      printf_alignment(alignment);
+      printf("IF");
+
+      if (_get_child(flat_ast, node, 0) != FLAT_NULL_INDEX) {
+        _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+        printf(";");
+      }
+
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 1), alignment);
+      printf("\n");
+      _printf_flat_block(flat_ast, _get_child(flat_ast, node, 2), alignment);
+      break;
+    }
+
+    case FlatNodeTypeElseBlock: {
+      _printf_flat_block(flat_ast, _get_child(flat_ast, node, 0), alignment);
+      break;
+    }
+
+    case FlatNodeTypeForBlock: {
+      printf_alignment(alignment);
+      printf("FOR");
+
+      if (_get_child(flat_ast, node, 0) != FLAT_NULL_INDEX) {
+        _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 0), alignment);
+        printf(";");
+      }
+
+      _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 1), alignment);
+
+      if (_get_child(flat_ast, node, 2) != FLAT_NULL_INDEX) {
+        printf(";");
+        _printf_flat_expression(flat_ast, _get_child(flat_ast, node, 2), alignment);
+      }
+
+      printf("\n");
+      _printf_flat_block(flat_ast, _get_child(flat_ast, node, 3), alignment);
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void _printf_flat_statement(FlatAST *flat_ast, FlatIndex index, unsigned int alignment) {
+  FlatNode *node = &flat_ast->nodes[index];
+  FlatIndex child = _get_child(flat_ast, node, 0);
+
+  switch (node->node_type) {
+    case FlatNodeTypeReturnStatement:
+    case FlatNodeTypeImportStatement: {
+      printf_alignment(alignment);
+      printf(node->node_type == FlatNodeTypeReturnStatement ? "return " : "import ");
+      _printf_flat_expression(flat_ast, child, alignment);
+      printf("\n");
+      break;
+    }
+
+    case FlatNodeTypeBlockDefinitionStatement: {
+      _printf_flat_block_definition(flat_ast, child, alignment);
+      break;
+    }
+
+    default: {
+      printf_alignment(alignment);
+      _printf_flat_expression(flat_ast, child, alignment);
+      printf("\n");
+      break;
+    }
+  }
+}
+
+
+void _printf_flat_block(FlatAST *flat_ast, FlatIndex index, unsigned int alignment) {
+  FlatNode *node = &flat_ast->nodes[index];
+
+  printf("{\n");
+
+  for (size_t i = 0; i < node->count; i++) {
+    _printf_flat_statement(flat_ast, _get_child(flat_ast, node, i), alignment + 1u);
+  }
+
+  printf("}\n");
+}
+
+
+void printf_flat_ast(FlatAST *flat_ast) {
+  FlatNode *root = &flat_ast->nodes[flat_ast->root];
+
+  for (size_t i = 0; i < root->count; i++) {
+    _printf_flat_statement(flat_ast, _get_child(flat_ast, root, i), 0);
+  }
+
+  printf("\n");
+}
+
+
+void free_flat_ast(FlatAST *flat_ast) {
+  if (flat_ast->mapping != NULL) {
+    munmap(flat_ast->mapping, flat_ast->mapping_length);
+    memory_free(flat_ast);
+    return;
+  }
+
+  memory_free(flat_ast->nodes);
+  memory_free(flat_ast->children);
+  memory_free(flat_ast->integers);
+  memory_free(flat_ast->floats);
+  memory_free(flat_ast->strings);
+  memory_free(flat_ast);
+}
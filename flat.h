@@ -0,0 +1,90 @@
+#ifndef PIELANG_FLAT_H
+#define PIELANG_FLAT_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "arena.h"
+
+#define FLAT_NULL_INDEX UINT32_MAX
+
+typedef uint32_t FlatIndex;
+
+typedef enum {
+  FlatNodeTypeNullExpression = 0,
+  FlatNodeTypeBoolExpression,
+  FlatNodeTypeIntegerExpression,
+  FlatNodeTypeFloatExpression,
+  FlatNodeTypeStringExpression,
+  FlatNodeTypeIdentifierExpression,
+  FlatNodeTypeInfixExpression,
+  FlatNodeTypePrefixExpression,
+  FlatNodeTypeIndexExpression,
+  FlatNodeTypeCallExpression,
+  FlatNodeTypeArrayExpression,
+  FlatNodeTypeFunctionExpression,
+  FlatNodeTypeExpressionStatement,
+  FlatNodeTypeReturnStatement,
+  FlatNodeTypeImportStatement,
+  FlatNodeTypeBlockDefinitionStatement,
+  FlatNodeTypeIfElseGroupBlock,
+  FlatNodeTypeIfBlock,
+  FlatNodeTypeElseBlock,
+  FlatNodeTypeForBlock,
+  FlatNodeTypeBlock,
+} FlatNodeType;
+
+// the children of a node are count indices from first on in the children array, a missing child is FLAT_NULL_INDEX
+// literals keep first as their index in the pool of their type, strings also use count as their length
+typedef struct {
+  uint8_t node_type;
+  uint8_t operator;
+  uint16_t reserved;
+  FlatIndex first;
+  FlatIndex count;
+} FlatNode;
+
+// the serialized form of a tree, it is never run itself but rebuilt into a tree with unflatten_ast
+// nothing in it is a pointer, so the arrays can be written out and read back as they are
+// a flat ast read from a cache points into its mapping and has no capacities
+typedef struct {
+  FlatNode *nodes;
+  size_t node_count;
+  FlatIndex *children;
+  size_t child_count;
+  long long int *integers;
+  size_t integer_count;
+  long double *floats;
+  size_t float_count;
+  char *strings;
+  size_t string_length;
+  FlatIndex root;
+  size_t node_capacity;
+  size_t child_capacity;
+  size_t integer_capacity;
+  size_t float_capacity;
+  size_t string_capacity;
+  void *mapping;
+  size_t mapping_length;
+} FlatAST;
+
+
+FlatAST *flatten_ast(AST *ast);
+
+
+AST *unflatten_ast(FlatAST *flat_ast, Arena *arena);
+
+
+// a flat ast read from a file is only unflattened when every index in it points inside its pools
+bool is_valid_flat_ast(FlatAST *flat_ast);
+
+
+void printf_flat_ast(FlatAST *flat_ast);
+
+
+void free_flat_ast(FlatAST *flat_ast);
+
+
+#endif //PIELANG_FLAT_H
@@ -0,0 +1,337 @@
+#include "gc.h"
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "value.h"
+#include "scope.h"
+#include "hashtable.h"
+#include "pool.h"
+#include "memory.h"
+
+static GC gc = {
+    .first_value = NULL,
+    .value_count = 0,
+    .allocated_bytes = 0,
+    .next_collection_bytes = DEFAULT_GC_INITIAL_HEAP_SIZE,
+    .initial_heap_size = DEFAULT_GC_INITIAL_HEAP_SIZE,
+    .heap_growth_factor = DEFAULT_GC_HEAP_GROWTH_FACTOR,
+    .is_stress_mode = false,
+    .collection_count = 0,
+};
+
+
+void gc_configure(size_t initial_heap_size, double heap_growth_factor, bool is_stress_mode) {
+  gc.initial_heap_size = initial_heap_size;
+  gc.next_collection_bytes = initial_heap_size;
+  gc.heap_growth_factor = heap_growth_factor < 1 ? 1 : heap_growth_factor;
+  gc.is_stress_mode = is_stress_mode;
+}
+
+
+// the live values are counted again with their buffers after every collection
+size_t _get_value_size(Value *value) {
+  switch (value->value_type) {
+    case ValueTypeIntegerValue: {
+      return sizeof(IntegerValue);
+    }
+
+    case ValueTypeFloatValue: {
+      return sizeof(FloatValue);
+    }
+
+    case ValueTypeStringValue: {
+      StringValue *string_value = (StringValue *) value;
+
+      // a short string and a rope have no buffer of their own
+      if (string_value->string_value == NULL || string_value->string_value == string_value->storage.inline_string) return sizeof(StringValue);
+
+      return sizeof(StringValue) + string_value->storage.capacity + 1;
+    }
+
+    case ValueTypeFunctionValue: {
+      return sizeof(FunctionValue) + ((FunctionValue *) value)->argument_count * sizeof(char *);
+    }
+
+    case ValueTypeSystemFunctionValue: {
+      return sizeof(SystemFunctionValue);
+    }
+
+    case ValueTypeTupleValue: {
+      return sizeof(TupleValue) + ((TupleValue *) value)->length * sizeof(Value *);
+    }
+
+    case ValueTypeListValue: {
+      return sizeof(ListValue) + ((ListValue *) value)->capacity * sizeof(Value *);
+    }
+
+    case ValueTypeGeneratorValue: {
+      return sizeof(GeneratorValue);
+    }
+
+    default: {
+      return sizeof(Value);
+    }
+  }
+}
+
+
+Value *gc_allocate_value(size_t size, ValueType value_type) {
+  if (gc.is_stress_mode || gc.allocated_bytes + size > gc.next_collection_bytes) {
+    gc_collect();
+  }
+
+  // the values are small and made and swept all the time, they come from the size classes of the pool
+  Value *value = pool_allocate(size);
+
+  value->value_type = value_type;
+  value->is_marked = false;
+  value->is_pinned = false;
+  value->is_shared = false;
+  value->context_value = NULL;
+  value->next_value = gc.first_value;
+
+  gc.first_value = value;
+  gc.value_count++;
+  gc.allocated_bytes += size;
+
+  // a new value is reachable from nowhere yet, it stays a root until the statement or instruction that made it ends
+  gc_push_root(value);
+
+  return value;
+}
+
+
+// the buffers of strings, tuples and lists are counted when they are made or grow, so a heap of large arrays reaches a collection too
+void gc_account_bytes(size_t size) {
+  gc.allocated_bytes += size;
+}
+
+
+// the value is left out of the heap and stays marked, so a collection never traces or frees it and unpinning does not matter
+Value *gc_allocate_immortal_value(size_t size, ValueType value_type) {
+  Value *value = memory_allocate(MemorySubsystemValue, size);
+
+  value->value_type = value_type;
+  value->is_marked = true;
+  value->is_pinned = false;
+  value->is_shared = true;
+  value->context_value = NULL;
+  value->next_value = NULL;
+
+  return value;
+}
+
+
+void gc_push_root(Value *value) {
+  if (!is_heap_value(value)) return;
+
+  if (gc.root_count == gc.root_capacity) {
+    gc.root_capacity = gc.root_capacity == 0 ? 64 : gc.root_capacity * 2;
+    gc.roots = memory_reallocate(MemorySubsystemGC, gc.roots, gc.root_capacity * sizeof(Value *));
+  }
+
+  gc.roots[gc.root_count++] = value;
+}
+
+
+size_t gc_save_roots() {
+  return gc.root_count;
+}
+
+
+void gc_restore_roots(size_t root_count) {
+  gc.root_count = root_count;
+}
+
+
+void gc_register_scope(Scope *scope) {
+  if (gc.scope_count == gc.scope_capacity) {
+    gc.scope_capacity = gc.scope_capacity == 0 ? 64 : gc.scope_capacity * 2;
+    gc.scopes = memory_reallocate(MemorySubsystemGC, gc.scopes, gc.scope_capacity * sizeof(Scope *));
+  }
+
+  gc.scopes[gc.scope_count++] = scope;
+}
+
+
+// scopes are almost always freed in the reverse order they are created, so the search starts from the last one
+void gc_unregister_scope(Scope *scope) {
+  for (size_t i = gc.scope_count; i > 0; i--) {
+    if (gc.scopes[i - 1] == scope) {
+      gc.scopes[i - 1] = gc.scopes[--gc.scope_count];
+      return;
+    }
+  }
+}
+
+
+void gc_register_root_stack(Value ***values, size_t *length) {
+  gc.root_stacks = memory_reallocate(MemorySubsystemGC, gc.root_stacks, (gc.root_stack_count + 1) * sizeof(GCRootStack));
+  gc.root_stacks[gc.root_stack_count++] = (GCRootStack) {.values = values, .length = length};
+}
+
+
+void gc_unregister_root_stack(Value ***values) {
+  for (size_t i = 0; i < gc.root_stack_count; i++) {
+    if (gc.root_stacks[i].values == values) {
+      gc.root_stacks[i] = gc.root_stacks[--gc.root_stack_count];
+      return;
+    }
+  }
+}
+
+
+void gc_pin_value(Value *value) {
+  if (is_heap_value(value)) value->is_pinned = true;
+}
+
+
+void gc_unpin_value(Value *value) {
+  if (is_heap_value(value)) value->is_pinned = false;
+}
+
+
+void gc_mark_value(Value *value) {
+  if (value == NULL || !is_heap_value(value) || value->is_marked) return;
+
+  value->is_marked = true;
+
+  if (gc.gray_value_count == gc.gray_value_capacity) {
+    gc.gray_value_capacity = gc.gray_value_capacity == 0 ? 64 : gc.gray_value_capacity * 2;
+    gc.gray_values = memory_reallocate(MemorySubsystemGC, gc.gray_values, gc.gray_value_capacity * sizeof(Value *));
+  }
+
+  gc.gray_values[gc.gray_value_count++] = value;
+}
+
+
+void gc_mark_items(Value **items, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    gc_mark_value(items[i]);
+  }
+}
+
+
+void gc_mark_hash_table(HashTable *hash_table) {
+  size_t index = 0;
+  HashTableEntry *entry;
+
+  while ((entry = hash_table_next_entry(hash_table, &index)) != NULL) {
+    gc_mark_value(((Variable *) entry->literal)->value);
+  }
+}
+
+
+void gc_mark_scope(Scope *scope) {
+  for (size_t i = 0; i < scope->slot_count; i++) {
+    gc_mark_value(scope->slots[i].value);
+  }
+
+  for (size_t i = 0; i < VALUE_TYPE_COUNT; i++) {
+    if (scope->variable_maps[i] != NULL) gc_mark_hash_table(scope->variable_maps[i]);
+  }
+
+  gc_mark_value(scope->return_value);
+}
+
+
+void gc_trace_value(Value *value) {
+  gc_mark_value(value->context_value);
+
+  switch (value->value_type) {
+    case ValueTypeStringValue: {
+      StringValue *string_value = (StringValue *) value;
+
+      // the parts of a rope are needed until it is flattened
+      if (string_value->string_value == NULL) gc_mark_items((Value **) string_value->storage.rope_values, 2);
+      break;
+    }
+
+    case ValueTypeTupleValue: {
+      gc_mark_items(((TupleValue *) value)->items, ((TupleValue *) value)->length);
+      break;
+    }
+
+    case ValueTypeListValue: {
+      gc_mark_items(((ListValue *) value)->items, ((ListValue *) value)->length);
+      break;
+    }
+
+    case ValueTypeGeneratorValue: {
+      gc_mark_value(((GeneratorValue *) value)->target_value);
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void gc_mark_roots() {
+  gc_mark_items(gc.roots, gc.root_count);
+
+  for (size_t i = 0; i < gc.scope_count; i++) {
+    gc_mark_scope(gc.scopes[i]);
+  }
+
+  for (size_t i = 0; i < gc.root_stack_count; i++) {
+    gc_mark_items(*gc.root_stacks[i].values, *gc.root_stacks[i].length);
+  }
+
+  for (Value *value = gc.first_value; value != NULL; value = value->next_value) {
+    if (value->is_pinned) gc_mark_value(value);
+  }
+}
+
+
+size_t gc_sweep() {
+  Value **link = &gc.first_value;
+  size_t freed_value_count = 0;
+
+  gc.allocated_bytes = 0;
+
+  while (*link != NULL) {
+    Value *value = *link;
+
+    if (value->is_marked) {
+      value->is_marked = false;
+      gc.allocated_bytes += _get_value_size(value);
+
+      link = &value->next_value;
+    }
+    else {
+      *link = value->next_value;
+
+      free_value(value);
+      freed_value_count++;
+    }
+  }
+
+  gc.value_count -= freed_value_count;
+
+  return freed_value_count;
+}
+
+
+size_t gc_collect() {
+  gc_mark_roots();
+
+  while (gc.gray_value_count > 0) {
+    gc_trace_value(gc.gray_values[--gc.gray_value_count]);
+  }
+
+  size_t freed_value_count = gc_sweep();
+
+  gc.next_collection_bytes = (size_t) (gc.allocated_bytes * gc.heap_growth_factor);
+
+  if (gc.next_collection_bytes < gc.initial_heap_size) {
+    gc.next_collection_bytes = gc.initial_heap_size;
+  }
+
+  gc.collection_count++;
+
+  return freed_value_count;
+}
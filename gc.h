@@ -0,0 +1,84 @@
+#ifndef PIELANG_GC_H
+#define PIELANG_GC_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "value.h"
+
+#define DEFAULT_GC_INITIAL_HEAP_SIZE (1024 * 1024)
+#define DEFAULT_GC_HEAP_GROWTH_FACTOR 2.0
+
+struct Scope;
+
+typedef struct {
+  Value ***values;
+  size_t *length;
+} GCRootStack;
+
+typedef struct {
+  Value *first_value;
+  size_t value_count;
+  size_t allocated_bytes;
+  size_t next_collection_bytes;
+  size_t initial_heap_size;
+  double heap_growth_factor;
+  bool is_stress_mode;
+  size_t collection_count;
+  Value **roots;
+  size_t root_count;
+  size_t root_capacity;
+  struct Scope **scopes;
+  size_t scope_count;
+  size_t scope_capacity;
+  GCRootStack *root_stacks;
+  size_t root_stack_count;
+  Value **gray_values;
+  size_t gray_value_count;
+  size_t gray_value_capacity;
+} GC;
+
+
+void gc_configure(size_t initial_heap_size, double heap_growth_factor, bool is_stress_mode);
+
+
+Value *gc_allocate_value(size_t size, ValueType value_type);
+
+
+Value *gc_allocate_immortal_value(size_t size, ValueType value_type);
+
+
+void gc_account_bytes(size_t size);
+
+
+void gc_push_root(Value *value);
+
+
+size_t gc_save_roots();
+
+
+void gc_restore_roots(size_t root_count);
+
+
+void gc_register_scope(struct Scope *scope);
+
+
+void gc_unregister_scope(struct Scope *scope);
+
+
+void gc_register_root_stack(Value ***values, size_t *length);
+
+
+void gc_unregister_root_stack(Value ***values);
+
+
+void gc_pin_value(Value *value);
+
+
+void gc_unpin_value(Value *value);
+
+
+size_t gc_collect();
+
+
+#endif //PIELANG_GC_H
@@ -1,139 +1,256 @@
 #include "hashtable.h"
 
 #include <stdlib.h>
-#include <limits.h>
+#include <stdint.h>
 #include <string.h>
 
+#include "bool.h"
 #include "value.h"
+#include "memory.h"
 
-// see https://gist.github.com/tonious/1377667/104d94bb2f5b87a09dfd8cb181e302f19e46e1aa
+// open addressing with robin hood probing, an entry may take the slot of one that is closer to its own slot
+// the keys are symbols, so they are hashed and compared by pointer
 
+#define HASH_SEED 0x9e3779b97f4a7c15ull
+#define HASH_MULTIPLIER_1 0x87c37b91114253d5ull
+#define HASH_MULTIPLIER_2 0x4cf5ad432745937full
 
-unsigned long int hash(size_t size, char *key) {
-  unsigned long int hash = 0;
-  size_t i = 0;
-  size_t length = strlen(key);
 
-  while (hash < ULONG_MAX && i < length) {
-    hash = hash * 2;
-    hash = hash ^ key[i];
-    ++i;
-  }
+static inline uint64_t _rotate_left(uint64_t value, unsigned int shift) {
+  return (value << shift) | (value >> (64u - shift));
+}
+
+
+static inline uint64_t _mix_block(uint64_t hash, uint64_t block) {
+  block *= HASH_MULTIPLIER_1;
+  block = _rotate_left(block, 31);
+  block *= HASH_MULTIPLIER_2;
+
+  hash ^= block;
 
-  return hash % size;
+  return _rotate_left(hash, 27) * 5 + 0x52dce729;
 }
 
-HashTable *new_hash_table(size_t size, HashTableType hash_table_type) {
-  HashTable *hash_table = malloc(sizeof(HashTable));
-  hash_table->hash_table_type = hash_table_type;
-  hash_table->size = size;
-  hash_table->table = malloc(size * sizeof(void *));
 
-  for (size_t i = 0; i < size; i++) {
-    hash_table->table[i] = NULL;
+// the blocks are mixed like murmur3, and the finalizer makes every bit of the key reach the low bits used as index
+uint64_t hash_string(const char *key, size_t length) {
+  uint64_t hash = HASH_SEED ^ (length * HASH_MULTIPLIER_1);
+  uint64_t block;
+  size_t i = 0;
+
+  for (; i + 8 <= length; i += 8) {
+    memcpy(&block, key + i, 8);
+    hash = _mix_block(hash, block);
   }
 
-  return hash_table;
-}
+  if (i < length) {
+    block = 0;
+    memcpy(&block, key + i, length - i);
+    hash = _mix_block(hash, block);
+  }
 
-HashTableEntry *hash_table_new_entry(char *key, void *literal) {
-  HashTableEntry *entry = malloc(sizeof(HashTableEntry));
-  entry->key = key;
-  entry->literal = literal;
-  entry->next = NULL;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
 
-  return entry;
+  return hash;
 }
 
-void hash_table_set(HashTable *hash_table, char *key, void *literal) {
-  HashTableEntry *entry = NULL;
-  HashTableEntry *next = NULL;
-  HashTableEntry *last = NULL;
 
-  unsigned long int hash_value = hash(hash_table->size, key);
+static inline uint64_t _hash_key(char *key) {
+  uint64_t hash = (uint64_t) (uintptr_t) key;
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
 
-  next = hash_table->table[hash_value];
+size_t _get_capacity(size_t size) {
+  size_t capacity = HASH_TABLE_MIN_CAPACITY;
 
-  while (next != NULL && strcmp(key, next->key) > 0) {
-    last = next;
-    next = next->next;
+  while (capacity * HASH_TABLE_MAX_LOAD_NUMERATOR < size * HASH_TABLE_MAX_LOAD_DENOMINATOR) {
+    capacity *= 2;
   }
 
-  if (next != NULL && strcmp(key, next->key) == 0) {
-    switch (hash_table->hash_table_type) {
-      case HashTableTypeVariableMap: {
-        free_variable(next->literal);
-        break;
-      }
+  return capacity;
+}
 
-      default : {
-        free(next->literal);
-      }
+
+void _free_literal(HashTable *hash_table, void *literal) {
+  switch (hash_table->hash_table_type) {
+    case HashTableTypeVariableMap: {
+      free_variable((Variable *) literal);
+      break;
     }
 
-    next->literal = literal;
-  } else {
-    entry = hash_table_new_entry(key, literal);
-
-    if (next == hash_table->table[hash_value]) {
-      entry->next = next;
-      hash_table->table[hash_value] = entry;
-    } else if (next == NULL) {
-      last->next = entry;
-    } else {
-      entry->next = next;
-      last->next = entry;
+    // the modules are freed by module.c, the table only holds them
+    case HashTableTypeModuleMap: {
+      break;
+    }
+
+    default: {
+      memory_free(literal);
     }
   }
 }
 
-void *hash_table_get(HashTable *hash_table, char *key) {
-  unsigned long int hash_literal = hash(hash_table->size, key);
 
-  HashTableEntry *next = hash_table->table[hash_literal];
+// the entry is known not to be in the table
+void _insert_entry(HashTable *hash_table, HashTableEntry entry) {
+  size_t mask = hash_table->capacity - 1;
+  size_t index = entry.hash & mask;
+
+  entry.distance = 0;
 
-  if (next != NULL) {
-    HashTableEntry *last;
+  while (true) {
+    HashTableEntry *slot = &hash_table->entries[index];
 
-    while (next != NULL && strcmp(key, next->key) > 0) {
-      last = next;
-      next = last->next;
+    if (slot->key == NULL) {
+      *slot = entry;
+      hash_table->length++;
+      return;
     }
 
-    if (next != NULL && strcmp(key, next->key) == 0) {
-      return next->literal;
+    if (slot->distance < entry.distance) {
+      HashTableEntry displaced = *slot;
+
+      *slot = entry;
+      entry = displaced;
     }
+
+    index = (index + 1) & mask;
+    entry.distance++;
   }
+}
 
-  return NULL;
+
+void _resize(HashTable *hash_table, size_t capacity) {
+  HashTableEntry *entries = hash_table->entries;
+  size_t old_capacity = hash_table->capacity;
+
+  hash_table->capacity = capacity;
+  hash_table->length = 0;
+  hash_table->entries = memory_allocate_zeroed(MemorySubsystemHashTable, capacity, sizeof(HashTableEntry));
+
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (entries[i].key != NULL) _insert_entry(hash_table, entries[i]);
+  }
+
+  memory_free(entries);
 }
 
-void free_hash_table_entry(HashTable *hash_table, HashTableEntry *hash_table_entry) {
-  if (hash_table_entry != NULL) {
-    if (hash_table_entry->next != NULL) {
-      free_hash_table_entry(hash_table, hash_table_entry->next);
-    }
 
-    switch (hash_table->hash_table_type) {
-      case HashTableTypeVariableMap: {
-        free_variable((Variable *)hash_table_entry->literal); // TODO
-        break;
-      }
+HashTableEntry *_find_entry(HashTable *hash_table, char *key, uint64_t hash) {
+  size_t mask = hash_table->capacity - 1;
+  size_t index = hash & mask;
+
+  for (size_t distance = 0; ; distance++) {
+    HashTableEntry *entry = &hash_table->entries[index];
+
+    // a richer entry means the key would have been placed before it
+    if (entry->key == NULL || entry->distance < distance) return NULL;
+
+    if (entry->key == key) return entry;
+
+    index = (index + 1) & mask;
+  }
+}
 
-      default: {
-        free(hash_table_entry->literal);
-      }
-    }
 
-    free(hash_table_entry);
+HashTable *new_hash_table(size_t size, HashTableType hash_table_type) {
+  HashTable *hash_table = memory_allocate(MemorySubsystemHashTable, sizeof(HashTable));
+
+  hash_table->hash_table_type = hash_table_type;
+  hash_table->capacity = _get_capacity(size);
+  hash_table->length = 0;
+  hash_table->entries = memory_allocate_zeroed(MemorySubsystemHashTable, hash_table->capacity, sizeof(HashTableEntry));
+
+  return hash_table;
+}
+
+
+void hash_table_set(HashTable *hash_table, char *key, void *literal) {
+  uint64_t hash = _hash_key(key);
+
+  HashTableEntry *entry = _find_entry(hash_table, key, hash);
+
+  if (entry != NULL) {
+    // the key may belong to the literal that is replaced
+    if (entry->literal != literal) _free_literal(hash_table, entry->literal);
+
+    entry->key = key;
+    entry->literal = literal;
+    return;
+  }
+
+  if ((hash_table->length + 1) * HASH_TABLE_MAX_LOAD_DENOMINATOR > hash_table->capacity * HASH_TABLE_MAX_LOAD_NUMERATOR) {
+    _resize(hash_table, hash_table->capacity * 2);
   }
+
+  _insert_entry(hash_table, (HashTableEntry) {.key = key, .literal = literal, .hash = hash});
+}
+
+
+void *hash_table_get(HashTable *hash_table, char *key) {
+  HashTableEntry *entry = _find_entry(hash_table, key, _hash_key(key));
+
+  return entry == NULL ? NULL : entry->literal;
 }
 
+
+// the entries after the removed one are shifted back, so no tombstones are needed
+bool hash_table_remove(HashTable *hash_table, char *key) {
+  HashTableEntry *entry = _find_entry(hash_table, key, _hash_key(key));
+
+  if (entry == NULL) return false;
+
+  _free_literal(hash_table, entry->literal);
+
+  size_t mask = hash_table->capacity - 1;
+  size_t index = (size_t) (entry - hash_table->entries);
+  size_t next_index = (index + 1) & mask;
+
+  while (hash_table->entries[next_index].key != NULL && hash_table->entries[next_index].distance > 0) {
+    hash_table->entries[index] = hash_table->entries[next_index];
+    hash_table->entries[index].distance--;
+
+    index = next_index;
+    next_index = (next_index + 1) & mask;
+  }
+
+  hash_table->entries[index] = (HashTableEntry) {.key = NULL};
+  hash_table->length--;
+
+  if (hash_table->capacity > HASH_TABLE_MIN_CAPACITY && hash_table->length * HASH_TABLE_MIN_LOAD_DIVISOR < hash_table->capacity) {
+    _resize(hash_table, hash_table->capacity / 2);
+  }
+
+  return true;
+}
+
+
+// start with index 0, returns NULL once every entry has been visited
+HashTableEntry *hash_table_next_entry(HashTable *hash_table, size_t *index) {
+  while (*index < hash_table->capacity) {
+    HashTableEntry *entry = &hash_table->entries[(*index)++];
+
+    if (entry->key != NULL) return entry;
+  }
+
+  return NULL;
+}
+
+
 void free_hash_table(HashTable *hash_table) {
-  for (size_t i = 0; i < hash_table->size; i += 1u) {
-    free_hash_table_entry(hash_table, hash_table->table[i]);
+  for (size_t i = 0; i < hash_table->capacity; i++) {
+    if (hash_table->entries[i].key != NULL) _free_literal(hash_table, hash_table->entries[i].literal);
   }
 
-  free(hash_table->table);
-  free(hash_table);
+  memory_free(hash_table->entries);
+  memory_free(hash_table);
 }
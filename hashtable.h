@@ -2,26 +2,42 @@
 #define PIELANG_HASHTABLE_H
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "bool.h"
+
+// the capacity is always a power of two, the table grows above 7/8 and shrinks below 1/8 of it filled
+#define HASH_TABLE_MIN_CAPACITY 8
+#define HASH_TABLE_MAX_LOAD_NUMERATOR 7
+#define HASH_TABLE_MAX_LOAD_DENOMINATOR 8
+#define HASH_TABLE_MIN_LOAD_DIVISOR 8
 
 typedef enum {
   HashTableTypeVariableMap = 1,
+  HashTableTypeModuleMap,
 } HashTableType;
 
 
-typedef struct HashTableEntry {
+// the key is a symbol and an entry with a NULL key is empty, distance is how far the entry is from the slot its hash points to
+typedef struct {
   char *key;
   void *literal;
-  struct HashTableEntry *next;
+  uint64_t hash;
+  size_t distance;
 } HashTableEntry;
 
 
 typedef struct {
   HashTableType hash_table_type;
-  size_t size;
-  HashTableEntry **table;
+  size_t capacity;
+  size_t length;
+  HashTableEntry *entries;
 } HashTable;
 
 
+uint64_t hash_string(const char *key, size_t length);
+
+
 HashTable *new_hash_table(size_t size, HashTableType hash_table_type);
 
 
@@ -31,6 +47,12 @@ void hash_table_set(HashTable *hash_table, char *key, void *literal);
 void *hash_table_get(HashTable *hash_table, char *key);
 
 
+bool hash_table_remove(HashTable *hash_table, char *key);
+
+
+HashTableEntry *hash_table_next_entry(HashTable *hash_table, size_t *index);
+
+
 void free_hash_table(HashTable *hash_table);
 
 #endif //PIELANG_HASHTABLE_H
@@ -1,8 +1,13 @@
 #include "lexer.h"
 
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
 #include "bool.h"
 #include "utils.h"
+#include "symbol.h"
+#include "scanner.h"
+#include "memory.h"
 
 #define MAX_BUFFER_SIZE 10000
 
@@ -37,12 +42,54 @@ bool is_identifier_char(char c) {
 }
 
 
+// the positions are counted from the start of the input, content only holds the part from content_offset on
 char _prev_char(Lexer *lexer) {
-  return lexer->content[--lexer->cursor];
+  size_t index = --lexer->cursor - lexer->content_offset;
+
+  return index < lexer->content_length ? lexer->content[index] : 0;
 }
 
+
+// a streaming lexer drops what the parser no longer needs, from the current token on everything is kept
+bool _fill_content(Lexer *lexer) {
+  if (lexer->fd < 0) return false;
+
+  size_t kept_index = lexer->kept_position - lexer->content_offset;
+
+  memmove(lexer->content, lexer->content + kept_index, lexer->content_length - kept_index);
+
+  lexer->content_offset = lexer->kept_position;
+  lexer->content_length -= kept_index;
+
+  if (lexer->content_length == lexer->content_capacity) {
+    lexer->content_capacity *= 2;
+    lexer->content = memory_reallocate(MemorySubsystemLexer, lexer->content, lexer->content_capacity);
+  }
+
+  ssize_t read_length;
+
+  do {
+    read_length = read(lexer->fd, lexer->content + lexer->content_length, lexer->content_capacity - lexer->content_length);
+  } while (read_length < 0 && errno == EINTR);
+
+  if (read_length <= 0) {
+    lexer->fd = -1;
+    return false;
+  }
+
+  lexer->content_length += (size_t) read_length;
+
+  return true;
+}
+
+
 char _next_char(Lexer *lexer) {
-  return lexer->content[lexer->cursor++];
+  if (lexer->cursor - lexer->content_offset >= lexer->content_length && !_fill_content(lexer)) {
+    lexer->cursor++;
+    return 0;
+  }
+
+  return lexer->content[lexer->cursor++ - lexer->content_offset];
 }
 
 
@@ -66,38 +113,157 @@ char next_char(Lexer *lexer) {
 }
 
 
-Lexer *new_lexer(char *content) {
-  Lexer *lexer = malloc(sizeof(Lexer));
+// the content that has been read from the next char on, the scans only look at this part
+size_t _get_available_length(Lexer *lexer) {
+  size_t index = lexer->cursor - 1 - lexer->content_offset;
 
-  lexer->content = content;
-  lexer->cursor = 0;
+  return index < lexer->content_length ? lexer->content_length - index : 0;
+}
+
+
+char *_get_next_pointer(Lexer *lexer) {
+  return lexer->content + (lexer->cursor - 1 - lexer->content_offset);
+}
+
+
+// moves count chars ahead at once, count is at most the available length
+void _skip_chars(Lexer *lexer, size_t count) {
+  if (count == 0) return;
+
+  lexer->curr_char = lexer->content[lexer->cursor - 1 - lexer->content_offset + count - 1];
+  lexer->cursor += count - 1;
+  lexer->next_char = _next_char(lexer);
+}
+
+
+void _start_lexer(Lexer *lexer) {
+  lexer->cursor = lexer->content_offset;
+  lexer->kept_position = lexer->content_offset;
+  lexer->next_token_position = lexer->content_offset;
   lexer->next_char = _next_char(lexer);
   lexer->next_token = _next_token(lexer);
+}
+
+
+// the literals of the tokens are allocated from the arena, so they live as long as the ast that owns it
+Lexer *new_lexer(char *content, size_t content_length, Arena *arena) {
+  Lexer *lexer = memory_allocate(MemorySubsystemLexer, sizeof(Lexer));
+
+  lexer->arena = arena;
+  lexer->content = content;
+  lexer->content_length = content_length;
+  lexer->content_offset = 0;
+  lexer->content_capacity = 0;
+  lexer->fd = -1;
+  lexer->should_defer_function_bodies = false;
+
+  _start_lexer(lexer);
+
+  return lexer;
+}
+
+
+// reads the input in chunks as the parser asks for tokens, so a pipe can be parsed while it is still written
+Lexer *new_stream_lexer(int fd, Arena *arena) {
+  Lexer *lexer = memory_allocate(MemorySubsystemLexer, sizeof(Lexer));
+
+  lexer->arena = arena;
+  lexer->content = memory_allocate(MemorySubsystemLexer, LEXER_STREAM_CHUNK_SIZE);
+  lexer->content_length = 0;
+  lexer->content_offset = 0;
+  lexer->content_capacity = LEXER_STREAM_CHUNK_SIZE;
+  lexer->fd = fd;
+  lexer->should_defer_function_bodies = false;
+
+  _start_lexer(lexer);
 
   return lexer;
 }
 
 
-void update_lexer(Lexer *lexer, char *content) {
+void update_lexer(Lexer *lexer, char *content, size_t content_length) {
   lexer->content = content;
-  lexer->cursor = 0;
-  lexer->next_char = _next_char(lexer);
-  lexer->next_token = _next_token(lexer);
+  lexer->content_length = content_length;
+  lexer->content_offset = 0;
+
+  _start_lexer(lexer);
 }
 
 
 void free_lexer(Lexer *lexer) {
-  free(lexer);
+  if (lexer->content_capacity != 0) memory_free(lexer->content);
+
+  memory_free(lexer);
 }
 
 
+// the tokens hold positions, the text is only valid until the next token is read
+char *get_token_text(Lexer *lexer, Token token) {
+  return lexer->content + (token.offset - lexer->content_offset);
+}
+
+
+// a scan stops at the end of what has been read, a streaming lexer reads more and goes on with the next scan
 void skip_whitespace(Lexer *lexer) {
-  if (peek_char(lexer) == '#') while(peek_char(lexer) != '\n') next_char(lexer);
+  while (true) {
+    char c = peek_char(lexer);
 
-  while (peek_char(lexer) == ' ' ||
-        peek_char(lexer) == '\r' ||
-        peek_char(lexer) == '\t' ||
-        peek_char(lexer) == '\n') next_char(lexer);
+    if (c == '#') {
+      while (peek_char(lexer) != '\n' && peek_char(lexer) != 0) _skip_chars(lexer, scan_line(_get_next_pointer(lexer), _get_available_length(lexer)));
+    }
+    else if (c == ' ' || c == '\r' || c == '\t' || c == '\n') {
+      _skip_chars(lexer, scan_whitespace(_get_next_pointer(lexer), _get_available_length(lexer)));
+    }
+    else {
+      return;
+    }
+  }
+}
+
+
+// the position of the next char in the content
+size_t _get_position(Lexer *lexer) {
+  return lexer->cursor - 1;
+}
+
+
+// the length and the first char rule out almost every keyword before a comparison, no keyword is copied
+TokenType _get_keyword_token_type(char *literal, size_t length) {
+  switch (length) {
+    case 2: {
+      if (literal[0] == 'f' && literal[1] == 'n') return FUNCTION_TOKEN;
+      if (literal[0] == 'i' && literal[1] == 'f') return IF_TOKEN;
+      if (literal[0] == 'i' && literal[1] == 'n') return IN_TOKEN;
+      break;
+    }
+
+    case 3: {
+      if (memcmp(literal, "for", 3) == 0) return FOR_TOKEN;
+      break;
+    }
+
+    case 4: {
+      if (literal[0] == 't' && memcmp(literal, "true", 4) == 0) return BOOL_TOKEN;
+      if (literal[0] == 'n' && memcmp(literal, "null", 4) == 0) return NULL_TOKEN;
+      if (literal[0] == 'e' && memcmp(literal, "else", 4) == 0) return ELSE_TOKEN;
+      break;
+    }
+
+    case 5: {
+      if (literal[0] == 'f' && memcmp(literal, "false", 5) == 0) return BOOL_TOKEN;
+      if (literal[0] == 'a' && memcmp(literal, "async", 5) == 0) return ASYNC_TOKEN;
+      if (literal[0] == 'a' && memcmp(literal, "await", 5) == 0) return AWAIT_TOKEN;
+      break;
+    }
+
+    case 6: {
+      if (literal[0] == 'r' && memcmp(literal, "return", 6) == 0) return RETURN_TOKEN;
+      if (literal[0] == 'i' && memcmp(literal, "import", 6) == 0) return IMPORT_TOKEN;
+      break;
+    }
+  }
+
+  return IDENTIFIER_TOKEN;
 }
 
 
@@ -106,18 +272,12 @@ Token read_number_token(Lexer *lexer) {
     return (Token) {.token_type = NULL_TOKEN};
   }
 
+  size_t offset = _get_position(lexer);
   bool is_float = false;
-
-  char buffer[MAX_BUFFER_SIZE];
-  size_t buffer_length = 0;
   char c;
 
   while (is_number_char((c = peek_char(lexer)))) {
-    if (c == '_') {
-        next_char(lexer);
-        continue;
-    }
-    else if (c == '.') {
+    if (c == '.') {
         next_char(lexer);
 
         if (peek_char(lexer) == '.') {
@@ -126,95 +286,44 @@ Token read_number_token(Lexer *lexer) {
         }
 
         is_float = true;
-
-        buffer[buffer_length++] = c;
     }
     else {
-      buffer[buffer_length++] = c;
-      next_char(lexer);
+      _skip_chars(lexer, scan_digits(_get_next_pointer(lexer), _get_available_length(lexer)));
     }
   }
 
-  char *string = create_string_from_buffer(buffer, buffer_length);
-
-  if (is_float == true) {
-    FloatLiteral *float_literal = malloc(sizeof(FloatLiteral));
-
-    float_literal->literal = (Literal){.literal_type = LiteralTypeFloatLiteral};
-    float_literal->float_literal = strtod(string, NULL);
-
-    free(string);
-
-    return (Token) {.token_type = FLOAT_TOKEN, .literal = (Literal *) float_literal};
-  }
-  else {
-    IntegerLiteral *integer_literal = malloc(sizeof(IntegerLiteral));
-    integer_literal->literal = (Literal){.literal_type = LiteralTypeIntegerLiteral};
-    integer_literal->integer_literal = strtol(string, NULL, 10);
-
-    free(string);
-
-    return (Token) {.token_type = INTEGER_TOKEN, .literal = (Literal *) integer_literal};
-  }
+  return (Token) {.token_type = is_float ? FLOAT_TOKEN : INTEGER_TOKEN, .offset = offset, .length = _get_position(lexer) - offset};
 }
 
 
-char *read_literal(Lexer *lexer) {
-  if (!is_identifier_first_char(peek_char(lexer))) {
-    return NULL;
-  }
-
-  char buffer[MAX_BUFFER_SIZE];
-  size_t buffer_length = 0;
+size_t read_literal(Lexer *lexer) {
+  size_t offset = _get_position(lexer);
 
-  while (is_identifier_char(peek_char(lexer))) {
-    buffer[buffer_length++] = next_char(lexer);
-  }
+  while (is_identifier_char(peek_char(lexer))) _skip_chars(lexer, scan_identifier(_get_next_pointer(lexer), _get_available_length(lexer)));
 
-  return create_string_from_buffer(buffer, buffer_length);
+  return _get_position(lexer) - offset;
 }
 
 
+// the slice is the content between the quotes, the escapes are only resolved when the parser needs the literal
 Token parse_string_literal_token(Lexer *lexer, char c) {
-  char buffer[MAX_BUFFER_SIZE];
-  size_t buffer_length = 0;
+  size_t offset = _get_position(lexer);
 
-  while (true) {
-    if (peek_char(lexer) == c) {
-      next_char(lexer);
-      break;
-    }
-    else if(peek_char(lexer) == '\\') {
+  while (peek_char(lexer) != c && peek_char(lexer) != 0) {
+    if (peek_char(lexer) == '\\') {
       next_char(lexer);
-
-      if (peek_char(lexer) == 'n') {
-        buffer[buffer_length++] = '\n';
-      }
-      else if (peek_char(lexer) == 't') {
-        buffer[buffer_length++] = '\t';
-      }
-      else if (peek_char(lexer) == 'r') {
-        buffer[buffer_length++] = '\r';
-      }
-      else if (peek_char(lexer) == c) {
-        buffer[buffer_length++] = c;
-      }
-
       next_char(lexer);
     }
     else {
-      buffer[buffer_length++] = next_char(lexer);
+      _skip_chars(lexer, scan_string(_get_next_pointer(lexer), _get_available_length(lexer), c));
     }
   }
 
-  char *string = create_string_from_buffer(buffer, buffer_length);
+  size_t length = _get_position(lexer) - offset;
 
-  StringLiteral *string_literal = malloc(sizeof(StringLiteral));
-  string_literal->literal = (Literal) {.literal_type = LiteralTypeStringLiteral};
-  string_literal->string_literal = string;
-  string_literal->length = strlen(string);
+  if (peek_char(lexer) == c) next_char(lexer);
 
-  return (Token) {.token_type = STRING_LITERAL_TOKEN, .literal = (Literal *) string_literal};
+  return (Token) {.token_type = STRING_LITERAL_TOKEN, .offset = offset, .length = length};
 }
 
 
@@ -454,95 +563,114 @@ Token _next_token(Lexer *lexer) {
         return read_number_token(lexer);
       }
 
-      char *s = read_literal(lexer);
+      if (!is_identifier_first_char(peek_char(lexer))) return (Token) {.token_type = NULL_TOKEN};
 
-      if (s == NULL) return (Token) {.token_type = NULL_TOKEN};
+      size_t offset = _get_position(lexer);
+      size_t length = read_literal(lexer);
+      char *literal = lexer->content + (offset - lexer->content_offset);
 
-      if (strcmp(s, "true") == 0) {
-        free(s);
+      TokenType token_type = _get_keyword_token_type(literal, length);
 
-        BoolLiteral *bool_literal = malloc(sizeof(BoolLiteral));
-        bool_literal->literal = (Literal) {.literal_type = LiteralTypeBoolLiteral};
-        bool_literal->bool_literal = true;
+      if (token_type == BOOL_TOKEN) return (Token) {.token_type = BOOL_TOKEN, .offset = offset, .length = length};
+      if (token_type != IDENTIFIER_TOKEN) return (Token) {.token_type = token_type};
 
-        return (Token){.token_type = BOOL_TOKEN, .literal = (Literal *) bool_literal};
-      }
+      return (Token) {.token_type = IDENTIFIER_TOKEN, .offset = offset, .length = length};
+    }
+  }
+}
 
-      if (strcmp(s, "false") == 0) {
-        free(s);
 
-        BoolLiteral *bool_literal = malloc(sizeof(BoolLiteral));
-        bool_literal->literal = (Literal) {.literal_type = LiteralTypeBoolLiteral};
-        bool_literal->bool_literal = false;
+// the name of an identifier is its symbol, so it is copied only once for the whole program
+StringLiteral *_read_identifier_literal(Lexer *lexer, char *literal, size_t length) {
+  StringLiteral *string_literal = arena_allocate(lexer->arena, sizeof(StringLiteral));
+  string_literal->literal = (Literal) {.literal_type = LiteralTypeStringLiteral};
+  string_literal->string_literal = intern_symbol(literal, length);
+  string_literal->length = length;
 
-        return (Token){.token_type = BOOL_TOKEN, .literal = (Literal *) bool_literal};
-      }
+  return string_literal;
+}
 
-      if (strcmp(s, "null") == 0) {
-        free(s);
 
-        return (Token) {.token_type = NULL_TOKEN};
-      }
+StringLiteral *_read_string_literal(Lexer *lexer, char *literal, size_t length) {
+  char quote = literal[-1];
+  char *string = arena_allocate(lexer->arena, length + 1);
+  size_t string_length = 0;
 
-      if (strcmp(s, "return") == 0) {
-        free(s);
+  for (size_t i = 0; i < length; i++) {
+    if (literal[i] != '\\') {
+      string[string_length++] = literal[i];
+      continue;
+    }
 
-        return (Token) {.token_type = RETURN_TOKEN};
-      }
+    char c = literal[++i];
 
-      if (strcmp(s, "import") == 0) {
-        free(s);
+    if (c == 'n') string[string_length++] = '\n';
+    else if (c == 't') string[string_length++] = '\t';
+    else if (c == 'r') string[string_length++] = '\r';
+    else if (c == quote) string[string_length++] = quote;
+  }
 
-        return (Token) {.token_type = IMPORT_TOKEN};
-      }
+  string[string_length] = 0;
 
-      if (strcmp(s, "fn") == 0) {
-        free(s);
+  StringLiteral *string_literal = arena_allocate(lexer->arena, sizeof(StringLiteral));
+  string_literal->literal = (Literal) {.literal_type = LiteralTypeStringLiteral};
+  string_literal->string_literal = string;
+  string_literal->length = string_length;
 
-        return (Token) {.token_type = FUNCTION_TOKEN};
-      }
+  return string_literal;
+}
 
-      if (strcmp(s, "if") == 0) {
-        free(s);
 
-        return (Token) {.token_type = IF_TOKEN};
-      }
+// the tokens only point into the content, the parser asks for the literal when it builds a node from the token
+Literal *get_token_literal(Lexer *lexer, Token token) {
+  char *literal = get_token_text(lexer, token);
 
-      if (strcmp(s, "else") == 0) {
-        free(s);
+  switch (token.token_type) {
+    case IDENTIFIER_TOKEN: {
+      return (Literal *) _read_identifier_literal(lexer, literal, token.length);
+    }
 
-        return (Token) {.token_type = ELSE_TOKEN};
-      }
+    case STRING_LITERAL_TOKEN: {
+      return (Literal *) _read_string_literal(lexer, literal, token.length);
+    }
 
-      if (strcmp(s, "for") == 0) {
-        free(s);
+    case BOOL_TOKEN: {
+      BoolLiteral *bool_literal = arena_allocate(lexer->arena, sizeof(BoolLiteral));
+      bool_literal->literal = (Literal) {.literal_type = LiteralTypeBoolLiteral};
+      // the slice is either true or false
+      bool_literal->bool_literal = token.length == 4;
 
-        return (Token) {.token_type = FOR_TOKEN};
-      }
+      return (Literal *) bool_literal;
+    }
 
-      if (strcmp(s, "in") == 0) {
-        free(s);
+    case INTEGER_TOKEN:
+    case FLOAT_TOKEN: {
+      char buffer[MAX_BUFFER_SIZE];
+      size_t buffer_length = 0;
 
-        return (Token) {.token_type = IN_TOKEN};
+      for (size_t i = 0; i < token.length && buffer_length < MAX_BUFFER_SIZE - 1; i++) {
+        if (literal[i] != '_') buffer[buffer_length++] = literal[i];
       }
 
-      if (strcmp(s, "async") == 0) {
-        free(s);
+      buffer[buffer_length] = 0;
 
-        return (Token) {.token_type = ASYNC_TOKEN};
-      }
+      if (token.token_type == FLOAT_TOKEN) {
+        FloatLiteral *float_literal = arena_allocate(lexer->arena, sizeof(FloatLiteral));
+        float_literal->literal = (Literal){.literal_type = LiteralTypeFloatLiteral};
+        float_literal->float_literal = strtod(buffer, NULL);
 
-      if (strcmp(s, "await") == 0) {
-        free(s);
-        return (Token) {.token_type = AWAIT_TOKEN};
+        return (Literal *) float_literal;
       }
 
-      StringLiteral *string_literal = malloc(sizeof(StringLiteral));
-      string_literal->literal = (Literal) {.literal_type = LiteralTypeStringLiteral};
-      string_literal->string_literal = s;
-      string_literal->length = strlen(s);
+      IntegerLiteral *integer_literal = arena_allocate(lexer->arena, sizeof(IntegerLiteral));
+      integer_literal->literal = (Literal){.literal_type = LiteralTypeIntegerLiteral};
+      integer_literal->integer_literal = strtol(buffer, NULL, 10);
 
-      return (Token) {.token_type = IDENTIFIER_TOKEN, .literal = (Literal *) string_literal};
+      return (Literal *) integer_literal;
+    }
+
+    default: {
+      return NULL;
     }
   }
 }
@@ -550,6 +678,10 @@ Token _next_token(Lexer *lexer) {
 
 Token next_token(Lexer *lexer) {
   lexer->curr_token = lexer->next_token;
+
+  // the current token is read by the parser after the next one, so its text has to survive the refills
+  lexer->kept_position = lexer->next_token_position;
+  lexer->next_token_position = _get_position(lexer);
   lexer->next_token = _next_token(lexer);
 
   return lexer->curr_token;
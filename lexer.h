@@ -6,6 +6,9 @@
 #include <string.h>
 
 #include "bool.h"
+#include "arena.h"
+
+#define LEXER_STREAM_CHUNK_SIZE (64 * 1024)
 
 typedef enum {
   LiteralTypeBoolLiteral,
@@ -93,25 +96,41 @@ typedef enum {
   IN_TOKEN,
 } TokenType;
 
+// offset and length are the slice of the content the token was read from
 typedef struct {
   TokenType token_type;
   Literal *literal;
+  size_t offset;
+  size_t length;
 } Token;
 
+// a streaming lexer owns its content and refills it from fd, otherwise fd is -1 and the content belongs to the caller
+// function bodies are only deferred for content that stays in memory, since a lazy body points into it
 typedef struct {
   Token curr_token;
   Token next_token;
   char *content;
+  size_t content_length;
+  size_t content_offset;
+  size_t content_capacity;
+  int fd;
   size_t cursor;
+  size_t kept_position;
+  size_t next_token_position;
   char curr_char;
   char next_char;
+  Arena *arena;
+  bool should_defer_function_bodies;
 } Lexer;
 
 
-Lexer *new_lexer(char *content);
+Lexer *new_lexer(char *content, size_t content_length, Arena *arena);
+
+
+Lexer *new_stream_lexer(int fd, Arena *arena);
 
 
-void update_lexer(Lexer *lexer, char* content);
+void update_lexer(Lexer *lexer, char* content, size_t content_length);
 
 
 void free_lexer(Lexer *lexer);
@@ -120,6 +139,12 @@ void free_lexer(Lexer *lexer);
 Token _next_token(Lexer *lexer);
 
 
+char *get_token_text(Lexer *lexer, Token token);
+
+
+Literal *get_token_literal(Lexer *lexer, Token token);
+
+
 Token next_token(Lexer *lexer);
 
 
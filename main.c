@@ -1,14 +1,36 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "bool.h"
 #include "lexer.h"
 #include "ast.h"
+#include "resolver.h"
+#include "optimizer.h"
 #include "evaluator.h"
+#include "operation.h"
+#include "compiler.h"
+#include "vm.h"
+#include "gc.h"
 #include "system.h"
+#include "scanner.h"
+#include "flat.h"
+#include "cache.h"
+#include "hashtable.h"
+#include "utils.h"
+#include "module.h"
+#include "pool.h"
+#include "memory.h"
 #include "linenoise.h"
 
 #define TEST_MODE true
+#define LEXER_BENCH_ROUNDS 10
 
 static void signal_handler(int signo) {
   exit(EXIT_FAILURE);
@@ -17,8 +39,12 @@ static void signal_handler(int signo) {
 void run_repl() {
   char *s;
 
+  // statements stay alive for the whole session, functions defined in one line are called in the next ones
+  Arena *arena = new_arena();
   Lexer *lexer = NULL;
-  Scope *scope = new_scope(NULL, NULL, ScopeTypeNormalScope);
+  Block *block = new_block(arena);
+  Resolver *resolver = new_resolver(block);
+  Scope *scope = new_scope(NULL, block, ScopeTypeNormalScope);
 
   build_main_scope(scope);
 
@@ -26,10 +52,10 @@ void run_repl() {
 
   while ((s = linenoise(">> ")) != NULL) {
     if (lexer == NULL) {
-      lexer = new_lexer(s);
+      lexer = new_lexer(s, strlen(s), arena);
     }
     else {
-      update_lexer(lexer, s);
+      update_lexer(lexer, s, strlen(s));
     }
 
     Statement *statement = parse_statement(lexer);
@@ -37,79 +63,278 @@ void run_repl() {
     if (statement != NULL) {
       linenoiseHistoryAdd(s);
 
+      statement = optimize_statement(arena, statement);
+    }
+
+    if (statement != NULL) {
+      resolve_statement(resolver, statement);
+      scope_update_slots(scope);
+
+      size_t root_count = gc_save_roots();
+
 	  printf_statement(statement, 0);
       evaluate_statement(scope, statement, true);
 
-      free_statement(statement);
+      gc_restore_roots(root_count);
     }
 
     free(s);
   }
 }
 
-char *read_file(const char *filename) {
-  char *buffer;
-  FILE *file = fopen(filename, "r");
 
-  if (file) {
-    fseek(file, 0, SEEK_END);
+void run(char *filename, bool use_vm, bool should_optimize, bool should_print_ast, bool should_round_trip_flat_ast, bool should_use_cache, bool should_defer_function_bodies) {
+  size_t length;
+  char *s = map_file(filename, &length);
 
-    size_t string_size = (size_t) ftell(file);
+  if (s == NULL) {
+    printf("Could not read %s\n", filename);
+    return;
+  }
 
-    rewind(file);
+  // a cached program is rebuilt from its flat form, without lexing, parsing or optimizing the script again
+  FlatAST *flat_ast = NULL;
+  char *cache_path = NULL;
+  uint64_t source_hash = 0;
 
-    buffer = malloc(sizeof(char) * (string_size + 1));
+  if (should_use_cache) {
+    source_hash = hash_string(s, length);
+    cache_path = get_cache_path(filename, source_hash);
+    flat_ast = load_cache(cache_path, source_hash, length, should_optimize);
+  }
 
-    size_t read_size = fread(buffer, sizeof(char), string_size, file);
+  AST *ast;
 
-    if (string_size != read_size) {
-      free(buffer);
-      return NULL;
-    }
+  if (flat_ast != NULL) {
+    ast = unflatten_ast(flat_ast, new_arena());
+  }
+  else {
+    Lexer *lexer = new_lexer(s, length, new_arena());
+
+    // the vm compiles every body up front and the flat ast stores them all, so only the evaluator defers them
+    lexer->should_defer_function_bodies = should_defer_function_bodies && !use_vm && !should_use_cache && !should_round_trip_flat_ast;
 
-    buffer[string_size] = 0;
+    ast = parse_ast(lexer);
+    free_lexer(lexer);
 
-    return buffer;
+    if (should_optimize) optimize_ast(ast);
+
+    if (should_use_cache || should_round_trip_flat_ast) flat_ast = flatten_ast(ast);
+
+    if (should_use_cache) save_cache(cache_path, flat_ast, source_hash, length, should_optimize);
+
+    // checks the serialization the cache uses, the tree that runs is rebuilt from its flat form and the flat one is kept to be printed
+    if (should_round_trip_flat_ast) {
+      free_ast(ast);
+      ast = unflatten_ast(flat_ast, new_arena());
+    }
   }
 
-  return NULL;
-}
+  memory_free(cache_path);
+
+  resolve_ast(ast);
+
+#if TEST_MODE
+
+  should_print_ast = true;
+
+#endif
 
+  if (should_print_ast && flat_ast != NULL) printf_flat_ast(flat_ast);
+  else if (should_print_ast) printf_ast(ast);
 
-void run(char *filename) {
-  char *s = read_file(filename);
+  if (flat_ast != NULL) free_flat_ast(flat_ast);
 
-  Lexer *lexer = new_lexer(s);
-  AST *ast = parse_ast(lexer);
+  // a program too large for the operands of the vm is run by the evaluator instead
+  Chunk *chunk = use_vm ? compile_ast(ast) : NULL;
 
+  if (chunk != NULL) {
 #if TEST_MODE
 
-  printf_ast(ast);
+    printf_chunk(chunk, 0);
 
 #endif
 
-  evaluate_ast(ast);
+    execute_chunk(chunk);
+    free_chunk(chunk);
+  }
+  else {
+    evaluate_ast(ast);
+  }
 
+  free_modules();
   free_ast(ast);
-  free_lexer(lexer);
 
-  free(s);
+  if (length != 0) munmap(s, length);
+}
+
+
+// only lexes the script, the rounds are timed together to get the throughput of the lexer
+void bench_lexer(char *filename) {
+  size_t length;
+  char *s = map_file(filename, &length);
+
+  if (s == NULL) {
+    printf("Could not read %s\n", filename);
+    return;
+  }
+
+  Arena *arena = new_arena();
+  size_t token_count = 0;
+  struct timespec start_time, end_time;
+
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+  for (size_t i = 0; i < LEXER_BENCH_ROUNDS; i++) {
+    Lexer *lexer = new_lexer(s, length, arena);
+
+    while (next_token(lexer).token_type != EOF_TOKEN) token_count++;
+
+    free_lexer(lexer);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+  double seconds = (double) (end_time.tv_sec - start_time.tv_sec) + (double) (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+  double megabytes = (double) length * LEXER_BENCH_ROUNDS / (1024 * 1024);
+
+  printf("%s: %zu bytes, %zu tokens, %d rounds in %.3fs, %.1f MB/s with the %s scanner\n",
+         filename, length, token_count / LEXER_BENCH_ROUNDS, LEXER_BENCH_ROUNDS, seconds, megabytes / seconds, get_scanner_name());
+
+  free_arena(arena);
+
+  if (length != 0) munmap(s, length);
+}
+
+
+// each statement is evaluated as soon as it has been parsed, so a pipe runs while it is still written
+void run_stream(int fd) {
+  Arena *arena = new_arena();
+  Lexer *lexer = new_stream_lexer(fd, arena);
+  Block *block = new_block(arena);
+  Resolver *resolver = new_resolver(block);
+  Scope *scope = new_scope(NULL, block, ScopeTypeNormalScope);
+
+  build_main_scope(scope);
+
+  while (true) {
+    while (peek_token(lexer).token_type == EOL_TOKEN) next_token(lexer);
+
+    Statement *statement = parse_statement(lexer);
+
+    if (statement == NULL) break;
+
+    statement = optimize_statement(arena, statement);
+
+    if (statement == NULL) continue;
+
+    resolve_statement(resolver, statement);
+    scope_update_slots(scope);
+
+    size_t root_count = gc_save_roots();
+
+    evaluate_statement(scope, statement, false);
+
+    gc_restore_roots(root_count);
+  }
+
+  free_scope(scope);
+  free_modules();
+  gc_collect();
+
+  free_resolver(resolver);
+  free_lexer(lexer);
+  free_arena(arena);
 }
 
 int main(int argc, char **argv) {
   signal(SIGUSR1, signal_handler);
   signal(SIGSEGV, signal_handler);
 
+  char *filename = NULL;
+  bool use_vm = false;
+  bool should_optimize = true;
+  bool should_print_ast = false;
+  bool should_bench_lexer = false;
+  bool should_round_trip_flat_ast = false;
+  bool should_use_cache = false;
+  bool should_defer_function_bodies = false;
+  bool should_print_pool_stats = false;
+  bool should_print_memory_stats = false;
+
+  size_t gc_initial_heap_size = DEFAULT_GC_INITIAL_HEAP_SIZE;
+  double gc_heap_growth_factor = DEFAULT_GC_HEAP_GROWTH_FACTOR;
+  bool gc_stress_mode = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--vm") == 0) {
+      use_vm = true;
+    }
+    else if (strcmp(argv[i], "--no-optimize") == 0) {
+      should_optimize = false;
+    }
+    else if (strcmp(argv[i], "--print-ast") == 0) {
+      should_print_ast = true;
+    }
+    else if (strcmp(argv[i], "--flat-ast-round-trip") == 0) {
+      should_round_trip_flat_ast = true;
+    }
+    else if (strcmp(argv[i], "--cache") == 0) {
+      should_use_cache = true;
+    }
+    else if (strcmp(argv[i], "--lazy") == 0) {
+      should_defer_function_bodies = true;
+    }
+    else if (strcmp(argv[i], "--pool-stats") == 0) {
+      should_print_pool_stats = true;
+    }
+    else if (strcmp(argv[i], "--memory-stats") == 0) {
+      should_print_memory_stats = true;
+    }
+    else if (strncmp(argv[i], "--memory-limit=", 15) == 0) {
+      set_memory_limit(strtoull(argv[i] + 15, NULL, 10));
+    }
+    else if (strcmp(argv[i], "--bench-lexer") == 0) {
+      should_bench_lexer = true;
+    }
+    else if (strcmp(argv[i], "--gc-stress") == 0) {
+      gc_stress_mode = true;
+    }
+    else if (strncmp(argv[i], "--gc-initial-heap=", 18) == 0) {
+      gc_initial_heap_size = strtoull(argv[i] + 18, NULL, 10);
+    }
+    else if (strncmp(argv[i], "--gc-heap-growth=", 17) == 0) {
+      gc_heap_growth_factor = strtod(argv[i] + 17, NULL);
+    }
+    else {
+      filename = argv[i];
+    }
+  }
+
+  gc_configure(gc_initial_heap_size, gc_heap_growth_factor, gc_stress_mode);
+  build_operation_table();
+
 #if TEST_MODE
-  run("../main.pie");
-#else
-  if (argc == 2) {
-    run(argv[1]);
+  if (filename == NULL) filename = "../main.pie";
+#endif
+
+  configure_modules(filename != NULL && strcmp(filename, "-") != 0 ? filename : NULL, should_optimize, should_defer_function_bodies);
+
+  if (filename != NULL && should_bench_lexer) {
+    bench_lexer(filename);
+  }
+  else if (filename != NULL && strcmp(filename, "-") == 0) {
+    run_stream(STDIN_FILENO);
+  }
+  else if (filename != NULL) {
+    run(filename, use_vm, should_optimize, should_print_ast, should_round_trip_flat_ast, should_use_cache, should_defer_function_bodies);
   }
   else {
     run_repl();
   }
-#endif
+
+  if (should_print_pool_stats) printf_pool_stats();
+  if (should_print_memory_stats) printf_memory_stats();
 
   return 0;
 }
@@ -0,0 +1,226 @@
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static char *subsystem_names[MEMORY_SUBSYSTEM_COUNT] = {
+    "value",
+    "string",
+    "scope",
+    "ast",
+    "arena",
+    "lexer",
+    "hash table",
+    "compiler",
+    "gc",
+    "module",
+    "cache",
+};
+
+
+void *_system_allocate(void *context, size_t size) {
+  (void) context;
+
+  return malloc(size);
+}
+
+
+void *_system_reallocate(void *context, void *block, size_t old_size, size_t size) {
+  (void) context;
+  (void) old_size;
+
+  return realloc(block, size);
+}
+
+
+void _system_free(void *context, void *block, size_t size) {
+  (void) context;
+  (void) size;
+
+  free(block);
+}
+
+
+static Allocator system_allocator = {
+    .allocate = _system_allocate,
+    .reallocate = _system_reallocate,
+    .free = _system_free,
+    .context = NULL,
+};
+
+static Memory memory = {
+    .allocator = &system_allocator,
+    .live_bytes = 0,
+    .peak_bytes = 0,
+};
+
+
+// a refused block is NULL, the same as a parent that is out of memory
+void *_limit_allocate(void *context, size_t size) {
+  LimitAllocator *limit_allocator = context;
+
+  if (size > limit_allocator->limit - limit_allocator->used_bytes) return NULL;
+
+  void *block = limit_allocator->parent->allocate(limit_allocator->parent->context, size);
+
+  if (block != NULL) limit_allocator->used_bytes += size;
+
+  return block;
+}
+
+
+void *_limit_reallocate(void *context, void *block, size_t old_size, size_t size) {
+  LimitAllocator *limit_allocator = context;
+
+  if (size > old_size && size - old_size > limit_allocator->limit - limit_allocator->used_bytes) return NULL;
+
+  block = limit_allocator->parent->reallocate(limit_allocator->parent->context, block, old_size, size);
+
+  if (block != NULL) limit_allocator->used_bytes = limit_allocator->used_bytes - old_size + size;
+
+  return block;
+}
+
+
+void _limit_free(void *context, void *block, size_t size) {
+  LimitAllocator *limit_allocator = context;
+
+  limit_allocator->used_bytes -= size;
+  limit_allocator->parent->free(limit_allocator->parent->context, block, size);
+}
+
+
+// the limit allocator lives as long as the process, so it is taken from its parent without a header
+LimitAllocator *new_limit_allocator(Allocator *parent, size_t limit) {
+  LimitAllocator *limit_allocator = parent->allocate(parent->context, sizeof(LimitAllocator));
+
+  if (limit_allocator == NULL) return NULL;
+
+  limit_allocator->allocator = (Allocator) {
+      .allocate = _limit_allocate,
+      .reallocate = _limit_reallocate,
+      .free = _limit_free,
+      .context = limit_allocator,
+  };
+  limit_allocator->parent = parent;
+  limit_allocator->limit = limit;
+  limit_allocator->used_bytes = 0;
+
+  return limit_allocator;
+}
+
+
+// the allocator has to be set before anything is allocated, a block is always freed by the allocator that made it
+void set_allocator(Allocator *allocator) {
+  memory.allocator = allocator == NULL ? &system_allocator : allocator;
+}
+
+
+// 0 is no limit
+void set_memory_limit(size_t limit) {
+  if (limit == 0) return;
+
+  LimitAllocator *limit_allocator = new_limit_allocator(memory.allocator, limit);
+
+  if (limit_allocator != NULL) set_allocator(&limit_allocator->allocator);
+}
+
+
+// a script that runs out of memory or over its limit can not go on, there is no error value to give back
+void _check_memory(void *block, size_t size) {
+  if (block == NULL) {
+    printf("out of memory allocating %zu bytes, %zu bytes in use\n", size, memory.live_bytes);
+    exit(1);
+  }
+}
+
+
+void _count_bytes(MemorySubsystem subsystem, size_t old_size, size_t size) {
+  MemoryStats *stats = &memory.stats[subsystem];
+
+  memory.live_bytes = memory.live_bytes - old_size + size;
+  stats->live_bytes = stats->live_bytes - old_size + size;
+
+  if (memory.live_bytes > memory.peak_bytes) memory.peak_bytes = memory.live_bytes;
+  if (stats->live_bytes > stats->peak_bytes) stats->peak_bytes = stats->live_bytes;
+}
+
+
+void *memory_allocate(MemorySubsystem subsystem, size_t size) {
+  if (size > SIZE_MAX - MEMORY_HEADER_SIZE) _check_memory(NULL, size);
+
+  MemoryHeader *header = memory.allocator->allocate(memory.allocator->context, MEMORY_HEADER_SIZE + size);
+
+  _check_memory(header, size);
+
+  header->size = size;
+  header->subsystem = subsystem;
+
+  memory.stats[subsystem].allocation_count++;
+  _count_bytes(subsystem, 0, size);
+
+  return (char *) header + MEMORY_HEADER_SIZE;
+}
+
+
+// a count and size whose product does not fit is out of memory, like a calloc that fails
+void *memory_allocate_zeroed(MemorySubsystem subsystem, size_t count, size_t size) {
+  if (size != 0 && count > SIZE_MAX / size) _check_memory(NULL, SIZE_MAX);
+
+  void *block = memory_allocate(subsystem, count * size);
+
+  memset(block, 0, count * size);
+
+  return block;
+}
+
+
+// a block keeps the subsystem it was allocated for, the one given is only used for a new block
+void *memory_reallocate(MemorySubsystem subsystem, void *block, size_t size) {
+  if (block == NULL) return memory_allocate(subsystem, size);
+
+  MemoryHeader *header = (MemoryHeader *) ((char *) block - MEMORY_HEADER_SIZE);
+  size_t old_size = header->size;
+
+  if (size > SIZE_MAX - MEMORY_HEADER_SIZE) _check_memory(NULL, size);
+
+  header = memory.allocator->reallocate(memory.allocator->context, header, MEMORY_HEADER_SIZE + old_size, MEMORY_HEADER_SIZE + size);
+
+  _check_memory(header, size);
+
+  header->size = size;
+
+  memory.stats[header->subsystem].reallocation_count++;
+  _count_bytes(header->subsystem, old_size, size);
+
+  return (char *) header + MEMORY_HEADER_SIZE;
+}
+
+
+void memory_free(void *block) {
+  if (block == NULL) return;
+
+  MemoryHeader *header = (MemoryHeader *) ((char *) block - MEMORY_HEADER_SIZE);
+  size_t size = header->size;
+
+  memory.stats[header->subsystem].free_count++;
+  _count_bytes(header->subsystem, size, 0);
+
+  memory.allocator->free(memory.allocator->context, header, MEMORY_HEADER_SIZE + size);
+}
+
+
+void printf_memory_stats() {
+  printf("%-12s %12s %12s %12s %10s %10s\n", "subsystem", "live", "peak", "allocations", "reallocs", "frees");
+
+  for (size_t i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+    MemoryStats *stats = &memory.stats[i];
+
+    if (stats->allocation_count == 0) continue;
+
+    printf("%-12s %12zu %12zu %12zu %10zu %10zu\n", subsystem_names[i], stats->live_bytes, stats->peak_bytes, stats->allocation_count, stats->reallocation_count, stats->free_count);
+  }
+
+  printf("%-12s %12zu %12zu\n", "total", memory.live_bytes, memory.peak_bytes);
+}
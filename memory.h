@@ -0,0 +1,90 @@
+#ifndef PIELANG_MEMORY_H
+#define PIELANG_MEMORY_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+
+#define MEMORY_SUBSYSTEM_COUNT 11
+
+// the header keeps the block after it aligned like a long double
+#define MEMORY_HEADER_SIZE 16
+
+typedef enum {
+  MemorySubsystemValue = 0,
+  MemorySubsystemString,
+  MemorySubsystemScope,
+  MemorySubsystemAST,
+  MemorySubsystemArena,
+  MemorySubsystemLexer,
+  MemorySubsystemHashTable,
+  MemorySubsystemCompiler,
+  MemorySubsystemGC,
+  MemorySubsystemModule,
+  MemorySubsystemCache,
+} MemorySubsystem;
+
+// the old size is passed back so an allocator does not have to remember it, a bump allocator can copy the block
+typedef struct {
+  void *(*allocate)(void *context, size_t size);
+  void *(*reallocate)(void *context, void *block, size_t old_size, size_t size);
+  void (*free)(void *context, void *block, size_t size);
+  void *context;
+} Allocator;
+
+// every block starts with a header, so a block can be freed or grown by any subsystem and is still counted to the one that made it
+typedef struct {
+  size_t size;
+  MemorySubsystem subsystem;
+} MemoryHeader;
+
+typedef struct {
+  size_t allocation_count;
+  size_t reallocation_count;
+  size_t free_count;
+  size_t live_bytes;
+  size_t peak_bytes;
+} MemoryStats;
+
+// refuses a block once the bytes it took from its parent would go over the limit, the allocator is first so it can be set
+typedef struct {
+  Allocator allocator;
+  Allocator *parent;
+  size_t limit;
+  size_t used_bytes;
+} LimitAllocator;
+
+typedef struct {
+  Allocator *allocator;
+  MemoryStats stats[MEMORY_SUBSYSTEM_COUNT];
+  size_t live_bytes;
+  size_t peak_bytes;
+} Memory;
+
+
+LimitAllocator *new_limit_allocator(Allocator *parent, size_t limit);
+
+
+void set_allocator(Allocator *allocator);
+
+
+// puts a limit allocator in front of the current one
+void set_memory_limit(size_t limit);
+
+
+void *memory_allocate(MemorySubsystem subsystem, size_t size);
+
+
+void *memory_allocate_zeroed(MemorySubsystem subsystem, size_t count, size_t size);
+
+
+void *memory_reallocate(MemorySubsystem subsystem, void *block, size_t size);
+
+
+void memory_free(void *block);
+
+
+void printf_memory_stats();
+
+
+#endif //PIELANG_MEMORY_H
@@ -0,0 +1,227 @@
+#include "module.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+#include "hashtable.h"
+#include "lexer.h"
+#include "resolver.h"
+#include "optimizer.h"
+#include "evaluator.h"
+#include "system.h"
+#include "symbol.h"
+#include "gc.h"
+#include "utils.h"
+#include "memory.h"
+
+static HashTable *module_map = NULL;
+static char *main_directory = NULL;
+static char *main_path = NULL;
+static char *importer_directory = NULL;
+static bool should_optimize_modules = true;
+static bool should_defer_module_function_bodies = false;
+
+
+char *_get_directory(const char *path) {
+  char *separator = strrchr(path, '/');
+
+  if (separator == NULL) return copy_string(".");
+  if (separator == path) return copy_string("/");
+
+  return create_string_from_buffer((char *) path, (size_t) (separator - path));
+}
+
+
+// the paths of the imports in a script are relative to the script, not to the working directory
+void configure_modules(const char *main_filename, bool should_optimize, bool should_defer_function_bodies) {
+  memory_free(main_directory);
+
+  main_directory = main_filename == NULL ? copy_string(".") : _get_directory(main_filename);
+  main_path = NULL;
+  importer_directory = main_directory;
+  should_optimize_modules = should_optimize;
+  should_defer_module_function_bodies = should_defer_function_bodies;
+
+  char *canonical_path = main_filename == NULL ? NULL : realpath(main_filename, NULL);
+
+  if (canonical_path != NULL) {
+    main_path = intern_string(canonical_path);
+    free(canonical_path);
+  }
+}
+
+
+char *_get_canonical_path(const char *name) {
+  char *directory = importer_directory == NULL ? "." : importer_directory;
+  size_t length = strlen(directory) + strlen(name) + strlen(MODULE_EXTENSION) + 2;
+  char *path = memory_allocate(MemorySubsystemModule, length);
+
+  if (name[0] == '/') snprintf(path, length, "%s", name);
+  else snprintf(path, length, "%s/%s", directory, name);
+
+  char *canonical_path = realpath(path, NULL);
+
+  // the extension can be left out of the import
+  if (canonical_path == NULL) {
+    strcat(path, MODULE_EXTENSION);
+    canonical_path = realpath(path, NULL);
+  }
+
+  memory_free(path);
+
+  return canonical_path;
+}
+
+
+Module *_load_module(char *path) {
+  size_t content_length;
+  char *content = map_file(path, &content_length);
+
+  if (content == NULL) {
+    printf("Could not read %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+
+  Module *module = memory_allocate(MemorySubsystemModule, sizeof(Module));
+
+  module->path = path;
+  module->directory = _get_directory(path);
+  module->content = content;
+  module->content_length = content_length;
+  module->has_loaded = false;
+
+  Lexer *lexer = new_lexer(content, content_length, new_arena());
+
+  lexer->should_defer_function_bodies = should_defer_module_function_bodies;
+
+  module->ast = parse_ast(lexer);
+  free_lexer(lexer);
+
+  if (should_optimize_modules) optimize_ast(module->ast);
+
+  resolve_ast(module->ast);
+
+  module->scope = new_scope(NULL, module->ast->block, ScopeTypeNormalScope);
+  build_main_scope(module->scope);
+
+  // the module is cached before it runs, so an import cycle gets the names defined so far instead of looping
+  hash_table_set(module_map, path, module);
+
+  char *directory = importer_directory;
+
+  importer_directory = module->directory;
+  evaluate_scope(module->scope);
+  importer_directory = directory;
+
+  module->has_loaded = true;
+
+  return module;
+}
+
+
+// the main script is a module too, so an import cycle back to it binds the names defined so far instead of running it again
+void register_main_module(Scope *scope) {
+  if (main_path == NULL) return;
+
+  Module *module = memory_allocate(MemorySubsystemModule, sizeof(Module));
+
+  module->path = main_path;
+  module->directory = copy_string(main_directory);
+  module->content = NULL;
+  module->content_length = 0;
+  module->ast = NULL;
+  module->scope = scope;
+  module->has_loaded = false;
+
+  if (module_map == NULL) module_map = new_hash_table(MODULE_MAP_SIZE, HashTableTypeModuleMap);
+
+  hash_table_set(module_map, main_path, module);
+}
+
+
+// a script can not go on without the names it imports, like after a parser error
+Module *import_module(const char *name) {
+  char *canonical_path = _get_canonical_path(name);
+
+  if (canonical_path == NULL) {
+    printf("Could not find module %s\n", name);
+    exit(EXIT_FAILURE);
+  }
+
+  char *path = intern_string(canonical_path);
+
+  free(canonical_path);
+
+  if (module_map == NULL) module_map = new_hash_table(MODULE_MAP_SIZE, HashTableTypeModuleMap);
+
+  Module *module = hash_table_get(module_map, path);
+
+  if (module != NULL) return module;
+
+  return _load_module(path);
+}
+
+
+void _bind_variable(Scope *scope, Variable *variable) {
+  if (variable->value == NULL || get_value_type(variable->value) == ValueTypeSystemFunctionValue) return;
+
+  scope_set_variable(scope, ValueTypeNullValue, variable->variable_name, share_value(variable->value), false);
+}
+
+
+// the values are shared with the module, a name the importer declared itself lands in its slot
+void bind_module(Scope *scope, Module *module) {
+  Scope *module_scope = module->scope;
+
+  for (size_t i = 0; i < module_scope->slot_count; i++) {
+    _bind_variable(scope, &module_scope->slots[i]);
+  }
+
+  HashTable *variable_map = module_scope->variable_maps[ValueTypeNullValue];
+
+  if (variable_map == NULL) return;
+
+  size_t index = 0;
+  HashTableEntry *entry;
+
+  while ((entry = hash_table_next_entry(variable_map, &index)) != NULL) {
+    _bind_variable(scope, (Variable *) entry->literal);
+  }
+}
+
+
+// the main module only borrows the scope of the script, which has its own ast
+void free_module(Module *module) {
+  if (module->ast != NULL) {
+    free_scope(module->scope);
+    free_ast(module->ast);
+  }
+
+  if (module->content_length != 0) munmap(module->content, module->content_length);
+
+  memory_free(module->directory);
+  memory_free(module);
+}
+
+
+void free_modules() {
+  if (module_map != NULL) {
+    size_t index = 0;
+    HashTableEntry *entry;
+
+    while ((entry = hash_table_next_entry(module_map, &index)) != NULL) {
+      free_module((Module *) entry->literal);
+    }
+
+    free_hash_table(module_map);
+  }
+
+  memory_free(main_directory);
+
+  module_map = NULL;
+  main_directory = NULL;
+  main_path = NULL;
+  importer_directory = NULL;
+}
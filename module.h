@@ -0,0 +1,43 @@
+#ifndef PIELANG_MODULE_H
+#define PIELANG_MODULE_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "scope.h"
+
+#define MODULE_EXTENSION ".pie"
+#define MODULE_MAP_SIZE 16
+
+// a module is loaded once per canonical path and keeps its scope, so its functions still see its globals
+typedef struct {
+  char *path;
+  char *directory;
+  char *content;
+  size_t content_length;
+  AST *ast;
+  Scope *scope;
+  bool has_loaded;
+} Module;
+
+
+void configure_modules(const char *main_filename, bool should_optimize, bool should_defer_function_bodies);
+
+
+void register_main_module(Scope *scope);
+
+
+Module *import_module(const char *name);
+
+
+void bind_module(Scope *scope, Module *module);
+
+
+void free_module(Module *module);
+
+
+void free_modules();
+
+
+#endif //PIELANG_MODULE_H
@@ -0,0 +1,611 @@
+#include "operation.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "value.h"
+#include "memory.h"
+#include "gc.h"
+
+// operation_kernels[operator][left type][right type], filled by build_operation_table
+static OperationKernel operation_kernels[OPERATOR_COUNT][VALUE_TYPE_COUNT][VALUE_TYPE_COUNT];
+
+
+// the generic kernels below handle every pair of types an operator accepts, the specialized ones after them skip the type checks
+
+
+Value *apply_null_operation(Value *left_value, Value *right_value) {
+  return new_null_value();
+}
+
+
+Value *apply_range_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_generator_value(GeneratorValueTypeNumber, left_value, right_value);
+  }
+
+  return new_null_value();
+}
+
+
+Value *apply_addition_operation(Value *left_value, Value *right_value) {
+  // the side that is not a string is converted to one, then both are added like two strings
+  if (get_value_type(left_value) == ValueTypeStringValue || get_value_type(right_value) == ValueTypeStringValue) {
+    if (get_value_type(left_value) != ValueTypeStringValue) left_value = convert_to_string_value(left_value);
+    if (get_value_type(right_value) != ValueTypeStringValue) right_value = convert_to_string_value(right_value);
+
+    // a function has no string form
+    if (get_value_type(left_value) != ValueTypeStringValue || get_value_type(right_value) != ValueTypeStringValue) return new_null_value();
+
+    return apply_string_addition_operation(left_value, right_value);
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+      return new_integer_value(get_integer_value(left_value) + get_integer_value(right_value));
+    }
+    else {
+      long double left_float, right_float;
+
+      if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+      else left_float = get_integer_value(left_value);
+
+      if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+      else right_float = get_integer_value(right_value);
+
+      return new_float_value(left_float + right_float);
+    }
+  }
+  else if ((get_value_type(left_value) == ValueTypeTupleValue || get_value_type(left_value) == ValueTypeListValue) && (get_value_type(right_value) == ValueTypeTupleValue || get_value_type(right_value) == ValueTypeListValue)) {
+    Value **left_array_items, **right_array_items, **result_items;
+    size_t left_array_item_length, right_array_item_length;
+
+    if (get_value_type(left_value) == ValueTypeListValue) {
+      left_array_items = ((ListValue *) left_value)->items;
+      left_array_item_length = ((ListValue *) left_value)->length;
+    }
+    else {
+      left_array_items = ((TupleValue *) left_value)->items;
+      left_array_item_length = ((TupleValue *) left_value)->length;
+    }
+
+    if (get_value_type(right_value) == ValueTypeListValue) {
+      right_array_items = ((ListValue *) right_value)->items;
+      right_array_item_length = ((ListValue *) right_value)->length;
+    }
+    else {
+      right_array_items = ((TupleValue *) right_value)->items;
+      right_array_item_length = ((TupleValue *) right_value)->length;
+    }
+
+    result_items = memory_allocate(MemorySubsystemValue, (left_array_item_length + right_array_item_length) * sizeof(Value *));
+
+    for (int i = 0; i < left_array_item_length; i++) {
+      result_items[i] = left_array_items[i];
+    }
+
+    for (int i = 0; i < right_array_item_length; i++) {
+      result_items[i + left_array_item_length] = right_array_items[i];
+    }
+
+    return new_list_value(result_items, left_array_item_length + right_array_item_length, true);
+  }
+
+  return new_null_value();
+}
+
+
+Value *apply_subtraction_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_integer_value(get_integer_value(left_value) - get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_float_value(left_float - right_float);
+  }
+
+  return new_null_value();
+}
+
+
+Value *apply_multiplication_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_integer_value(get_integer_value(left_value) * get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_float_value(left_float * right_float);
+  }
+
+  return new_null_value();
+}
+
+
+Value *_apply_division_operation(Value *left_value, Value *right_value, bool is_integer_division) {
+  if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float, result;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    result = left_float / right_float;
+
+    if (is_integer_division || ceil(result) == floor(result)) {
+      return new_integer_value((long long int) result);
+    }
+    else {
+      return new_float_value(result);
+    }
+  }
+
+  return new_null_value();
+}
+
+
+Value *apply_division_operation(Value *left_value, Value *right_value) {
+  return _apply_division_operation(left_value, right_value, false);
+}
+
+
+Value *apply_integer_division_operation(Value *left_value, Value *right_value) {
+  return _apply_division_operation(left_value, right_value, true);
+}
+
+
+Value *apply_exponent_operation(Value *left_value, Value *right_value) {
+  if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float, result;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    result = pow(left_float, right_float);
+
+    if (ceil(result) == floor(result)) {
+      return new_integer_value((long long int) result);
+    }
+    else {
+      return new_float_value(result);
+    }
+  }
+
+  return new_null_value();
+}
+
+
+Value *apply_mod_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_integer_value(get_integer_value(left_value) % get_integer_value(right_value));
+  }
+
+  return new_null_value();
+}
+
+
+// a long string compares its cached hash first, so the chars of two different strings are mostly not compared
+bool _is_string_value_equal(StringValue *left_string_value, StringValue *right_string_value) {
+  if (left_string_value == right_string_value) return true;
+  if (left_string_value->length != right_string_value->length) return false;
+
+  if (left_string_value->length >= STRING_INLINE_CAPACITY && get_string_value_hash(left_string_value) != get_string_value_hash(right_string_value)) return false;
+
+  return memcmp(get_string_chars(left_string_value), get_string_chars(right_string_value), left_string_value->length) == 0;
+}
+
+
+Value *apply_check_equality_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_bool_value(get_integer_value(left_value) == get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_bool_value(left_float == right_float);
+  }
+  else if (get_value_type(left_value) == ValueTypeStringValue  && get_value_type(right_value) == ValueTypeStringValue) {
+    return new_bool_value(_is_string_value_equal((StringValue *) left_value, (StringValue *) right_value));
+  }
+
+  return new_bool_value(convert_to_integer(left_value) == convert_to_integer(right_value));
+}
+
+
+Value *apply_check_not_equality_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_bool_value(get_integer_value(left_value) != get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_bool_value(left_float != right_float);
+  }
+  else if (get_value_type(left_value) == ValueTypeStringValue  && get_value_type(right_value) == ValueTypeStringValue) {
+    return new_bool_value(!_is_string_value_equal((StringValue *) left_value, (StringValue *) right_value));
+  }
+
+  return new_bool_value(convert_to_integer(left_value) != convert_to_integer(right_value));
+}
+
+
+Value *apply_check_bigger_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_bool_value(get_integer_value(left_value) > get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_bool_value(left_float > right_float);
+  }
+
+  return new_bool_value(convert_to_integer(left_value) > convert_to_integer(right_value));
+}
+
+
+Value *apply_check_bigger_equal_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_bool_value(get_integer_value(left_value) >= get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_bool_value(left_float >= right_float);
+  }
+
+  return new_bool_value(convert_to_integer(left_value) >= convert_to_integer(right_value));
+}
+
+
+Value *apply_check_smaller_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_bool_value(get_integer_value(left_value) < get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_bool_value(left_float < right_float);
+  }
+
+  return new_bool_value(convert_to_integer(left_value) < convert_to_integer(right_value));
+}
+
+
+Value *apply_check_smaller_equal_operation(Value *left_value, Value *right_value) {
+  if (get_value_type(left_value) == ValueTypeIntegerValue && get_value_type(right_value) == ValueTypeIntegerValue) {
+    return new_bool_value(get_integer_value(left_value) <= get_integer_value(right_value));
+  }
+  else if ((get_value_type(left_value) == ValueTypeIntegerValue || get_value_type(left_value) == ValueTypeFloatValue) && (get_value_type(right_value) == ValueTypeIntegerValue || get_value_type(right_value) == ValueTypeFloatValue)) {
+    long double left_float, right_float;
+
+    if (get_value_type(left_value) == ValueTypeFloatValue) left_float = ((FloatValue *) left_value)->float_value;
+    else left_float = get_integer_value(left_value);
+
+    if (get_value_type(right_value) == ValueTypeFloatValue) right_float = ((FloatValue *) right_value)->float_value;
+    else right_float = get_integer_value(right_value);
+
+    return new_bool_value(left_float <= right_float);
+  }
+
+  return new_bool_value(convert_to_integer(left_value) <= convert_to_integer(right_value));
+}
+
+
+Value *apply_integer_addition_operation(Value *left_value, Value *right_value) {
+  return new_integer_value(get_integer_value(left_value) + get_integer_value(right_value));
+}
+
+
+Value *apply_integer_subtraction_operation(Value *left_value, Value *right_value) {
+  return new_integer_value(get_integer_value(left_value) - get_integer_value(right_value));
+}
+
+
+Value *apply_integer_multiplication_operation(Value *left_value, Value *right_value) {
+  return new_integer_value(get_integer_value(left_value) * get_integer_value(right_value));
+}
+
+
+// a zero divisor and a division with a remainder give the same results as the generic kernel
+Value *apply_integer_true_division_operation(Value *left_value, Value *right_value) {
+  long long int left_integer = get_integer_value(left_value);
+  long long int right_integer = get_integer_value(right_value);
+
+  if (right_integer == 0 || left_integer % right_integer != 0) return apply_division_operation(left_value, right_value);
+
+  return new_integer_value(left_integer / right_integer);
+}
+
+
+Value *apply_integer_integer_division_operation(Value *left_value, Value *right_value) {
+  long long int right_integer = get_integer_value(right_value);
+
+  if (right_integer == 0) return apply_integer_division_operation(left_value, right_value);
+
+  return new_integer_value(get_integer_value(left_value) / right_integer);
+}
+
+
+Value *apply_integer_check_equality_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(get_integer_value(left_value) == get_integer_value(right_value));
+}
+
+
+Value *apply_integer_check_not_equality_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(get_integer_value(left_value) != get_integer_value(right_value));
+}
+
+
+Value *apply_integer_check_bigger_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(get_integer_value(left_value) > get_integer_value(right_value));
+}
+
+
+Value *apply_integer_check_bigger_equal_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(get_integer_value(left_value) >= get_integer_value(right_value));
+}
+
+
+Value *apply_integer_check_smaller_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(get_integer_value(left_value) < get_integer_value(right_value));
+}
+
+
+Value *apply_integer_check_smaller_equal_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(get_integer_value(left_value) <= get_integer_value(right_value));
+}
+
+
+Value *apply_float_addition_operation(Value *left_value, Value *right_value) {
+  return new_float_value(((FloatValue *) left_value)->float_value + ((FloatValue *) right_value)->float_value);
+}
+
+
+// the generic kernel subtracts in double precision
+Value *apply_float_subtraction_operation(Value *left_value, Value *right_value) {
+  return new_float_value((double) ((FloatValue *) left_value)->float_value - (double) ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_multiplication_operation(Value *left_value, Value *right_value) {
+  return new_float_value(((FloatValue *) left_value)->float_value * ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_check_equality_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(((FloatValue *) left_value)->float_value == ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_check_not_equality_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(((FloatValue *) left_value)->float_value != ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_check_bigger_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(((FloatValue *) left_value)->float_value > ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_check_bigger_equal_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(((FloatValue *) left_value)->float_value >= ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_check_smaller_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(((FloatValue *) left_value)->float_value < ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_float_check_smaller_equal_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(((FloatValue *) left_value)->float_value <= ((FloatValue *) right_value)->float_value);
+}
+
+
+Value *apply_string_addition_operation(Value *left_value, Value *right_value) {
+  StringValue *left_string_value = (StringValue *) left_value;
+  StringValue *right_string_value = (StringValue *) right_value;
+
+  size_t length = left_string_value->length + right_string_value->length;
+
+  if (length >= STRING_ROPE_MIN_LENGTH) return new_rope_string_value(left_string_value, right_string_value);
+
+  // a short result is put together on the stack and copied into the value, it needs no buffer of its own
+  char inline_string[STRING_INLINE_CAPACITY];
+  char *result_string = length < STRING_INLINE_CAPACITY ? inline_string : memory_allocate(MemorySubsystemString, length + 1);
+
+  memcpy(result_string, get_string_chars(left_string_value), left_string_value->length);
+  memcpy(result_string + left_string_value->length, get_string_chars(right_string_value), right_string_value->length + 1);
+
+  if (result_string == inline_string) return new_string_value_from_buffer(inline_string, length);
+
+  return new_string_value(result_string, length);
+}
+
+
+Value *apply_string_check_equality_operation(Value *left_value, Value *right_value) {
+  StringValue *left_string_value = (StringValue *) left_value;
+  StringValue *right_string_value = (StringValue *) right_value;
+
+  return new_bool_value(_is_string_value_equal(left_string_value, right_string_value));
+}
+
+
+Value *apply_string_check_not_equality_operation(Value *left_value, Value *right_value) {
+  return new_bool_value(!get_bool_value(apply_string_check_equality_operation(left_value, right_value)));
+}
+
+
+void register_operation(Operator operator, OperationKernel kernel) {
+  for (size_t i = 0; i < VALUE_TYPE_COUNT; i++) {
+    for (size_t j = 0; j < VALUE_TYPE_COUNT; j++) {
+      operation_kernels[operator][i][j] = kernel;
+    }
+  }
+}
+
+
+void register_operation_kernel(Operator operator, ValueType left_value_type, ValueType right_value_type, OperationKernel kernel) {
+  operation_kernels[operator][left_value_type][right_value_type] = kernel;
+}
+
+
+void build_operation_table() {
+  for (size_t i = 0; i < OPERATOR_COUNT; i++) {
+    register_operation(i, apply_null_operation);
+  }
+
+  register_operation(ADDITION_OP, apply_addition_operation);
+  register_operation(SUBTRACTION_OP, apply_subtraction_operation);
+  register_operation(MULTIPLICATION_OP, apply_multiplication_operation);
+  register_operation(DIVISION_OP, apply_division_operation);
+  register_operation(INTEGER_DIVISION_OP, apply_integer_division_operation);
+  register_operation(EXPONENT_OP, apply_exponent_operation);
+  register_operation(MOD_OP, apply_mod_operation);
+  register_operation(RANGE_OP, apply_range_operation);
+  register_operation(CHECK_EQUALITY_OP, apply_check_equality_operation);
+  register_operation(CHECK_NOT_EQUALITY_OP, apply_check_not_equality_operation);
+  register_operation(CHECK_BIGGER_OP, apply_check_bigger_operation);
+  register_operation(CHECK_BIGGER_EQUAL_OP, apply_check_bigger_equal_operation);
+  register_operation(CHECK_SMALLER_OP, apply_check_smaller_operation);
+  register_operation(CHECK_SMALLER_EQUAL_OP, apply_check_smaller_equal_operation);
+
+  register_operation_kernel(ADDITION_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_addition_operation);
+  register_operation_kernel(SUBTRACTION_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_subtraction_operation);
+  register_operation_kernel(MULTIPLICATION_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_multiplication_operation);
+  register_operation_kernel(DIVISION_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_true_division_operation);
+  register_operation_kernel(INTEGER_DIVISION_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_integer_division_operation);
+  register_operation_kernel(CHECK_EQUALITY_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_check_equality_operation);
+  register_operation_kernel(CHECK_NOT_EQUALITY_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_check_not_equality_operation);
+  register_operation_kernel(CHECK_BIGGER_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_check_bigger_operation);
+  register_operation_kernel(CHECK_BIGGER_EQUAL_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_check_bigger_equal_operation);
+  register_operation_kernel(CHECK_SMALLER_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_check_smaller_operation);
+  register_operation_kernel(CHECK_SMALLER_EQUAL_OP, ValueTypeIntegerValue, ValueTypeIntegerValue, apply_integer_check_smaller_equal_operation);
+
+  register_operation_kernel(ADDITION_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_addition_operation);
+  register_operation_kernel(SUBTRACTION_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_subtraction_operation);
+  register_operation_kernel(MULTIPLICATION_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_multiplication_operation);
+  register_operation_kernel(CHECK_EQUALITY_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_check_equality_operation);
+  register_operation_kernel(CHECK_NOT_EQUALITY_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_check_not_equality_operation);
+  register_operation_kernel(CHECK_BIGGER_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_check_bigger_operation);
+  register_operation_kernel(CHECK_BIGGER_EQUAL_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_check_bigger_equal_operation);
+  register_operation_kernel(CHECK_SMALLER_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_check_smaller_operation);
+  register_operation_kernel(CHECK_SMALLER_EQUAL_OP, ValueTypeFloatValue, ValueTypeFloatValue, apply_float_check_smaller_equal_operation);
+
+  register_operation_kernel(ADDITION_OP, ValueTypeStringValue, ValueTypeStringValue, apply_string_addition_operation);
+  register_operation_kernel(CHECK_EQUALITY_OP, ValueTypeStringValue, ValueTypeStringValue, apply_string_check_equality_operation);
+  register_operation_kernel(CHECK_NOT_EQUALITY_OP, ValueTypeStringValue, ValueTypeStringValue, apply_string_check_not_equality_operation);
+}
+
+
+// only an addition whose result has the type of the left value, a boxed integer stays boxed only while it is out of the immediate range
+bool apply_in_place_operation(Operator operator, Value *left_value, Value *right_value) {
+  if (operator != ADDITION_OP || !is_heap_value(left_value) || left_value->is_shared) return false;
+
+  switch (left_value->value_type) {
+    case ValueTypeStringValue: {
+      if (get_value_type(right_value) != ValueTypeStringValue) right_value = convert_to_string_value(right_value);
+
+      if (get_value_type(right_value) != ValueTypeStringValue) return false;
+
+      StringValue *right_string_value = (StringValue *) right_value;
+
+      append_to_string_value((StringValue *) left_value, get_string_chars(right_string_value), right_string_value->length);
+      return true;
+    }
+
+    case ValueTypeListValue: {
+      if (get_value_type(right_value) != ValueTypeListValue && get_value_type(right_value) != ValueTypeTupleValue) return false;
+
+      ListValue *list_value = (ListValue *) left_value;
+
+      size_t right_length;
+      Value **right_items = get_array_items(right_value, &right_length);
+
+      if (right_length == 0) return true;
+
+      grow_list_value(list_value, right_length);
+      memcpy(list_value->items + list_value->length, right_items, right_length * sizeof(Value *));
+      list_value->length += right_length;
+      return true;
+    }
+
+    case ValueTypeFloatValue: {
+      if (get_value_type(right_value) == ValueTypeFloatValue) ((FloatValue *) left_value)->float_value += ((FloatValue *) right_value)->float_value;
+      else if (get_value_type(right_value) == ValueTypeIntegerValue) ((FloatValue *) left_value)->float_value += get_integer_value(right_value);
+      else return false;
+
+      return true;
+    }
+
+    case ValueTypeIntegerValue: {
+      if (get_value_type(right_value) != ValueTypeIntegerValue) return false;
+
+      long long int result = get_integer_value(left_value) + get_integer_value(right_value);
+
+      if (result >= MIN_IMMEDIATE_INTEGER && result <= MAX_IMMEDIATE_INTEGER) return false;
+
+      ((IntegerValue *) left_value)->integer_value = result;
+      return true;
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+
+Value *apply_infix_operation(Operator operator, Value *left_value, Value *right_value) {
+  return operation_kernels[operator][get_value_type(left_value)][get_value_type(right_value)](left_value, right_value);
+}
@@ -0,0 +1,29 @@
+#ifndef PIELANG_OPERATION_H
+#define PIELANG_OPERATION_H
+
+#include "bool.h"
+#include "ast.h"
+#include "value.h"
+
+typedef Value *(*OperationKernel)(Value *left_value, Value *right_value);
+
+
+void register_operation(Operator operator, OperationKernel kernel);
+
+
+void register_operation_kernel(Operator operator, ValueType left_value_type, ValueType right_value_type, OperationKernel kernel);
+
+
+void build_operation_table();
+
+
+Value *apply_infix_operation(Operator operator, Value *left_value, Value *right_value);
+
+
+Value *apply_string_addition_operation(Value *left_value, Value *right_value);
+
+
+bool apply_in_place_operation(Operator operator, Value *left_value, Value *right_value);
+
+
+#endif //PIELANG_OPERATION_H
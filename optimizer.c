@@ -0,0 +1,443 @@
+#include "optimizer.h"
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "value.h"
+#include "gc.h"
+#include "evaluator.h"
+#include "operation.h"
+
+// runs between parsing and resolving, so pruned blocks never get slots
+
+
+bool _is_literal_expression(Expression *expression) {
+  switch (expression->expression_type) {
+    case ExpressionTypeNullExpression:
+    case ExpressionTypeBoolExpression:
+    case ExpressionTypeIntegerExpression:
+    case ExpressionTypeFloatExpression:
+    case ExpressionTypeStringExpression: {
+      return true;
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+
+Value *_get_literal_value(Expression *expression) {
+  switch (expression->expression_type) {
+    case ExpressionTypeBoolExpression: {
+      return new_bool_value(((BoolLiteral *) expression->literal)->bool_literal);
+    }
+
+    case ExpressionTypeIntegerExpression: {
+      return new_integer_value_from_literal((IntegerLiteral *) expression->literal);
+    }
+
+    case ExpressionTypeFloatExpression: {
+      return new_float_value_from_literal((FloatLiteral *) expression->literal);
+    }
+
+    case ExpressionTypeStringExpression: {
+      return new_string_value_from_literal((StringLiteral *) expression->literal);
+    }
+
+    default: {
+      return new_null_value();
+    }
+  }
+}
+
+
+// returns NULL for values that have no literal, like lists and generators
+Expression *_new_literal_expression(Arena *arena, Value *value) {
+  switch (get_value_type(value)) {
+    case ValueTypeNullValue: {
+      return eval_token(arena, (Token) {.token_type = NULL_TOKEN});
+    }
+
+    case ValueTypeBoolValue: {
+      BoolLiteral *bool_literal = arena_allocate(arena, sizeof(BoolLiteral));
+
+      bool_literal->literal = (Literal) {.literal_type = LiteralTypeBoolLiteral};
+      bool_literal->bool_literal = get_bool_value(value);
+
+      return eval_token(arena, (Token) {.token_type = BOOL_TOKEN, .literal = (Literal *) bool_literal});
+    }
+
+    case ValueTypeIntegerValue: {
+      IntegerLiteral *integer_literal = arena_allocate(arena, sizeof(IntegerLiteral));
+
+      integer_literal->literal = (Literal) {.literal_type = LiteralTypeIntegerLiteral};
+      integer_literal->integer_literal = get_integer_value(value);
+
+      return eval_token(arena, (Token) {.token_type = INTEGER_TOKEN, .literal = (Literal *) integer_literal});
+    }
+
+    case ValueTypeFloatValue: {
+      FloatLiteral *float_literal = arena_allocate(arena, sizeof(FloatLiteral));
+
+      float_literal->literal = (Literal) {.literal_type = LiteralTypeFloatLiteral};
+      float_literal->float_literal = ((FloatValue *) value)->float_value;
+
+      return eval_token(arena, (Token) {.token_type = FLOAT_TOKEN, .literal = (Literal *) float_literal});
+    }
+
+    case ValueTypeStringValue: {
+      StringLiteral *string_literal = arena_allocate(arena, sizeof(StringLiteral));
+
+      string_literal->literal = (Literal) {.literal_type = LiteralTypeStringLiteral};
+      string_literal->string_literal = arena_copy_buffer(arena, get_string_chars((StringValue *) value), ((StringValue *) value)->length);
+      string_literal->length = ((StringValue *) value)->length;
+
+      return eval_token(arena, (Token) {.token_type = STRING_LITERAL_TOKEN, .literal = (Literal *) string_literal});
+    }
+
+    default: {
+      return NULL;
+    }
+  }
+}
+
+
+bool _is_foldable_operator(Operator operator) {
+  switch (operator) {
+    case ADDITION_OP:
+    case SUBTRACTION_OP:
+    case MULTIPLICATION_OP:
+    case DIVISION_OP:
+    case INTEGER_DIVISION_OP:
+    case EXPONENT_OP:
+    case MOD_OP:
+    case CHECK_EQUALITY_OP:
+    case CHECK_NOT_EQUALITY_OP:
+    case CHECK_BIGGER_OP:
+    case CHECK_BIGGER_EQUAL_OP:
+    case CHECK_SMALLER_OP:
+    case CHECK_SMALLER_EQUAL_OP: {
+      return true;
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+
+bool _is_integer_literal(Expression *expression, long long int integer) {
+  return expression->expression_type == ExpressionTypeIntegerExpression && ((IntegerLiteral *) expression->literal)->integer_literal == integer;
+}
+
+
+// a division by zero is left for the evaluator, the branch it is in may never run
+bool _is_zero_literal(Expression *expression) {
+  if (expression->expression_type == ExpressionTypeFloatExpression) return ((FloatLiteral *) expression->literal)->float_literal == 0;
+
+  return _is_integer_literal(expression, 0);
+}
+
+
+// expressions that give a number or null, for which adding 0 or multiplying by 1 gives the same value back
+bool _is_numeric_expression(Expression *expression) {
+  switch (expression->expression_type) {
+    case ExpressionTypeIntegerExpression:
+    case ExpressionTypeFloatExpression: {
+      return true;
+    }
+
+    case ExpressionTypeInfixExpression: {
+      Operator operator = ((InfixExpression *) expression)->operator;
+
+      return operator == SUBTRACTION_OP || operator == MULTIPLICATION_OP || operator == EXPONENT_OP || operator == MOD_OP;
+    }
+
+    case ExpressionTypePrefixExpression: {
+      Operator operator = ((PrefixExpression *) expression)->operator;
+
+      return operator == ADDITION_OP || operator == SUBTRACTION_OP;
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+
+// replaces the expression with a literal of the value when there is one, the replaced nodes stay in the arena
+Expression *_replace_with_value(Arena *arena, Expression *expression, Value *value) {
+  Expression *literal_expression = _new_literal_expression(arena, value);
+
+  if (literal_expression == NULL) return expression;
+
+  return literal_expression;
+}
+
+
+// keeps one operand of an infix expression, the rest is dropped
+Expression *_replace_with_operand(InfixExpression *infix_expression, bool keep_left) {
+  return keep_left ? infix_expression->left_expression : infix_expression->right_expression;
+}
+
+
+Expression *_optimize_infix_expression(Arena *arena, InfixExpression *infix_expression) {
+  Operator operator = infix_expression->operator;
+
+  if (operator == MEMBER_OP) {
+    infix_expression->left_expression = optimize_expression(arena, infix_expression->left_expression);
+
+    return (Expression *) infix_expression;
+  }
+
+  // an assigned identifier stays as it is, the container and the index of an assigned index are optimized
+  if (infix_expression->left_expression->expression_type != ExpressionTypeIdentifierExpression) {
+    infix_expression->left_expression = optimize_expression(arena, infix_expression->left_expression);
+  }
+
+  infix_expression->right_expression = optimize_expression(arena, infix_expression->right_expression);
+
+  if (!_is_foldable_operator(operator)) return (Expression *) infix_expression;
+
+  Expression *left_expression = infix_expression->left_expression;
+  Expression *right_expression = infix_expression->right_expression;
+
+  if (_is_literal_expression(left_expression) && _is_literal_expression(right_expression)) {
+    if ((operator == DIVISION_OP || operator == INTEGER_DIVISION_OP || operator == MOD_OP) && _is_zero_literal(right_expression)) {
+      return (Expression *) infix_expression;
+    }
+
+    size_t root_count = gc_save_roots();
+
+    Value *left_value = _get_literal_value(left_expression);
+    Value *right_value = _get_literal_value(right_expression);
+
+    Expression *expression = _replace_with_value(arena, (Expression *) infix_expression, apply_infix_operation(operator, left_value, right_value));
+
+    gc_restore_roots(root_count);
+
+    return expression;
+  }
+
+  if (operator == ADDITION_OP) {
+    if (_is_integer_literal(right_expression, 0) && _is_numeric_expression(left_expression)) return _replace_with_operand(infix_expression, true);
+    if (_is_integer_literal(left_expression, 0) && _is_numeric_expression(right_expression)) return _replace_with_operand(infix_expression, false);
+  }
+  else if (operator == MULTIPLICATION_OP) {
+    if (_is_integer_literal(right_expression, 1) && _is_numeric_expression(left_expression)) return _replace_with_operand(infix_expression, true);
+    if (_is_integer_literal(left_expression, 1) && _is_numeric_expression(right_expression)) return _replace_with_operand(infix_expression, false);
+  }
+
+  return (Expression *) infix_expression;
+}
+
+
+Expression *_optimize_prefix_expression(Arena *arena, PrefixExpression *prefix_expression) {
+  prefix_expression->right_expression = optimize_expression(arena, prefix_expression->right_expression);
+
+  if (!_is_literal_expression(prefix_expression->right_expression)) return (Expression *) prefix_expression;
+
+  size_t root_count = gc_save_roots();
+
+  Value *right_value = _get_literal_value(prefix_expression->right_expression);
+
+  Expression *expression = _replace_with_value(arena, (Expression *) prefix_expression, apply_prefix_operation(prefix_expression->operator, right_value));
+
+  gc_restore_roots(root_count);
+
+  return expression;
+}
+
+
+// returns the expression that takes the place of the given one
+Expression *optimize_expression(Arena *arena, Expression *expression) {
+  if (expression == NULL) return NULL;
+
+  switch (expression->expression_type) {
+    case ExpressionTypeInfixExpression: {
+      return _optimize_infix_expression(arena, (InfixExpression *) expression);
+    }
+
+    case ExpressionTypePrefixExpression: {
+      return _optimize_prefix_expression(arena, (PrefixExpression *) expression);
+    }
+
+    case ExpressionTypeCallExpression: {
+      CallExpression *call_expression = (CallExpression *) expression;
+
+      call_expression->identifier_expression = optimize_expression(arena, call_expression->identifier_expression);
+      call_expression->tuple_expression = optimize_expression(arena, call_expression->tuple_expression);
+      break;
+    }
+
+    case ExpressionTypeArrayExpression: {
+      ArrayExpression *array_expression = (ArrayExpression *) expression;
+
+      for (size_t i = 0; i < array_expression->expression_count; i++) {
+        array_expression->expressions[i] = optimize_expression(arena, array_expression->expressions[i]);
+      }
+      break;
+    }
+
+    case ExpressionTypeIndexExpression: {
+      IndexExpression *index_expression = (IndexExpression *) expression;
+
+      index_expression->left_expression = optimize_expression(arena, index_expression->left_expression);
+      index_expression->right_expression = optimize_expression(arena, index_expression->right_expression);
+      break;
+    }
+
+    // a lazy body is optimized when it is parsed
+    case ExpressionTypeFunctionExpression: {
+      FunctionExpression *function_expression = (FunctionExpression *) expression;
+
+      if (function_expression->block != NULL) optimize_block(function_expression->block);
+      else function_expression->should_optimize = true;
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+
+  return expression;
+}
+
+
+// a branch with a constant condition is dropped when it is false, and becomes the else branch when it is true
+BlockDefinition *_optimize_if_else_group_block_definition(Arena *arena, IfElseGroupBlockDefinition *if_else_group_block_definition) {
+  size_t length = 0;
+
+  for (size_t i = 0; i < if_else_group_block_definition->if_block_definitions_length; i++) {
+    IfBlockDefinition *if_block_definition = if_else_group_block_definition->if_block_definitions[i];
+
+    optimize_block_definition(arena, (BlockDefinition *) if_block_definition);
+
+    if (if_block_definition->pre_expression != NULL || !_is_literal_expression(if_block_definition->condition)) {
+      if_else_group_block_definition->if_block_definitions[length++] = if_block_definition;
+      continue;
+    }
+
+    size_t root_count = gc_save_roots();
+    bool condition = convert_to_bool(_get_literal_value(if_block_definition->condition));
+
+    gc_restore_roots(root_count);
+
+    if (!condition) continue;
+
+    ElseBlockDefinition *else_block_definition = arena_allocate(arena, sizeof(ElseBlockDefinition));
+
+    else_block_definition->block_definition = (BlockDefinition) {.block_definition_type = BlockDefinitionTypeElseBlock};
+    else_block_definition->block = if_block_definition->block;
+
+    if_else_group_block_definition->else_block_definition = else_block_definition;
+    if_else_group_block_definition->if_block_definitions_length = length;
+
+    return (BlockDefinition *) if_else_group_block_definition;
+  }
+
+  if_else_group_block_definition->if_block_definitions_length = length;
+
+  if (if_else_group_block_definition->else_block_definition != NULL) {
+    optimize_block_definition(arena, (BlockDefinition *) if_else_group_block_definition->else_block_definition);
+  }
+  else if (length == 0) {
+    return NULL;
+  }
+
+  return (BlockDefinition *) if_else_group_block_definition;
+}
+
+
+// returns NULL when nothing of the block definition is left
+BlockDefinition *optimize_block_definition(Arena *arena, BlockDefinition *block_definition) {
+  switch (block_definition->block_definition_type) {
+    case BlockDefinitionTypeIfElseGroupBlock: {
+      return _optimize_if_else_group_block_definition(arena, (IfElseGroupBlockDefinition *) block_definition);
+    }
+
+    case BlockDefinitionTypeIfBlock: {
+      IfBlockDefinition *if_block_definition = (IfBlockDefinition *) block_definition;
+
+      if_block_definition->pre_expression = optimize_expression(arena, if_block_definition->pre_expression);
+      if_block_definition->condition = optimize_expression(arena, if_block_definition->condition);
+      optimize_block(if_block_definition->block);
+      break;
+    }
+
+    case BlockDefinitionTypeElseBlock: {
+      optimize_block(((ElseBlockDefinition *) block_definition)->block);
+      break;
+    }
+
+    case BlockDefinitionTypeForBlock: {
+      ForBlockDefinition *for_block_definition = (ForBlockDefinition *) block_definition;
+
+      for_block_definition->pre_expression = optimize_expression(arena, for_block_definition->pre_expression);
+      for_block_definition->condition = optimize_expression(arena, for_block_definition->condition);
+      for_block_definition->post_expression = optimize_expression(arena, for_block_definition->post_expression);
+      optimize_block(for_block_definition->block);
+      break;
+    }
+  }
+
+  return block_definition;
+}
+
+
+// returns NULL when the statement has been removed
+Statement *optimize_statement(Arena *arena, Statement *statement) {
+  switch (statement->statement_type) {
+    case StatementTypeExpressionStatement: {
+      ExpressionStatement *expression_statement = (ExpressionStatement *) statement;
+
+      expression_statement->expression = optimize_expression(arena, expression_statement->expression);
+      break;
+    }
+
+    case StatementTypeReturnStatement:
+    case StatementTypeImportStatement: {
+      ReturnStatement *return_statement = (ReturnStatement *) statement;
+
+      return_statement->right_expression = optimize_expression(arena, return_statement->right_expression);
+      break;
+    }
+
+    case StatementTypeBlockDefinitionStatement: {
+      BlockDefinitionStatement *block_definition_statement = (BlockDefinitionStatement *) statement;
+
+      if (block_definition_statement->block_definition == NULL) break;
+
+      block_definition_statement->block_definition = optimize_block_definition(arena, block_definition_statement->block_definition);
+
+      if (block_definition_statement->block_definition == NULL) return NULL;
+      break;
+    }
+  }
+
+  return statement;
+}
+
+
+void optimize_block(Block *block) {
+  size_t statement_count = 0;
+
+  for (size_t i = 0; i < block->statement_count; i++) {
+    Statement *statement = optimize_statement(block->arena, block->statements[i]);
+
+    if (statement != NULL) block->statements[statement_count++] = statement;
+  }
+
+  block->statement_count = statement_count;
+}
+
+
+void optimize_ast(AST *ast) {
+  optimize_block(ast->block);
+}
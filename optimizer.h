@@ -0,0 +1,25 @@
+#ifndef PIELANG_OPTIMIZER_H
+#define PIELANG_OPTIMIZER_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+
+
+Expression *optimize_expression(Arena *arena, Expression *expression);
+
+
+BlockDefinition *optimize_block_definition(Arena *arena, BlockDefinition *block_definition);
+
+
+void optimize_block(Block *block);
+
+
+Statement *optimize_statement(Arena *arena, Statement *statement);
+
+
+void optimize_ast(AST *ast);
+
+
+#endif //PIELANG_OPTIMIZER_H
@@ -0,0 +1,92 @@
+#include "pool.h"
+
+#include <stdio.h>
+
+#include "memory.h"
+
+static Pool pool;
+
+
+size_t _get_class_index(size_t size) {
+  return (size + POOL_CLASS_GRANULARITY - 1) / POOL_CLASS_GRANULARITY - 1;
+}
+
+
+// a new slab is cut into blocks that all go to the free list, in address order
+void _add_slab(PoolClass *pool_class) {
+  size_t block_count = (POOL_SLAB_SIZE - sizeof(PoolSlab)) / pool_class->block_size;
+  PoolSlab *slab = memory_allocate(MemorySubsystemValue, POOL_SLAB_SIZE);
+  char *data = (char *) slab->data;
+
+  slab->next_slab = pool_class->slab;
+  pool_class->slab = slab;
+  pool_class->slab_count++;
+
+  for (size_t i = block_count; i > 0; i--) {
+    PoolBlock *block = (PoolBlock *) (data + (i - 1) * pool_class->block_size);
+
+    block->next_block = pool_class->free_block;
+    pool_class->free_block = block;
+  }
+}
+
+
+// anything larger than the biggest class is left to malloc
+void *pool_allocate(size_t size) {
+  if (size > POOL_MAX_BLOCK_SIZE) {
+    pool.large_live_count++;
+    pool.large_allocation_count++;
+
+    return memory_allocate(MemorySubsystemValue, size);
+  }
+
+  PoolClass *pool_class = &pool.classes[_get_class_index(size)];
+
+  if (pool_class->free_block == NULL) {
+    pool_class->block_size = (_get_class_index(size) + 1) * POOL_CLASS_GRANULARITY;
+    _add_slab(pool_class);
+  }
+
+  PoolBlock *block = pool_class->free_block;
+
+  pool_class->free_block = block->next_block;
+  pool_class->allocation_count++;
+
+  if (++pool_class->live_count > pool_class->peak_count) pool_class->peak_count = pool_class->live_count;
+
+  return block;
+}
+
+
+// the size has to be the one the block was allocated with
+void pool_free(void *block, size_t size) {
+  if (size > POOL_MAX_BLOCK_SIZE) {
+    pool.large_live_count--;
+
+    memory_free(block);
+    return;
+  }
+
+  PoolClass *pool_class = &pool.classes[_get_class_index(size)];
+  PoolBlock *pool_block = block;
+
+  pool_block->next_block = pool_class->free_block;
+  pool_class->free_block = pool_block;
+  pool_class->live_count--;
+}
+
+
+void printf_pool_stats() {
+  printf("%-6s %10s %10s %12s %6s\n", "class", "live", "peak", "allocations", "slabs");
+
+  for (size_t i = 0; i < POOL_CLASS_COUNT; i++) {
+    PoolClass *pool_class = &pool.classes[i];
+
+    if (pool_class->allocation_count == 0) continue;
+
+    printf("%-6zu %10zu %10zu %12zu %6zu\n", (i + 1) * POOL_CLASS_GRANULARITY, pool_class->live_count, pool_class->peak_count, pool_class->allocation_count, pool_class->slab_count);
+  }
+
+  printf("%-6s %10zu %10s %12zu %6s\n", "large", pool.large_live_count, "-", pool.large_allocation_count, "-");
+}
+
@@ -0,0 +1,50 @@
+#ifndef PIELANG_POOL_H
+#define PIELANG_POOL_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+
+// blocks are rounded up to a multiple of 16 bytes, so every class keeps the alignment of a long double
+#define POOL_CLASS_GRANULARITY 16
+#define POOL_CLASS_COUNT 8
+#define POOL_MAX_BLOCK_SIZE (POOL_CLASS_GRANULARITY * POOL_CLASS_COUNT)
+#define POOL_SLAB_SIZE (64 * 1024)
+
+typedef struct PoolBlock {
+  struct PoolBlock *next_block;
+} PoolBlock;
+
+typedef struct PoolSlab {
+  struct PoolSlab *next_slab;
+  long double data[];
+} PoolSlab;
+
+// a freed block goes to the front of the free list of its class and is the next one handed out
+typedef struct {
+  size_t block_size;
+  PoolBlock *free_block;
+  PoolSlab *slab;
+  size_t slab_count;
+  size_t live_count;
+  size_t peak_count;
+  size_t allocation_count;
+} PoolClass;
+
+typedef struct {
+  PoolClass classes[POOL_CLASS_COUNT];
+  size_t large_live_count;
+  size_t large_allocation_count;
+} Pool;
+
+
+void *pool_allocate(size_t size);
+
+
+void pool_free(void *block, size_t size);
+
+
+void printf_pool_stats();
+
+
+#endif //PIELANG_POOL_H
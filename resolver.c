@@ -0,0 +1,356 @@
+#include "resolver.h"
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "lexer.h"
+#include "system.h"
+#include "memory.h"
+
+
+void resolver_enter_scope(Resolver *resolver, Block *block, bool is_function_scope) {
+  ResolverScope *resolver_scope = memory_allocate(MemorySubsystemAST, sizeof(ResolverScope));
+
+  resolver_scope->block = block;
+  resolver_scope->is_function_scope = is_function_scope;
+  resolver_scope->inherited_scope = resolver->scope;
+
+  resolver->scope = resolver_scope;
+}
+
+
+void resolver_leave_scope(Resolver *resolver) {
+  ResolverScope *resolver_scope = resolver->scope;
+
+  resolver->scope = resolver_scope->inherited_scope;
+
+  memory_free(resolver_scope);
+}
+
+
+Resolver *new_resolver(Block *global_block) {
+  Resolver *resolver = memory_allocate(MemorySubsystemAST, sizeof(Resolver));
+
+  resolver->global_block = global_block;
+  resolver->global_slot_count = UNRESOLVED_SLOT;
+  resolver->scope = NULL;
+
+  declare_system_functions(global_block);
+  resolver_enter_scope(resolver, global_block, false);
+
+  return resolver;
+}
+
+
+void free_resolver(Resolver *resolver) {
+  while (resolver->scope != NULL) {
+    resolver_leave_scope(resolver);
+  }
+
+  memory_free(resolver);
+}
+
+
+size_t get_visible_global_slot_count(Resolver *resolver) {
+  size_t slot_count = resolver->global_block->slot_count;
+
+  return resolver->global_slot_count < slot_count ? resolver->global_slot_count : slot_count;
+}
+
+
+// a function sees the blocks it is written in up to its own body, and the names declared in the main block before it
+bool resolver_find_slot(Resolver *resolver, char *name, size_t *depth, size_t *slot) {
+  size_t scope_depth = 0;
+
+  for (ResolverScope *resolver_scope = resolver->scope; resolver_scope != NULL; resolver_scope = resolver_scope->inherited_scope) {
+    *slot = block_get_slot(resolver_scope->block, name);
+
+    if (*slot != UNRESOLVED_SLOT) {
+      *depth = scope_depth;
+      return true;
+    }
+
+    if (resolver_scope->is_function_scope) {
+      *slot = block_get_slot_before(resolver->global_block, name, get_visible_global_slot_count(resolver));
+      *depth = GLOBAL_DEPTH;
+
+      return *slot != UNRESOLVED_SLOT;
+    }
+
+    scope_depth++;
+  }
+
+  return false;
+}
+
+
+char *_get_identifier_name(Expression *expression) {
+  return ((StringLiteral *) expression->literal)->string_literal;
+}
+
+
+void resolve_identifier(Resolver *resolver, Expression *expression) {
+  IdentifierExpression *identifier_expression = (IdentifierExpression *) expression;
+
+  if (!resolver_find_slot(resolver, _get_identifier_name(expression), &identifier_expression->depth, &identifier_expression->slot)) {
+    identifier_expression->depth = 0;
+    identifier_expression->slot = UNRESOLVED_SLOT;
+  }
+}
+
+
+// an assignment to a name that is not visible yet declares it in the current block
+void resolve_assigned_identifier(Resolver *resolver, Expression *expression) {
+  IdentifierExpression *identifier_expression = (IdentifierExpression *) expression;
+
+  if (!resolver_find_slot(resolver, _get_identifier_name(expression), &identifier_expression->depth, &identifier_expression->slot)) {
+    identifier_expression->depth = 0;
+    identifier_expression->slot = block_add_slot(resolver->scope->block, _get_identifier_name(expression));
+  }
+}
+
+
+void resolve_block(Resolver *resolver, Block *block) {
+  for (size_t i = 0; i < block->statement_count; i++) {
+    resolve_statement(resolver, block->statements[i]);
+  }
+}
+
+
+void resolve_infix_expression(Resolver *resolver, InfixExpression *infix_expression) {
+  switch (infix_expression->operator) {
+    case ASSIGN_OP:
+    case ASSIGN_ADDITION_OP:
+    case ASSIGN_SUBTRACTION_OP:
+    case ASSIGN_MULTIPLICATION_OP:
+    case ASSIGN_DIVISION_OP:
+    case ASSIGN_INTEGER_DIVISION_OP:
+    case ASSIGN_EXPONENT_OP:
+    case ASSIGN_MOD_OP: {
+      resolve_expression(resolver, infix_expression->right_expression);
+
+      if (infix_expression->left_expression->expression_type == ExpressionTypeIdentifierExpression) {
+        resolve_assigned_identifier(resolver, infix_expression->left_expression);
+      }
+      else {
+        resolve_expression(resolver, infix_expression->left_expression);
+      }
+      break;
+    }
+
+    case MEMBER_OP: {
+      resolve_expression(resolver, infix_expression->left_expression);
+      break;
+    }
+
+    default: {
+      resolve_expression(resolver, infix_expression->left_expression);
+      resolve_expression(resolver, infix_expression->right_expression);
+      break;
+    }
+  }
+}
+
+
+void _resolve_function_block(Resolver *resolver, FunctionExpression *function_expression) {
+  resolver_enter_scope(resolver, function_expression->block, true);
+
+  // arguments always take the first slots, in order
+  for (size_t i = 0; i < function_expression->argument_count; i++) {
+    block_add_slot(function_expression->block, function_expression->arguments[i]);
+  }
+
+  resolve_block(resolver, function_expression->block);
+
+  resolver_leave_scope(resolver);
+}
+
+
+// a lazy body is resolved when it is parsed, against the main block as it is now
+void resolve_function_expression(Resolver *resolver, FunctionExpression *function_expression) {
+  if (function_expression->identifier != NULL) {
+    resolve_assigned_identifier(resolver, function_expression->identifier);
+  }
+
+  function_expression->global_slot_count = get_visible_global_slot_count(resolver);
+
+  if (function_expression->block != NULL) _resolve_function_block(resolver, function_expression);
+}
+
+
+// a function body only sees its own block and the main block up to the function, so it resolves the same on its first call
+void resolve_function_body(Block *global_block, FunctionExpression *function_expression) {
+  Resolver resolver = {.global_block = global_block, .global_slot_count = function_expression->global_slot_count, .scope = NULL};
+
+  _resolve_function_block(&resolver, function_expression);
+}
+
+
+void resolve_expression(Resolver *resolver, Expression *expression) {
+  if (expression == NULL) return;
+
+  switch (expression->expression_type) {
+    case ExpressionTypeIdentifierExpression: {
+      resolve_identifier(resolver, expression);
+      break;
+    }
+
+    case ExpressionTypeInfixExpression: {
+      resolve_infix_expression(resolver, (InfixExpression *) expression);
+      break;
+    }
+
+    case ExpressionTypePrefixExpression: {
+      resolve_expression(resolver, ((PrefixExpression *) expression)->right_expression);
+      break;
+    }
+
+    case ExpressionTypeIndexExpression: {
+      IndexExpression *index_expression = (IndexExpression *) expression;
+
+      resolve_expression(resolver, index_expression->left_expression);
+      resolve_expression(resolver, index_expression->right_expression);
+      break;
+    }
+
+    case ExpressionTypeArrayExpression: {
+      ArrayExpression *array_expression = (ArrayExpression *) expression;
+
+      for (size_t i = 0; i < array_expression->expression_count; i++) {
+        resolve_expression(resolver, array_expression->expressions[i]);
+      }
+      break;
+    }
+
+    case ExpressionTypeCallExpression: {
+      CallExpression *call_expression = (CallExpression *) expression;
+
+      resolve_expression(resolver, call_expression->identifier_expression);
+      resolve_expression(resolver, call_expression->tuple_expression);
+      break;
+    }
+
+    case ExpressionTypeFunctionExpression: {
+      resolve_function_expression(resolver, (FunctionExpression *) expression);
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void resolve_block_definition(Resolver *resolver, BlockDefinition *block_definition) {
+  switch (block_definition->block_definition_type) {
+    case BlockDefinitionTypeIfElseGroupBlock: {
+      IfElseGroupBlockDefinition *if_else_group_block_definition = (IfElseGroupBlockDefinition *) block_definition;
+
+      for (size_t i = 0; i < if_else_group_block_definition->if_block_definitions_length; i++) {
+        resolve_block_definition(resolver, (BlockDefinition *) if_else_group_block_definition->if_block_definitions[i]);
+      }
+
+      if (if_else_group_block_definition->else_block_definition != NULL) {
+        resolve_block_definition(resolver, (BlockDefinition *) if_else_group_block_definition->else_block_definition);
+      }
+      break;
+    }
+
+    case BlockDefinitionTypeIfBlock: {
+      IfBlockDefinition *if_block_definition = (IfBlockDefinition *) block_definition;
+
+      resolver_enter_scope(resolver, if_block_definition->block, false);
+
+      resolve_expression(resolver, if_block_definition->pre_expression);
+      resolve_expression(resolver, if_block_definition->condition);
+      resolve_block(resolver, if_block_definition->block);
+
+      resolver_leave_scope(resolver);
+      break;
+    }
+
+    case BlockDefinitionTypeElseBlock: {
+      ElseBlockDefinition *else_block_definition = (ElseBlockDefinition *) block_definition;
+
+      resolver_enter_scope(resolver, else_block_definition->block, false);
+
+      resolve_block(resolver, else_block_definition->block);
+
+      resolver_leave_scope(resolver);
+      break;
+    }
+
+    case BlockDefinitionTypeForBlock: {
+      ForBlockDefinition *for_block_definition = (ForBlockDefinition *) block_definition;
+      Expression *condition = for_block_definition->condition;
+
+      resolver_enter_scope(resolver, for_block_definition->block, false);
+
+      resolve_expression(resolver, for_block_definition->pre_expression);
+
+      if (condition != NULL && condition->expression_type == ExpressionTypeInfixExpression && ((InfixExpression *) condition)->operator == IN_OP) {
+        InfixExpression *in_infix_expression = (InfixExpression *) condition;
+
+        resolve_expression(resolver, in_infix_expression->right_expression);
+
+        if (in_infix_expression->left_expression->expression_type == ExpressionTypeIdentifierExpression) {
+          resolve_assigned_identifier(resolver, in_infix_expression->left_expression);
+        }
+      }
+      else {
+        resolve_expression(resolver, condition);
+      }
+
+      // in the order they run, the post expression comes after the body
+      resolve_block(resolver, for_block_definition->block);
+      resolve_expression(resolver, for_block_definition->post_expression);
+
+      resolver_leave_scope(resolver);
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void resolve_statement(Resolver *resolver, Statement *statement) {
+  switch (statement->statement_type) {
+    case StatementTypeExpressionStatement: {
+      resolve_expression(resolver, ((ExpressionStatement *) statement)->expression);
+      break;
+    }
+
+    case StatementTypeReturnStatement: {
+      resolve_expression(resolver, ((ReturnStatement *) statement)->right_expression);
+      break;
+    }
+
+    case StatementTypeImportStatement: {
+      resolve_expression(resolver, ((ImportStatement *) statement)->right_expression);
+      break;
+    }
+
+    case StatementTypeBlockDefinitionStatement: {
+      resolve_block_definition(resolver, ((BlockDefinitionStatement *) statement)->block_definition);
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+
+void resolve_ast(AST *ast) {
+  Resolver *resolver = new_resolver(ast->block);
+
+  resolve_block(resolver, ast->block);
+
+  free_resolver(resolver);
+}
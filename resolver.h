@@ -0,0 +1,44 @@
+#ifndef PIELANG_RESOLVER_H
+#define PIELANG_RESOLVER_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+
+typedef struct ResolverScope {
+  Block *block;
+  bool is_function_scope;
+  struct ResolverScope *inherited_scope;
+} ResolverScope;
+
+// global_slot_count bounds the slots of the main block that can be found, a lazy body is resolved after the whole script
+typedef struct {
+  Block *global_block;
+  size_t global_slot_count;
+  ResolverScope *scope;
+} Resolver;
+
+
+Resolver *new_resolver(Block *global_block);
+
+
+void free_resolver(Resolver *resolver);
+
+
+void resolve_expression(Resolver *resolver, Expression *expression);
+
+
+void resolve_block_definition(Resolver *resolver, BlockDefinition *block_definition);
+
+
+void resolve_statement(Resolver *resolver, Statement *statement);
+
+
+void resolve_function_body(Block *global_block, FunctionExpression *function_expression);
+
+
+void resolve_ast(AST *ast);
+
+
+#endif //PIELANG_RESOLVER_H
@@ -0,0 +1,195 @@
+#include "scanner.h"
+
+#include <stdint.h>
+
+// the chars are classified a whole vector at a time, the rest that does not fill a vector is done one by one
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define SCAN_VECTOR_SIZE 32
+#define SCAN_FULL_MASK 0xffffffffu
+#define SCANNER_NAME "avx2"
+
+typedef __m256i ScanVector;
+
+#define scan_load(s) _mm256_loadu_si256((const __m256i *) (s))
+#define scan_set(c) _mm256_set1_epi8((char) (c))
+#define scan_equal(a, b) _mm256_cmpeq_epi8(a, b)
+#define scan_or(a, b) _mm256_or_si256(a, b)
+#define scan_sub(a, b) _mm256_sub_epi8(a, b)
+#define scan_saturating_sub(a, b) _mm256_subs_epu8(a, b)
+#define scan_mask(a) ((uint32_t) _mm256_movemask_epi8(a))
+#define scan_zero() _mm256_setzero_si256()
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define SCAN_VECTOR_SIZE 16
+#define SCAN_FULL_MASK 0xffffu
+#define SCANNER_NAME "sse2"
+
+typedef __m128i ScanVector;
+
+#define scan_load(s) _mm_loadu_si128((const __m128i *) (s))
+#define scan_set(c) _mm_set1_epi8((char) (c))
+#define scan_equal(a, b) _mm_cmpeq_epi8(a, b)
+#define scan_or(a, b) _mm_or_si128(a, b)
+#define scan_sub(a, b) _mm_sub_epi8(a, b)
+#define scan_saturating_sub(a, b) _mm_subs_epu8(a, b)
+#define scan_mask(a) ((uint32_t) _mm_movemask_epi8(a))
+#define scan_zero() _mm_setzero_si128()
+
+#else
+
+#define SCANNER_NAME "scalar"
+
+#endif
+
+
+#ifdef SCAN_VECTOR_SIZE
+
+// lanes with first <= c <= last, c - first wraps around for the chars below first
+static inline ScanVector _scan_range(ScanVector chars, char first, char last) {
+  return scan_equal(scan_saturating_sub(scan_sub(chars, scan_set(first)), scan_set(last - first)), scan_zero());
+}
+
+
+static inline ScanVector _scan_whitespace(ScanVector chars) {
+  return scan_or(
+    scan_or(scan_equal(chars, scan_set(' ')), scan_equal(chars, scan_set('\t'))),
+    scan_or(scan_equal(chars, scan_set('\n')), scan_equal(chars, scan_set('\r'))));
+}
+
+
+// the letters are folded to lower case by setting the 0x20 bit
+static inline ScanVector _scan_identifier(ScanVector chars) {
+  return scan_or(
+    scan_or(_scan_range(scan_or(chars, scan_set(0x20)), 'a', 'z'), _scan_range(chars, '0', '9')),
+    scan_equal(chars, scan_set('_')));
+}
+
+
+static inline ScanVector _scan_digits(ScanVector chars) {
+  return scan_or(_scan_range(chars, '0', '9'), scan_equal(chars, scan_set('_')));
+}
+
+
+// the lanes that end the scan, the position of the first one is the length of the class
+static inline size_t _first_lane(uint32_t end_mask) {
+  return (size_t) __builtin_ctz(end_mask);
+}
+
+#endif
+
+
+static inline bool _is_whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+static inline bool _is_identifier_char(char c) {
+  return ('a' <= (c | 0x20) && (c | 0x20) <= 'z') || ('0' <= c && c <= '9') || c == '_';
+}
+
+
+static inline bool _is_digit_char(char c) {
+  return ('0' <= c && c <= '9') || c == '_';
+}
+
+
+size_t scan_whitespace(const char *s, size_t length) {
+  size_t i = 0;
+
+#ifdef SCAN_VECTOR_SIZE
+  for (; i + SCAN_VECTOR_SIZE <= length; i += SCAN_VECTOR_SIZE) {
+    uint32_t end_mask = ~scan_mask(_scan_whitespace(scan_load(s + i))) & SCAN_FULL_MASK;
+
+    if (end_mask != 0) return i + _first_lane(end_mask);
+  }
+#endif
+
+  while (i < length && _is_whitespace(s[i])) i++;
+
+  return i;
+}
+
+
+size_t scan_line(const char *s, size_t length) {
+  size_t i = 0;
+
+#ifdef SCAN_VECTOR_SIZE
+  for (; i + SCAN_VECTOR_SIZE <= length; i += SCAN_VECTOR_SIZE) {
+    ScanVector chars = scan_load(s + i);
+    uint32_t end_mask = scan_mask(scan_or(scan_equal(chars, scan_set('\n')), scan_equal(chars, scan_zero())));
+
+    if (end_mask != 0) return i + _first_lane(end_mask);
+  }
+#endif
+
+  while (i < length && s[i] != '\n' && s[i] != 0) i++;
+
+  return i;
+}
+
+
+size_t scan_identifier(const char *s, size_t length) {
+  size_t i = 0;
+
+#ifdef SCAN_VECTOR_SIZE
+  for (; i + SCAN_VECTOR_SIZE <= length; i += SCAN_VECTOR_SIZE) {
+    uint32_t end_mask = ~scan_mask(_scan_identifier(scan_load(s + i))) & SCAN_FULL_MASK;
+
+    if (end_mask != 0) return i + _first_lane(end_mask);
+  }
+#endif
+
+  while (i < length && _is_identifier_char(s[i])) i++;
+
+  return i;
+}
+
+
+size_t scan_digits(const char *s, size_t length) {
+  size_t i = 0;
+
+#ifdef SCAN_VECTOR_SIZE
+  for (; i + SCAN_VECTOR_SIZE <= length; i += SCAN_VECTOR_SIZE) {
+    uint32_t end_mask = ~scan_mask(_scan_digits(scan_load(s + i))) & SCAN_FULL_MASK;
+
+    if (end_mask != 0) return i + _first_lane(end_mask);
+  }
+#endif
+
+  while (i < length && _is_digit_char(s[i])) i++;
+
+  return i;
+}
+
+
+// stops at the quote, at a backslash that escapes the next char and at the end of the content
+size_t scan_string(const char *s, size_t length, char quote) {
+  size_t i = 0;
+
+#ifdef SCAN_VECTOR_SIZE
+  for (; i + SCAN_VECTOR_SIZE <= length; i += SCAN_VECTOR_SIZE) {
+    ScanVector chars = scan_load(s + i);
+    uint32_t end_mask = scan_mask(scan_or(
+      scan_or(scan_equal(chars, scan_set(quote)), scan_equal(chars, scan_set('\\'))),
+      scan_equal(chars, scan_zero())));
+
+    if (end_mask != 0) return i + _first_lane(end_mask);
+  }
+#endif
+
+  while (i < length && s[i] != quote && s[i] != '\\' && s[i] != 0) i++;
+
+  return i;
+}
+
+
+const char *get_scanner_name() {
+  return SCANNER_NAME;
+}
@@ -0,0 +1,29 @@
+#ifndef PIELANG_SCANNER_H
+#define PIELANG_SCANNER_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+
+// each scan returns how many of the first length chars belong to its class, it never reads past length
+
+
+size_t scan_whitespace(const char *s, size_t length);
+
+
+size_t scan_line(const char *s, size_t length);
+
+
+size_t scan_identifier(const char *s, size_t length);
+
+
+size_t scan_digits(const char *s, size_t length);
+
+
+size_t scan_string(const char *s, size_t length, char quote);
+
+
+const char *get_scanner_name();
+
+
+#endif //PIELANG_SCANNER_H
@@ -1,26 +1,72 @@
 #include "scope.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "hashtable.h"
-#include "utils.h"
 #include "value.h"
+#include "gc.h"
+#include "memory.h"
 
-#define SCOPE_VARIABLE_HASHTABLE_SIZE 20
+// the expected number of variables, most of them live in slots and the map grows when needed
+#define SCOPE_VARIABLE_HASHTABLE_SIZE 4
+
+// freed scopes are kept to be reused with their slot storage, linked through inherited_scope
+static Scope *scope_pool = NULL;
 
 
 Scope *new_scope(Scope *inherited_scope, Block *block, ScopeType scope_type) {
-  Scope *scope = malloc(sizeof(Scope));
+  Scope *scope = scope_pool;
+
+  if (scope != NULL) {
+    scope_pool = scope->inherited_scope;
+  }
+  else {
+    scope = memory_allocate(MemorySubsystemScope, sizeof(Scope));
+
+    // the variable maps are only created when a variable is declared outside of the slots
+    for (size_t i = 0; i < VALUE_TYPE_COUNT; i++) {
+      scope->variable_maps[i] = NULL;
+    }
+
+    scope->slots = NULL;
+    scope->slot_capacity = 0;
+  }
 
   scope->inherited_scope = inherited_scope;
+  scope->global_scope = inherited_scope == NULL ? scope : inherited_scope->global_scope;
   scope->block = block;
-  scope->variable_maps = calloc(VALUE_TYPE_COUNT, sizeof(HashTable *));
-  scope->variable_maps[0] = new_hash_table(SCOPE_VARIABLE_HASHTABLE_SIZE, HashTableTypeVariableMap);
+  scope->slot_count = 0;
   scope->scope_type = scope_type;
   scope->return_value = new_null_value();
+  scope->has_returned = false;
+
+  scope_update_slots(scope);
+
+  gc_register_scope(scope);
 
   return scope;
 }
 
+
+// the repl keeps declaring new names in the block of the main scope, so slots can be added after creation
+void scope_update_slots(Scope *scope) {
+  if (scope->block == NULL || scope->block->slot_count == scope->slot_count) return;
+
+  if (scope->block->slot_count > scope->slot_capacity) {
+    scope->slot_capacity = scope->block->slot_count;
+    scope->slots = memory_reallocate(MemorySubsystemScope, scope->slots, scope->slot_capacity * sizeof(Variable));
+  }
+
+  for (size_t i = scope->slot_count; i < scope->block->slot_count; i++) {
+    scope->slots[i].variable_name = scope->block->slot_names[i];
+    scope->slots[i].value = NULL;
+    scope->slots[i].is_readonly = false;
+  }
+
+  scope->slot_count = scope->block->slot_count;
+}
+
 HashTable *_get_or_create_variable_map(Scope *scope, ValueType context_value_type) {
   if (scope->variable_maps[context_value_type] == NULL) {
     scope->variable_maps[context_value_type] = new_hash_table(SCOPE_VARIABLE_HASHTABLE_SIZE, HashTableTypeVariableMap);
@@ -30,17 +76,24 @@ HashTable *_get_or_create_variable_map(Scope *scope, ValueType context_value_typ
 }
 
 void free_scope(Scope *scope) {
+  gc_unregister_scope(scope);
+
   for (size_t i = 0; i < VALUE_TYPE_COUNT; i++) {
     if (scope->variable_maps[i] != NULL) {
       free_hash_table(scope->variable_maps[i]);
+      scope->variable_maps[i] = NULL;
     }
   }
-  // free(scope->variable_maps);
-  free(scope);
+
+  scope->inherited_scope = scope_pool;
+  scope_pool = scope;
 }
 
 
+// marks every scope up to the function scope, so that the blocks in between stop evaluating
 void scope_set_return_value(Scope *scope, Value *value) {
+  scope->has_returned = true;
+
   if (scope->scope_type == ScopeTypeFunctionScope) {
     scope->return_value = value;
   }
@@ -53,9 +106,37 @@ void scope_set_return_value(Scope *scope, Value *value) {
 }
 
 
+// the block index gives the last slot of the name, the earlier ones are only searched when the block declares a name twice
+Variable *_get_slot_variable(Scope *scope, char *name) {
+  if (scope->block == NULL) return NULL;
+
+  size_t slot = block_get_slot_before(scope->block, name, scope->slot_count);
+
+  if (slot == UNRESOLVED_SLOT) return NULL;
+
+  if (scope->slots[slot].value != NULL) return &scope->slots[slot];
+
+  if (!scope->block->has_duplicate_slots) return NULL;
+
+  for (size_t i = slot; i > 0; i--) {
+    if (scope->slots[i - 1].value != NULL && scope->slots[i - 1].variable_name == name) {
+      return &scope->slots[i - 1];
+    }
+  }
+
+  return NULL;
+}
+
+
 Variable *scope_get_variable(Scope *scope, ValueType context_value_type, char *name) {
   Variable *variable = NULL;
 
+  if (context_value_type == ValueTypeNullValue) {
+    variable = _get_slot_variable(scope, name);
+
+    if (variable != NULL) return variable;
+  }
+
   if (scope->variable_maps[context_value_type] != NULL) {
     variable = variable_map_get(scope->variable_maps[context_value_type], name);
   }
@@ -72,11 +153,36 @@ Variable *scope_get_variable(Scope *scope, ValueType context_value_type, char *n
 }
 
 
+// the system functions are readonly, replacing one stops the script like a parser error does
+void _assign_variable(Variable *variable, Value *value) {
+  if (variable->is_readonly) {
+    printf("Can not assign to %s, it is readonly\n", variable->variable_name);
+    exit(EXIT_FAILURE);
+  }
+
+  variable->value = value;
+}
+
+
 Variable *scope_set_variable(Scope *scope, ValueType context_value_type, char *name, Value *value, int create_new_if_even_exists) {
   Variable *variable = scope_get_variable(scope, context_value_type, name);
 
   if (variable == NULL || create_new_if_even_exists) {
-    variable = new_variable(copy_string(name), value);
+    size_t slot = UNRESOLVED_SLOT;
+
+    if (context_value_type == ValueTypeNullValue && scope->block != NULL) {
+      slot = block_get_slot(scope->block, name);
+    }
+
+    if (slot != UNRESOLVED_SLOT && slot < scope->slot_count) {
+      variable = &scope->slots[slot];
+
+      variable->value = value;
+
+      return variable;
+    }
+
+    variable = new_variable(name, value);
 
     HashTable *variable_map = _get_or_create_variable_map(scope, context_value_type);
 
@@ -85,18 +191,50 @@ Variable *scope_set_variable(Scope *scope, ValueType context_value_type, char *n
     return variable;
   }
   else {
-    if (!variable->is_readonly)  {
-      Value *old_value = variable->value;
-      old_value->linked_variable_count--;
-      free_value(old_value);
-
-      variable->value = value;
-      variable->value->linked_variable_count++;
-    }
-    else {
-      // TODO error
-    }
+    _assign_variable(variable, value);
   }
 
   return NULL;
 }
+
+
+Scope *_get_slot_scope(Scope *scope, size_t depth) {
+  if (depth == GLOBAL_DEPTH) return scope->global_scope;
+
+  for (size_t i = 0; i < depth; i++) {
+    scope = scope->inherited_scope;
+  }
+
+  return scope;
+}
+
+
+Variable *scope_get_slot(Scope *scope, size_t depth, size_t slot) {
+  Variable *variable = &_get_slot_scope(scope, depth)->slots[slot];
+
+  if (variable->value != NULL) return variable;
+
+  // not assigned in that scope yet, the name may still be reachable from here
+  return scope_get_variable(scope, ValueTypeNullValue, variable->variable_name);
+}
+
+
+// like a read, an assignment to a slot that is not assigned yet goes to the binding of the name that is reachable from here,
+// so a function still assigns the variables of its callers as it did when every name was looked up
+void scope_set_slot(Scope *scope, size_t depth, size_t slot, Value *value) {
+  Variable *variable = &_get_slot_scope(scope, depth)->slots[slot];
+
+  if (variable->value == NULL) {
+    Variable *reachable_variable = scope_get_variable(scope, ValueTypeNullValue, variable->variable_name);
+
+    if (reachable_variable != NULL) variable = reachable_variable;
+  }
+
+  _assign_variable(variable, value);
+}
+
+
+// the arguments of a function are always its own, whatever the callers have with the same names
+void scope_declare_slot(Scope *scope, size_t slot, Value *value) {
+  scope->slots[slot].value = value;
+}
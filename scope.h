@@ -18,10 +18,15 @@ typedef enum {
 
 typedef struct Scope {
   struct Scope *inherited_scope;
-  HashTable **variable_maps;
+  struct Scope *global_scope;
+  HashTable *variable_maps[VALUE_TYPE_COUNT];
+  struct Variable *slots;
+  size_t slot_count;
+  size_t slot_capacity;
   Block *block;
   ScopeType scope_type;
   struct Value *return_value;
+  bool has_returned;
 } Scope;
 
 
@@ -31,13 +36,26 @@ Scope *new_scope(Scope *inherited_scope, Block *block, ScopeType scope_type);
 void free_scope(Scope *scope);
 
 
+void scope_update_slots(Scope *scope);
+
+
 void scope_set_return_value(Scope *scope, struct Value *value);
 
 
+// the names are symbols from intern_symbol
 struct Variable *scope_get_variable(Scope *scope, ValueType context_value_type, char *name);
 
 
 struct Variable *scope_set_variable(Scope *scope, ValueType context_value_type, char *name, struct Value *value, int create_new_if_even_exists) ;
 
 
+struct Variable *scope_get_slot(Scope *scope, size_t depth, size_t slot);
+
+
+void scope_set_slot(Scope *scope, size_t depth, size_t slot, struct Value *value);
+
+
+void scope_declare_slot(Scope *scope, size_t slot, struct Value *value);
+
+
 #endif //PIELANG_SCOPE_H
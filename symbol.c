@@ -0,0 +1,67 @@
+#include "symbol.h"
+
+#include <string.h>
+
+#include "hashtable.h"
+#include "memory.h"
+
+// the symbols live until the program exits, so names can be kept by pointer anywhere
+static SymbolTable symbol_table = {.entries = NULL};
+
+
+void _insert_symbol(SymbolTableEntry entry) {
+  size_t mask = symbol_table.capacity - 1;
+  size_t index = entry.hash & mask;
+
+  while (symbol_table.entries[index].symbol != NULL) index = (index + 1) & mask;
+
+  symbol_table.entries[index] = entry;
+  symbol_table.length++;
+}
+
+
+void _grow_symbol_table() {
+  SymbolTableEntry *entries = symbol_table.entries;
+  size_t capacity = symbol_table.capacity;
+
+  symbol_table.capacity *= 2;
+  symbol_table.length = 0;
+  symbol_table.entries = memory_allocate_zeroed(MemorySubsystemHashTable, symbol_table.capacity, sizeof(SymbolTableEntry));
+
+  for (size_t i = 0; i < capacity; i++) {
+    if (entries[i].symbol != NULL) _insert_symbol(entries[i]);
+  }
+
+  memory_free(entries);
+}
+
+
+char *intern_symbol(const char *name, size_t length) {
+  if (symbol_table.entries == NULL) {
+    symbol_table.capacity = SYMBOL_TABLE_MIN_CAPACITY;
+    symbol_table.entries = memory_allocate_zeroed(MemorySubsystemHashTable, symbol_table.capacity, sizeof(SymbolTableEntry));
+    symbol_table.arena = new_arena();
+  }
+
+  uint64_t hash = hash_string(name, length);
+  size_t mask = symbol_table.capacity - 1;
+
+  for (size_t index = hash & mask; symbol_table.entries[index].symbol != NULL; index = (index + 1) & mask) {
+    SymbolTableEntry *entry = &symbol_table.entries[index];
+
+    if (entry->hash == hash && entry->length == length && memcmp(entry->symbol, name, length) == 0) return entry->symbol;
+  }
+
+  if ((symbol_table.length + 1) * 2 > symbol_table.capacity) _grow_symbol_table();
+
+  char *symbol = arena_copy_buffer(symbol_table.arena, name, length);
+
+  _insert_symbol((SymbolTableEntry) {.symbol = symbol, .length = length, .hash = hash});
+
+  return symbol;
+}
+
+
+char *intern_string(const char *name) {
+  return intern_symbol(name, strlen(name));
+}
@@ -0,0 +1,33 @@
+#ifndef PIELANG_SYMBOL_H
+#define PIELANG_SYMBOL_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bool.h"
+#include "arena.h"
+
+#define SYMBOL_TABLE_MIN_CAPACITY 256
+
+// a symbol is the one copy of a name, two names are equal when their symbols are the same pointer
+typedef struct {
+  char *symbol;
+  size_t length;
+  uint64_t hash;
+} SymbolTableEntry;
+
+typedef struct {
+  SymbolTableEntry *entries;
+  size_t capacity;
+  size_t length;
+  Arena *arena;
+} SymbolTable;
+
+
+char *intern_symbol(const char *name, size_t length);
+
+
+char *intern_string(const char *name);
+
+
+#endif //PIELANG_SYMBOL_H
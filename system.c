@@ -8,6 +8,9 @@
 #include "value.h"
 #include "scope.h"
 #include "utils.h"
+#include "gc.h"
+#include "symbol.h"
+#include "memory.h"
 
 
 #define BUFFER_SIZE 100000
@@ -19,15 +22,15 @@ Value *system_function_print(Value *context_value, TupleValue *parameter_values)
   }
 
   for (size_t i = 0; i < parameter_values->length; i++) {
-    StringValue *string_value = (StringValue *) convert_to_string_value(parameter_values->items[i]);
+    char *s = convert_to_string(parameter_values->items[i]);
 
-    printf("%s", string_value->string_value);
+    printf("%s", s);
 
     if (i != parameter_values->length - 1) {
       printf(" ");
     }
 
-    free_value((Value *) string_value);
+    memory_free(s);
   }
 
   printf("\n");
@@ -43,10 +46,10 @@ Value *system_function_min(Value *context_value, TupleValue *parameter_values) {
 
   long double val;
 
-  if (parameter_values->items[0]->value_type == ValueTypeIntegerValue) {
-    val = ((IntegerValue *) parameter_values->items[0])->integer_value;
+  if (get_value_type(parameter_values->items[0]) == ValueTypeIntegerValue) {
+    val = get_integer_value(parameter_values->items[0]);
   }
-  else if (parameter_values->items[0]->value_type == ValueTypeFloatValue) {
+  else if (get_value_type(parameter_values->items[0]) == ValueTypeFloatValue) {
     val = ((FloatValue *) parameter_values->items[0])->float_value;
   }
   else {
@@ -56,10 +59,10 @@ Value *system_function_min(Value *context_value, TupleValue *parameter_values) {
   for (size_t i = 0; i < parameter_values->length; i++) {
     long double temp;
 
-    if (parameter_values->items[i]->value_type == ValueTypeIntegerValue) {
-      temp = ((IntegerValue *) parameter_values->items[i])->integer_value;
+    if (get_value_type(parameter_values->items[i]) == ValueTypeIntegerValue) {
+      temp = get_integer_value(parameter_values->items[i]);
     }
-    else if (parameter_values->items[i]->value_type == ValueTypeFloatValue) {
+    else if (get_value_type(parameter_values->items[i]) == ValueTypeFloatValue) {
       temp = ((FloatValue *) parameter_values->items[i])->float_value;
     }
     else {
@@ -87,10 +90,10 @@ Value *system_function_max(Value *context_value, TupleValue *parameter_values) {
 
   long double val;
 
-  if (parameter_values->items[0]->value_type == ValueTypeIntegerValue) {
-    val = ((IntegerValue *) parameter_values->items[0])->integer_value;
+  if (get_value_type(parameter_values->items[0]) == ValueTypeIntegerValue) {
+    val = get_integer_value(parameter_values->items[0]);
   }
-  else if (parameter_values->items[0]->value_type == ValueTypeFloatValue) {
+  else if (get_value_type(parameter_values->items[0]) == ValueTypeFloatValue) {
     val = ((FloatValue *) parameter_values->items[0])->float_value;
   }
   else {
@@ -100,10 +103,10 @@ Value *system_function_max(Value *context_value, TupleValue *parameter_values) {
   for (size_t i = 0; i < parameter_values->length; i++) {
     long double temp;
 
-    if (parameter_values->items[i]->value_type == ValueTypeIntegerValue) {
-      temp = ((IntegerValue *) parameter_values->items[i])->integer_value;
+    if (get_value_type(parameter_values->items[i]) == ValueTypeIntegerValue) {
+      temp = get_integer_value(parameter_values->items[i]);
     }
-    else if (parameter_values->items[i]->value_type == ValueTypeFloatValue) {
+    else if (get_value_type(parameter_values->items[i]) == ValueTypeFloatValue) {
       temp = ((FloatValue *) parameter_values->items[i])->float_value;
     }
     else {
@@ -126,11 +129,11 @@ Value *system_function_max(Value *context_value, TupleValue *parameter_values) {
 
 Value *system_function_input(Value *context_value, TupleValue *parameter_values) {
   if (parameter_values->length > 0) {
-    StringValue *string_value = (StringValue *) convert_to_string_value(parameter_values->items[0]);
+    char *s = convert_to_string(parameter_values->items[0]);
 
-    printf("%s", string_value->string_value);
+    printf("%s", s);
 
-    free_value((Value *) string_value);
+    memory_free(s);
   }
 
   char buffer[BUFFER_SIZE];
@@ -147,7 +150,7 @@ Value *system_function_input(Value *context_value, TupleValue *parameter_values)
     buffer[buffer_length++] = c;
   }
 
-  return new_string_value(create_string_from_buffer(buffer, buffer_length), buffer_length);
+  return new_string_value_from_buffer(buffer, buffer_length);
 }
 
 
@@ -156,11 +159,11 @@ Value *system_function_number(Value *context_value, TupleValue *parameter_values
 
   Value *value = parameter_values->items[0];
 
-  if (value->value_type == ValueTypeIntegerValue || value->value_type == ValueTypeFloatValue) {
+  if (get_value_type(value) == ValueTypeIntegerValue || get_value_type(value) == ValueTypeFloatValue) {
     return copy_value(value);
   }
-  else if (value->value_type == ValueTypeStringValue) {
-    long double float_value = strtold(((StringValue *) value)->string_value, NULL);
+  else if (get_value_type(value) == ValueTypeStringValue) {
+    long double float_value = strtold(get_string_chars((StringValue *) value), NULL);
 
     if (ceil(float_value) == floor(float_value)) {
       return new_integer_value((long long int) float_value);
@@ -179,17 +182,17 @@ Value *system_function_len(Value *context_value, TupleValue *parameter_values) {
 
   Value *value = parameter_values->items[0];
 
-  if (value->value_type == ValueTypeStringValue) {
+  if (get_value_type(value) == ValueTypeStringValue) {
     StringValue *string_value = (StringValue *) value;
 
     return new_integer_value(string_value->length);
   }
-  else if (value->value_type == ValueTypeTupleValue) {
+  else if (get_value_type(value) == ValueTypeTupleValue) {
     TupleValue *tuple_value = (TupleValue *) value;
 
     return new_integer_value(tuple_value->length);
   }
-  else if (value->value_type == ValueTypeListValue) {
+  else if (get_value_type(value) == ValueTypeListValue) {
     ListValue *list_value = (ListValue *) value;
 
     return new_integer_value(list_value->length);
@@ -204,7 +207,7 @@ Value *system_function_list_push(Value *context_value, TupleValue *parameter_val
 
   ListValue *list_value = (ListValue *) context_value;
 
-  list_value->items = realloc(list_value->items, (list_value->length + parameter_values->length) * sizeof(Value *));
+  grow_list_value(list_value, parameter_values->length);
 
   for (size_t i = 0; i < parameter_values->length; i++) {
     list_value->items[list_value->length + i] = copy_value(parameter_values->items[i]);
@@ -224,24 +227,115 @@ Value *system_function_list_pop(Value *context_value, TupleValue *parameter_valu
     mid = -1;
   }
   else {
-    if (parameter_values->items[0]->value_type != ValueTypeIntegerValue) return result_value;
-    mid = normalize_index(((IntegerValue *) parameter_values->items[0])->integer_value, list_value->length);
+    if (get_value_type(parameter_values->items[0]) != ValueTypeIntegerValue) return result_value;
+    mid = normalize_index(get_integer_value(parameter_values->items[0]), list_value->length);
   }
 
   if (list_value->length <= mid) return result_value;
 
-  result_value = list_value->items[mid];
+  // the item may still be in another list that was copied from this one
+  result_value = share_value(list_value->items[mid]);
 
   for (size_t i = mid; i < list_value->length - 1; i++) {
     list_value->items[i] = list_value->items[i + 1];
   }
 
-  list_value->items = realloc(list_value->items, (list_value->length - 1) * sizeof(Value *));
+  // the capacity is kept for the next push
   list_value->length -= 1;
 
   return result_value;
 }
 
+// join(items, separator) puts the items together in one buffer, the items that are not strings are converted first
+Value *system_function_join(Value *context_value, TupleValue *parameter_values) {
+  if (parameter_values->length == 0) return new_null_value();
+
+  size_t item_count;
+  Value **items = get_array_items(parameter_values->items[0], &item_count);
+
+  if (items == NULL) return new_null_value();
+
+  char *separator = "";
+  size_t separator_length = 0;
+
+  if (parameter_values->length > 1 && get_value_type(parameter_values->items[1]) == ValueTypeStringValue) {
+    StringValue *separator_value = (StringValue *) parameter_values->items[1];
+
+    separator = get_string_chars(separator_value);
+    separator_length = separator_value->length;
+  }
+
+  char **parts = memory_allocate(MemorySubsystemString, item_count * sizeof(char *));
+  size_t *part_lengths = memory_allocate(MemorySubsystemString, item_count * sizeof(size_t));
+  size_t length = item_count == 0 ? 0 : (item_count - 1) * separator_length;
+
+  for (size_t i = 0; i < item_count; i++) {
+    if (get_value_type(items[i]) == ValueTypeStringValue) {
+      parts[i] = get_string_chars((StringValue *) items[i]);
+      part_lengths[i] = ((StringValue *) items[i])->length;
+    }
+    else {
+      char *s = convert_to_string(items[i]);
+
+      parts[i] = s == NULL ? copy_string("") : s;
+      part_lengths[i] = strlen(parts[i]);
+    }
+
+    length += part_lengths[i];
+  }
+
+  char *result_string = memory_allocate(MemorySubsystemString, length + 1);
+  size_t position = 0;
+
+  for (size_t i = 0; i < item_count; i++) {
+    if (i != 0) {
+      memcpy(result_string + position, separator, separator_length);
+      position += separator_length;
+    }
+
+    memcpy(result_string + position, parts[i], part_lengths[i]);
+    position += part_lengths[i];
+
+    if (get_value_type(items[i]) != ValueTypeStringValue) memory_free(parts[i]);
+  }
+
+  result_string[length] = '\0';
+
+  memory_free(parts);
+  memory_free(part_lengths);
+
+  return new_string_value(result_string, length);
+}
+
+
+// runs a collection right away and returns how many values were freed
+Value *system_function_gc(Value *context_value, TupleValue *parameter_values) {
+  return new_integer_value(gc_collect());
+}
+
+
+typedef struct {
+  char *name;
+  ValueType context_value_type;
+  SystemFunctionCallback *callback;
+} SystemFunctionDefinition;
+
+SystemFunctionDefinition system_function_definitions[] = {
+    {"print", ValueTypeNullValue, system_function_print},
+    {"min", ValueTypeNullValue, system_function_min},
+    {"max", ValueTypeNullValue, system_function_max},
+    {"input", ValueTypeNullValue, system_function_input},
+    {"number", ValueTypeNullValue, system_function_number},
+    {"len", ValueTypeNullValue, system_function_len},
+    {"gc", ValueTypeNullValue, system_function_gc},
+    {"join", ValueTypeNullValue, system_function_join},
+    {"push", ValueTypeListValue, system_function_list_push},
+    {"pop", ValueTypeListValue, system_function_list_pop},
+};
+
+#define SYSTEM_FUNCTION_COUNT (sizeof(system_function_definitions) / sizeof(SystemFunctionDefinition))
+
+
 void build_system_function(Scope *scope, char *name, Value *value) {
   SystemFunctionValue *system_function_value = (SystemFunctionValue *) value;
 
@@ -251,14 +345,20 @@ void build_system_function(Scope *scope, char *name, Value *value) {
 }
 
 
-void build_main_scope(Scope *scope) {
-  build_system_function(scope, "print", new_system_function_value(ValueTypeNullValue, system_function_print));
-  build_system_function(scope, "min", new_system_function_value(ValueTypeNullValue, system_function_min));
-  build_system_function(scope, "max", new_system_function_value(ValueTypeNullValue, system_function_max));
-  build_system_function(scope, "input", new_system_function_value(ValueTypeNullValue, system_function_input));
-  build_system_function(scope, "number", new_system_function_value(ValueTypeNullValue, system_function_number));
-  build_system_function(scope, "len", new_system_function_value(ValueTypeNullValue, system_function_len));
-  build_system_function(scope, "push", new_system_function_value(ValueTypeListValue, system_function_list_push));
-  build_system_function(scope, "pop", new_system_function_value(ValueTypeListValue, system_function_list_pop));
+// global system functions get slots in the main block, member functions stay in the variable maps
+void declare_system_functions(Block *block) {
+  for (size_t i = 0; i < SYSTEM_FUNCTION_COUNT; i++) {
+    if (system_function_definitions[i].context_value_type == ValueTypeNullValue) {
+      block_add_slot(block, intern_string(system_function_definitions[i].name));
+    }
+  }
 }
 
+
+void build_main_scope(Scope *scope) {
+  for (size_t i = 0; i < SYSTEM_FUNCTION_COUNT; i++) {
+    SystemFunctionDefinition *definition = &system_function_definitions[i];
+
+    build_system_function(scope, intern_string(definition->name), new_system_function_value(definition->context_value_type, definition->callback));
+  }
+}
@@ -8,6 +8,9 @@
 #include "scope.h"
 
 
+void declare_system_functions(Block *block);
+
+
 void build_main_scope(Scope *scope);
 
 
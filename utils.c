@@ -1,5 +1,11 @@
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "memory.h"
 
 size_t normalize_index(long long int index, long long int length) {
   if (index >= length) {
@@ -14,13 +20,13 @@ size_t normalize_index(long long int index, long long int length) {
 
 
 char *copy_string(char *s) {
-  char *result = calloc(strlen(s) + 1, sizeof(char));
+  char *result = memory_allocate_zeroed(MemorySubsystemString, strlen(s) + 1, sizeof(char));
   strcpy(result, s);
   return result;
 }
 
 char *create_string_from_char(char c) {
-  char *s = calloc(2, sizeof(char));
+  char *s = memory_allocate_zeroed(MemorySubsystemString, 2, sizeof(char));
 
   s[0] = c;
 
@@ -29,7 +35,7 @@ char *create_string_from_char(char c) {
 
 // usage for buffer with no \0 at end ex.
 char *create_string_from_buffer(char *buffer, size_t buffer_length) {
-  char *s = calloc(buffer_length + 1, sizeof(char));
+  char *s = memory_allocate_zeroed(MemorySubsystemString, buffer_length + 1, sizeof(char));
 
   for (size_t i = 0; i < buffer_length; i++) {
     s[i] = buffer[i];
@@ -37,3 +43,36 @@ char *create_string_from_buffer(char *buffer, size_t buffer_length) {
 
   return s;
 }
+
+
+// the script is mapped read only, so the lexer reads the page cache without a copy
+char *map_file(const char *filename, size_t *length) {
+  int fd = open(filename, O_RDONLY);
+
+  if (fd < 0) return NULL;
+
+  struct stat file_stat;
+
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return NULL;
+  }
+
+  *length = (size_t) file_stat.st_size;
+
+  // mmap does not take an empty length
+  if (*length == 0) {
+    close(fd);
+    return "";
+  }
+
+  char *content = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (content == MAP_FAILED) return NULL;
+
+  madvise(content, *length, MADV_SEQUENTIAL);
+
+  return content;
+}
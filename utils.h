@@ -12,5 +12,7 @@ char *create_string_from_char(char c);
 
 char *create_string_from_buffer(char *buffer, size_t buffer_length);
 
+char *map_file(const char *filename, size_t *length);
+
 
 #endif //PIELANG_UTILS_H
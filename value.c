@@ -8,19 +8,39 @@
 #define MAX_BUFFER_SIZE 10000
 
 #include "utils.h"
+#include "gc.h"
+#include "pool.h"
+#include "memory.h"
 
+static Value *empty_string_value = NULL;
+static Value *char_string_values[SHARED_CHAR_STRING_COUNT];
+static Value *empty_tuple_value = NULL;
+
+
+// the items of a list are read again each time they are needed, since it may be pushed to or popped from while it is iterated
+Value **get_array_items(Value *value, size_t *length) {
+  if (get_value_type(value) == ValueTypeListValue) {
+    *length = ((ListValue *) value)->length;
+    return ((ListValue *) value)->items;
+  }
+  else if (get_value_type(value) == ValueTypeTupleValue) {
+    *length = ((TupleValue *) value)->length;
+    return ((TupleValue *) value)->items;
+  }
+
+  *length = 0;
+  return NULL;
+}
 
 
 char *convert_to_string(Value *value) {
-  switch (value->value_type) {
+  switch (get_value_type(value)) {
     case ValueTypeNullValue: {
       return copy_string("null");
     }
 
     case ValueTypeBoolValue: {
-      BoolValue *bool_value = (BoolValue *) value;
-
-      if (bool_value->bool_value) {
+      if (get_bool_value(value)) {
         return copy_string("true");
       }
       else {
@@ -31,9 +51,7 @@ char *convert_to_string(Value *value) {
     case ValueTypeIntegerValue: {
       char buffer[MAX_BUFFER_SIZE] = {0};
 
-      IntegerValue *integer_value = (IntegerValue *) value;
-
-      sprintf(buffer, "%lld", integer_value->integer_value);
+      sprintf(buffer, "%lld", get_integer_value(value));
 
       return copy_string(buffer);
     }
@@ -49,7 +67,9 @@ char *convert_to_string(Value *value) {
     }
 
     case ValueTypeStringValue: {
-      return copy_string(((StringValue *) value)->string_value);
+      StringValue *string_value = (StringValue *) value;
+
+      return create_string_from_buffer(get_string_chars(string_value), string_value->length);
     }
 
     case ValueTypeTupleValue: {
@@ -60,18 +80,18 @@ char *convert_to_string(Value *value) {
       strcpy(buffer, "(");
 
       for (size_t i = 0; i < tuple_value->length; i++) {
-        StringValue *string_value = (StringValue *) convert_to_string_value(tuple_value->items[i]);
+        char *s = convert_to_string(tuple_value->items[i]);
 
-        if (tuple_value->items[i]->value_type == ValueTypeStringValue) {
+        if (get_value_type(tuple_value->items[i]) == ValueTypeStringValue) {
           strcat(buffer, "\'");
-          strcat(buffer, string_value->string_value);
+          strcat(buffer, s);
           strcat(buffer, "\'");
         }
         else {
-          strcat(buffer, string_value->string_value);
+          strcat(buffer, s);
         }
 
-        free_value((Value *) string_value);
+        memory_free(s);
 
         if (i != tuple_value->length - 1) {
           strcat(buffer, ", ");
@@ -91,11 +111,11 @@ char *convert_to_string(Value *value) {
       strcpy(buffer, "[");
 
       for (size_t i = 0; i < list_value->length; i++) {
-        StringValue *string_value = (StringValue *) convert_to_string_value(list_value->items[i]);
+        char *s = convert_to_string(list_value->items[i]);
 
-        strcat(buffer, string_value->string_value);
+        strcat(buffer, s);
 
-        free_value((Value *) string_value);
+        memory_free(s);
 
         if (i != list_value->length - 1) {
           strcat(buffer, ", ");
@@ -115,12 +135,15 @@ char *convert_to_string(Value *value) {
       strcpy(buffer, "*[");
 
       if (generator_value->generator_value_type == GeneratorValueTypeArray) {
-        for (long long int i = 0; i < generator_value->end_value; i++) {
-          char *s = convert_to_string(generator_value->target_values[i]);
+        size_t length;
+        Value **items = get_array_items(generator_value->target_value, &length);
+
+        for (long long int i = 0; i < generator_value->end_value && i < length; i++) {
+          char *s = convert_to_string(items[i]);
 
           strcat(buffer, s);
 
-          free(s);
+          memory_free(s);
 
           if (i != generator_value->end_value - 1) {
             strcat(buffer, ", ");
@@ -161,17 +184,17 @@ char *convert_to_string(Value *value) {
 
 
 bool convert_to_bool(Value *value) {
-  switch (value->value_type) {
+  switch (get_value_type(value)) {
     case ValueTypeNullValue: {
       return false;
     }
 
     case ValueTypeBoolValue: {
-      return ((BoolValue *) value)->bool_value;
+      return get_bool_value(value);
     }
 
     case ValueTypeIntegerValue: {
-      return ((IntegerValue *) value)->integer_value != 0;
+      return get_integer_value(value) != 0;
     }
 
     case ValueTypeFloatValue: {
@@ -198,17 +221,17 @@ bool convert_to_bool(Value *value) {
 
 
 long long int convert_to_integer(Value *value) {
-  switch (value->value_type) {
+  switch (get_value_type(value)) {
     case ValueTypeNullValue: {
       return 0;
     }
 
     case ValueTypeBoolValue: {
-      return ((BoolValue *) value)->bool_value;
+      return get_bool_value(value);
     }
 
     case ValueTypeIntegerValue: {
-      return ((IntegerValue *) value)->integer_value;
+      return get_integer_value(value);
     }
 
     case ValueTypeFloatValue: {
@@ -235,26 +258,12 @@ long long int convert_to_integer(Value *value) {
 
 
 Value *new_null_value() {
-  static Value *value;
-
-  if (value == NULL) {
-    value = malloc(sizeof(Value));
-
-    value->value_type = ValueTypeNullValue;
-    value->linked_variable_count = 0; // no need for others since they are not taken with malloc, the default value for an int in a struct is 0
-  }
-
-  return value;
+  return NULL_VALUE;
 }
 
 
 Value *new_bool_value(bool val) {
-  BoolValue *bool_value = malloc(sizeof(BoolValue));
-
-  bool_value->value = (Value){.value_type = ValueTypeBoolValue};
-  bool_value->bool_value = val;
-
-  return (Value *) bool_value;
+  return val ? TRUE_VALUE : FALSE_VALUE;
 }
 
 
@@ -264,9 +273,11 @@ Value *new_bool_value_from_literal(BoolLiteral *literal) {
 
 
 Value *new_integer_value(long long int val) {
-  IntegerValue *integer_value = malloc(sizeof(IntegerValue));
+  if (val >= MIN_IMMEDIATE_INTEGER && val <= MAX_IMMEDIATE_INTEGER) {
+    return (Value *) (((uintptr_t) val << 1u) | 0x1u);
+  }
 
-  integer_value->value = (Value){.value_type = ValueTypeIntegerValue};
+  IntegerValue *integer_value = (IntegerValue *) gc_allocate_value(sizeof(IntegerValue), ValueTypeIntegerValue);
   integer_value->integer_value = val;
 
   return (Value *)integer_value;
@@ -279,9 +290,7 @@ Value *new_integer_value_from_literal(IntegerLiteral *literal) {
 
 
 Value *new_float_value(long double val) {
-  FloatValue *float_value = malloc(sizeof(FloatValue));
-
-  float_value->value = (Value){.value_type = ValueTypeFloatValue};
+  FloatValue *float_value = (FloatValue *) gc_allocate_value(sizeof(FloatValue), ValueTypeFloatValue);
   float_value->float_value = val;
 
   return (Value *)float_value;
@@ -293,45 +302,229 @@ Value *new_float_value_from_literal(FloatLiteral *literal) {
 }
 
 
-Value *new_string_value(char *val, size_t length) {
-  StringValue *string_value = malloc(sizeof(StringValue));
+// the chars of a short string are left for the caller to fill in the inline buffer
+StringValue *_allocate_string_value(Value *value, char *val, size_t length) {
+  StringValue *string_value = (StringValue *) value;
 
-  string_value->value = (Value){.value_type = ValueTypeStringValue};
-  string_value->string_value = val;
+  string_value->string_value = length < STRING_INLINE_CAPACITY ? string_value->storage.inline_string : val;
+  string_value->string_value[length] = '\0';
+
+  if (string_value->string_value == val) string_value->storage.capacity = length;
   string_value->length = length;
+  string_value->hash = 0;
+
+  return string_value;
+}
+
+
+// a shared value is made on first use and is never freed
+Value *_get_shared_string_value(char c, size_t length) {
+  Value **shared_value = length == 0 ? &empty_string_value : &char_string_values[(unsigned char) c];
+
+  if (*shared_value == NULL) {
+    StringValue *string_value = _allocate_string_value(gc_allocate_immortal_value(sizeof(StringValue), ValueTypeStringValue), NULL, length);
+    string_value->storage.inline_string[0] = c;
+
+    *shared_value = (Value *) string_value;
+  }
+
+  return *shared_value;
+}
+
+
+bool _is_shared_string(char *val, size_t length) {
+  return length == 0 || (length == 1 && (unsigned char) val[0] < SHARED_CHAR_STRING_COUNT);
+}
+
+
+// takes the string, which is freed right away when a shared value stands for it
+Value *new_string_value(char *val, size_t length) {
+  if (_is_shared_string(val, length)) {
+    Value *shared_value = _get_shared_string_value(length == 0 ? 0 : val[0], length);
+
+    memory_free(val);
+
+    return shared_value;
+  }
+
+  StringValue *string_value = _allocate_string_value(gc_allocate_value(sizeof(StringValue), ValueTypeStringValue), val, length);
+
+  if (string_value->string_value != val) {
+    memcpy(string_value->string_value, val, length);
+    memory_free(val);
+  }
+  else {
+    gc_account_bytes(length + 1);
+  }
+
+  return (Value *)string_value;
+}
+
+
+// copies the chars, a short string is copied straight into the value without a buffer of its own
+Value *new_string_value_from_buffer(const char *buffer, size_t length) {
+  if (_is_shared_string((char *) buffer, length)) return _get_shared_string_value(length == 0 ? 0 : buffer[0], length);
+
+  char *val = length < STRING_INLINE_CAPACITY ? NULL : memory_allocate(MemorySubsystemString, length + 1);
+
+  StringValue *string_value = _allocate_string_value(gc_allocate_value(sizeof(StringValue), ValueTypeStringValue), val, length);
+
+  if (val != NULL) gc_account_bytes(length + 1);
+
+  memcpy(string_value->string_value, buffer, length);
 
   return (Value *)string_value;
 }
 
 
+Value *new_char_string_value(char c) {
+  if ((unsigned char) c < SHARED_CHAR_STRING_COUNT) return _get_shared_string_value(c, 1);
+
+  return new_string_value_from_buffer(&c, 1);
+}
+
+
 Value *new_string_value_from_literal(StringLiteral *literal) {
-  return new_string_value(copy_string(literal->string_literal), literal->length);
+  return new_string_value_from_buffer(literal->string_literal, literal->length);
+}
+
+
+// the parts stay reachable through the rope until it is flattened
+Value *new_rope_string_value(StringValue *left_string_value, StringValue *right_string_value) {
+  StringValue *string_value = (StringValue *) gc_allocate_value(sizeof(StringValue), ValueTypeStringValue);
+
+  // the parts are kept by the rope, so they must not change in place anymore
+  share_value((Value *) left_string_value);
+  share_value((Value *) right_string_value);
+
+  string_value->string_value = NULL;
+  string_value->length = left_string_value->length + right_string_value->length;
+  string_value->hash = 0;
+  string_value->storage.rope_values[0] = left_string_value;
+  string_value->storage.rope_values[1] = right_string_value;
+
+  return (Value *)string_value;
+}
+
+
+// the parts are written from the end with a stack of the left parts still to go, a rope built by appending is as deep as it is long
+char *flatten_string_value(StringValue *string_value) {
+  char *buffer = memory_allocate(MemorySubsystemString, string_value->length + 1);
+  size_t position = string_value->length;
+
+  StringValue **rope_stack = NULL;
+  size_t rope_stack_length = 0;
+  size_t rope_stack_capacity = 0;
+
+  StringValue *part = string_value;
+
+  buffer[position] = '\0';
+
+  while (true) {
+    if (part->string_value == NULL) {
+      if (rope_stack_length == rope_stack_capacity) {
+        rope_stack_capacity = rope_stack_capacity == 0 ? 16 : rope_stack_capacity * 2;
+        rope_stack = memory_reallocate(MemorySubsystemString, rope_stack, rope_stack_capacity * sizeof(StringValue *));
+      }
+
+      rope_stack[rope_stack_length++] = part->storage.rope_values[0];
+      part = part->storage.rope_values[1];
+      continue;
+    }
+
+    position -= part->length;
+    memcpy(buffer + position, part->string_value, part->length);
+
+    if (rope_stack_length == 0) break;
+
+    part = rope_stack[--rope_stack_length];
+  }
+
+  memory_free(rope_stack);
+  gc_account_bytes(string_value->length + 1);
+
+  string_value->string_value = buffer;
+  string_value->storage.capacity = string_value->length;
+
+  return buffer;
 }
 
 
+// only for a string that is not shared, the buffer at least doubles when it grows so appending in a loop stays linear
+void append_to_string_value(StringValue *string_value, const char *buffer, size_t length) {
+  char *chars = get_string_chars(string_value);
+  size_t new_length = string_value->length + length;
 
+  if (new_length >= STRING_INLINE_CAPACITY) {
+    bool is_inline = chars == string_value->storage.inline_string;
+    size_t capacity = is_inline ? 0 : string_value->storage.capacity;
 
-Value *new_function_value(Block *block, char **arguments, size_t argument_count) {
-  FunctionValue *function_value = malloc(sizeof(FunctionValue));
+    if (new_length > capacity) {
+      capacity = capacity * 2 > new_length ? capacity * 2 : new_length;
 
-  char **ss = malloc(argument_count * sizeof(char *));
-  for (size_t i = 0; i < argument_count; i++) {
-    ss[i] = copy_string(arguments[i]);
+      if (is_inline) {
+        chars = memory_allocate(MemorySubsystemString, capacity + 1);
+        memcpy(chars, string_value->storage.inline_string, string_value->length);
+        gc_account_bytes(capacity + 1);
+      }
+      else {
+        chars = memory_reallocate(MemorySubsystemString, chars, capacity + 1);
+        gc_account_bytes(capacity - string_value->storage.capacity);
+      }
+
+      string_value->string_value = chars;
+      string_value->storage.capacity = capacity;
+    }
   }
 
-  function_value->value = (Value){.value_type = ValueTypeFunctionValue};
-  function_value->block = block;
-  function_value->arguments = ss;
-  function_value->argument_count = argument_count;
+  memcpy(chars + string_value->length, buffer, length);
+  chars[new_length] = '\0';
+
+  string_value->length = new_length;
+  string_value->hash = 0;
+}
+
+
+// makes room for length more items, the items at least double when they grow so appending in a loop stays linear
+void grow_list_value(ListValue *list_value, size_t length) {
+  size_t new_length = list_value->length + length;
+
+  if (new_length <= list_value->capacity) return;
+
+  size_t capacity = list_value->capacity * 2 > new_length ? list_value->capacity * 2 : new_length;
+
+  list_value->items = memory_reallocate(MemorySubsystemValue, list_value->items, capacity * sizeof(Value *));
+  gc_account_bytes((capacity - list_value->capacity) * sizeof(Value *));
+
+  list_value->capacity = capacity;
+}
+
+
+uint64_t get_string_value_hash(StringValue *string_value) {
+  if (string_value->hash == 0) string_value->hash = hash_string(get_string_chars(string_value), string_value->length);
+
+  return string_value->hash;
+}
+
+
+
+
+Value *new_function_value(FunctionExpression *function_expression) {
+  FunctionValue *function_value = (FunctionValue *) gc_allocate_value(sizeof(FunctionValue), ValueTypeFunctionValue);
+
+  function_value->function_expression = function_expression;
+  function_value->global_scope = NULL;
+  function_value->block = function_expression->block;
+  function_value->chunk = NULL;
+  function_value->arguments = function_expression->arguments;
+  function_value->argument_count = function_expression->argument_count;
 
   return (Value *)function_value;
 }
 
 
 Value *new_system_function_value(ValueType context_value_type, SystemFunctionCallback *callback) {
-  SystemFunctionValue *system_function_value = malloc(sizeof(SystemFunctionValue));
-
-  system_function_value->value = (Value) {.value_type = ValueTypeSystemFunctionValue};
+  SystemFunctionValue *system_function_value = (SystemFunctionValue *) gc_allocate_value(sizeof(SystemFunctionValue), ValueTypeSystemFunctionValue);
   system_function_value->context_value_type = context_value_type;
   system_function_value->callback = callback;
 
@@ -339,10 +532,25 @@ Value *new_system_function_value(ValueType context_value_type, SystemFunctionCal
 }
 
 
+// a call without arguments builds an empty tuple, they are all the same shared value
 Value *new_tuple_value(Value **items, size_t length, bool has_finished) {
-  TupleValue *tuple_value = malloc(sizeof(TupleValue));
+  if (length == 0) {
+    memory_free(items);
+
+    if (empty_tuple_value == NULL) {
+      TupleValue *tuple_value = (TupleValue *) gc_allocate_immortal_value(sizeof(TupleValue), ValueTypeTupleValue);
+      tuple_value->items = NULL;
+      tuple_value->length = 0;
+      tuple_value->has_finished = false;
 
-  tuple_value->value = (Value){.value_type = ValueTypeTupleValue};
+      empty_tuple_value = (Value *) tuple_value;
+    }
+
+    return empty_tuple_value;
+  }
+
+  TupleValue *tuple_value = (TupleValue *) gc_allocate_value(sizeof(TupleValue), ValueTypeTupleValue);
+  gc_account_bytes(length * sizeof(Value *));
   tuple_value->items = items;
   tuple_value->length = length;
   tuple_value->has_finished = has_finished;
@@ -352,11 +560,11 @@ Value *new_tuple_value(Value **items, size_t length, bool has_finished) {
 
 
 Value *new_list_value(Value **items, size_t length, bool has_finished) {
-  ListValue *list_value = malloc(sizeof(ListValue));
-
-  list_value->value = (Value){.value_type = ValueTypeListValue};
+  ListValue *list_value = (ListValue *) gc_allocate_value(sizeof(ListValue), ValueTypeListValue);
+  gc_account_bytes(length * sizeof(Value *));
   list_value->items = items;
   list_value->length = length;
+  list_value->capacity = length;
   list_value->has_finished = has_finished;
 
   return (Value *)list_value;
@@ -365,44 +573,38 @@ Value *new_list_value(Value **items, size_t length, bool has_finished) {
 
 Value *new_generator_value(GeneratorValueType generator_value_type, Value *first_value, Value *second_value) {
   if (generator_value_type == GeneratorValueTypeNumber) {
-    if (first_value->value_type == ValueTypeIntegerValue && second_value->value_type == ValueTypeIntegerValue) {
-      IntegerValue *left_integer_value = (IntegerValue *) first_value;
-      IntegerValue *right_integer_value = (IntegerValue *) second_value;
-
-      GeneratorValue *generator_value = malloc(sizeof(GeneratorValue));
-      generator_value->value = (Value) {.value_type = ValueTypeGeneratorValue};
+    if (get_value_type(first_value) == ValueTypeIntegerValue && get_value_type(second_value) == ValueTypeIntegerValue) {
+      GeneratorValue *generator_value = (GeneratorValue *) gc_allocate_value(sizeof(GeneratorValue), ValueTypeGeneratorValue);
       generator_value->generator_value_type = GeneratorValueTypeNumber;
-      generator_value->start_value = left_integer_value->integer_value;
-      generator_value->end_value = right_integer_value->integer_value;
-      generator_value->target_values = NULL;
-      generator_value->index = left_integer_value->integer_value;
+      generator_value->start_value = get_integer_value(first_value);
+      generator_value->end_value = get_integer_value(second_value);
+      generator_value->target_value = NULL;
+      generator_value->index = get_integer_value(first_value);
 
       return (Value *) generator_value;
     }
   }
   else if (generator_value_type == GeneratorValueTypeArray) {
-    if (first_value->value_type == ValueTypeTupleValue) {
+    if (get_value_type(first_value) == ValueTypeTupleValue) {
       TupleValue *tuple_value = (TupleValue *) first_value;
 
-      GeneratorValue *generator_value = malloc(sizeof(GeneratorValue));
-      generator_value->value = (Value) {.value_type = ValueTypeGeneratorValue};
+      GeneratorValue *generator_value = (GeneratorValue *) gc_allocate_value(sizeof(GeneratorValue), ValueTypeGeneratorValue);
       generator_value->generator_value_type = GeneratorValueTypeArray;
       generator_value->start_value = 0;
       generator_value->end_value = tuple_value->length;
-      generator_value->target_values = tuple_value->items;
+      generator_value->target_value = first_value;
       generator_value->index = 0;
 
       return (Value *) generator_value;
     }
-    if (first_value->value_type == ValueTypeListValue) {
+    if (get_value_type(first_value) == ValueTypeListValue) {
       ListValue *list_value = (ListValue *) first_value;
 
-      GeneratorValue *generator_value = malloc(sizeof(GeneratorValue));
-      generator_value->value = (Value) {.value_type = ValueTypeGeneratorValue};
+      GeneratorValue *generator_value = (GeneratorValue *) gc_allocate_value(sizeof(GeneratorValue), ValueTypeGeneratorValue);
       generator_value->generator_value_type = GeneratorValueTypeArray;
       generator_value->start_value = 0;
       generator_value->end_value = list_value->length;
-      generator_value->target_values = list_value->items;
+      generator_value->target_value = first_value;
       generator_value->index = 0;
 
       return (Value *) generator_value;
@@ -426,8 +628,11 @@ Value *fetch_value_from_generator_value(GeneratorValue *generator_value) {
     }
   }
   else if (generator_value->generator_value_type == GeneratorValueTypeArray) {
-    if (generator_value->index < generator_value->end_value) {
-      return generator_value->target_values[generator_value->index++];
+    size_t length;
+    Value **items = get_array_items(generator_value->target_value, &length);
+
+    if (generator_value->index < generator_value->end_value && generator_value->index < length) {
+      return share_value(items[generator_value->index++]);
     }
     else {
       return new_null_value();
@@ -440,7 +645,7 @@ Value *fetch_value_from_generator_value(GeneratorValue *generator_value) {
 
 
 Value *convert_to_generator_value(Value *value) {
-  if (value->value_type == ValueTypeTupleValue || value->value_type == ValueTypeListValue) {
+  if (get_value_type(value) == ValueTypeTupleValue || get_value_type(value) == ValueTypeListValue) {
     return new_generator_value(GeneratorValueTypeArray, value, NULL);
   }
 
@@ -449,6 +654,8 @@ Value *convert_to_generator_value(Value *value) {
 
 
 Value *convert_to_string_value(Value *value) {
+  if (get_value_type(value) == ValueTypeStringValue) return copy_value(value);
+
   char *s = convert_to_string(value);
 
   if (s == NULL) return new_null_value();
@@ -468,13 +675,13 @@ Value *convert_to_integer_value(Value *value) {
 
 
 Value *copy_value(Value *value) {
-  switch(value->value_type) {
+  switch(get_value_type(value)) {
     case ValueTypeBoolValue: {
-      return new_bool_value(((BoolValue*) value)->bool_value);
+      return new_bool_value(get_bool_value(value));
     }
 
     case ValueTypeIntegerValue: {
-     return new_integer_value(((IntegerValue*) value)->integer_value);
+     return new_integer_value(get_integer_value(value));
     }
 
     case ValueTypeFloatValue: {
@@ -482,15 +689,15 @@ Value *copy_value(Value *value) {
     }
 
     case ValueTypeStringValue: {
-      char *s = copy_string(((StringValue *) value)->string_value);
+      StringValue *string_value = (StringValue *) value;
 
-      return new_string_value(s, strlen(s));
+      return new_string_value_from_buffer(get_string_chars(string_value), string_value->length);
     }
 
     case ValueTypeTupleValue: {
       TupleValue *tuple_value = (TupleValue *) value;
 
-      Value **items = calloc(tuple_value->length, sizeof(Value *));
+      Value **items = memory_allocate_zeroed(MemorySubsystemValue, tuple_value->length, sizeof(Value *));
 
       memcpy(items, tuple_value->items, tuple_value->length * sizeof(Value *));
 
@@ -500,7 +707,7 @@ Value *copy_value(Value *value) {
     case ValueTypeListValue: {
       ListValue *list_value = (ListValue *) value;
 
-      Value **items = calloc(list_value->length, sizeof(Value *));
+      Value **items = memory_allocate_zeroed(MemorySubsystemValue, list_value->length, sizeof(Value *));
 
       memcpy(items, list_value->items, list_value->length * sizeof(Value *));
 
@@ -519,11 +726,10 @@ Value *copy_value(Value *value) {
 
 
 Variable *new_variable(char *variable_name, Value *value) {
-  Variable *variable = malloc(sizeof(Variable));
+  Variable *variable = memory_allocate(MemorySubsystemValue, sizeof(Variable));
 
   variable->variable_name = variable_name;
   variable->value = value;
-  variable->value->linked_variable_count++;
   variable->is_readonly = false;
 
   return variable;
@@ -550,87 +756,72 @@ void free_variable_map(HashTable *variable_map) {
 }
 
 
+// only the collector frees values, the values this one refers to are swept on their own
 void free_value(Value *value) {
-  if (value->value_type != ValueTypeNullValue && value->linked_variable_count == 0) {
-    switch (value->value_type) {
+  if (is_heap_value(value)) {
+    switch (get_value_type(value)) {
       case ValueTypeNullValue: {
         break;
       }
 
-      case ValueTypeBoolValue: {
-        BoolValue *bool_value = (BoolValue *)value;
-        free(bool_value);
-        break;
-      }
-
       case ValueTypeIntegerValue: {
         IntegerValue *integer_value = (IntegerValue *)value;
-        free(integer_value);
+        pool_free(integer_value, sizeof(IntegerValue));
         break;
       }
 
       case ValueTypeFloatValue: {
         FloatValue *float_value = (FloatValue *)value;
-        free(float_value);
+        pool_free(float_value, sizeof(FloatValue));
         break;
       }
 
       case ValueTypeStringValue: {
         StringValue *string_value = (StringValue *)value;
-        free(string_value->string_value);
-        free(string_value);
+        if (string_value->string_value != NULL && string_value->string_value != string_value->storage.inline_string) memory_free(string_value->string_value);
+        pool_free(string_value, sizeof(StringValue));
         break;
       }
 
       case ValueTypeFunctionValue: {
         FunctionValue *function_value = (FunctionValue *)value;
 
-        for (size_t i = 0; i < function_value->argument_count; i += 1u) {
-          free(function_value->arguments[i]);
-        }
-
-        free(function_value->arguments);
-        free(function_value);
+        pool_free(function_value, sizeof(FunctionValue));
         break;
       }
 
       case ValueTypeSystemFunctionValue: {
         SystemFunctionValue *system_function_value = (SystemFunctionValue *)value;
 
-        free(system_function_value);
+        pool_free(system_function_value, sizeof(SystemFunctionValue));
         break;
       }
 
       case ValueTypeTupleValue: {
         TupleValue *tuple_value = (TupleValue *) value;
 
-        for (size_t i = 0; i < tuple_value->length; i += 1u) {
-          tuple_value->items[i]->linked_variable_count--;
-          free_value(tuple_value->items[i]);
-        }
-
-        free(tuple_value->items);
-        free(tuple_value);
+        memory_free(tuple_value->items);
+        pool_free(tuple_value, sizeof(TupleValue));
         break;
       }
 
       case ValueTypeListValue: {
         ListValue *list_value = (ListValue *)value;
 
-        for (size_t i = 0; i < list_value->length; i += 1u) {
-          list_value->items[i]->linked_variable_count--;
-          free_value(list_value->items[i]);
-        }
-
-        free(list_value->items);
-        free(list_value);
+        memory_free(list_value->items);
+        pool_free(list_value, sizeof(ListValue));
         break;
       }
 
       case ValueTypeGeneratorValue: {
         GeneratorValue *generator_value = (GeneratorValue *) value;
 
-        free(generator_value);
+        pool_free(generator_value, sizeof(GeneratorValue));
+        break;
+      }
+
+      // booleans are immediates, they are never heap values
+      case ValueTypeBoolValue: {
         break;
       }
     }
@@ -639,11 +830,5 @@ void free_value(Value *value) {
 
 
 void free_variable(Variable *variable) {
-  if (variable->value != NULL) {
-    variable->value->linked_variable_count--;
-
-    free_value(variable->value);
-  }
-  free(variable->variable_name);
-  free(variable);
+  memory_free(variable);
 }
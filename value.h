@@ -1,6 +1,8 @@
 #ifndef PIELANG_VALUE_H
 #define PIELANG_VALUE_H
 
+#include <stdint.h>
+
 #include "bool.h"
 #include "lexer.h"
 #include "ast.h"
@@ -28,13 +30,12 @@ typedef enum {
 
 struct Value {
   ValueType value_type;
-  size_t linked_variable_count;
+  bool is_marked;
+  bool is_pinned;
+  // set once the value may be seen from more than one place, a value that is not shared can be changed in place
+  bool is_shared;
   struct Value *context_value;
-};
-
-struct BoolValue {
-  struct Value value;
-  bool bool_value;
+  struct Value *next_value;
 };
 
 struct IntegerValue {
@@ -47,10 +48,25 @@ struct FloatValue {
   long double float_value;
 };
 
+// a string shorter than the inline capacity is kept in the value itself and string_value points to it
+#define STRING_INLINE_CAPACITY 16
+
+// adding up to a string at least this long makes a rope of the two parts instead of copying them
+#define STRING_ROPE_MIN_LENGTH 256
+
 struct StringValue {
   struct Value value;
+  // NULL while the string is a rope, its chars are only put together once they are read
   char *string_value;
   size_t length;
+  // 0 until the hash is first asked for
+  uint64_t hash;
+  union {
+    char inline_string[STRING_INLINE_CAPACITY];
+    struct StringValue *rope_values[2];
+    // the size of the buffer of a string that is not inline, not counting the terminating zero
+    size_t capacity;
+  } storage;
 };
 
 struct TupleValue {
@@ -60,16 +76,27 @@ struct TupleValue {
   bool has_finished;
 };
 
+// the items are allocated for capacity values, the ones after length are not set
 struct ListValue {
   struct Value value;
   struct Value **items;
   size_t length;
+  size_t capacity;
   bool has_finished;
 };
 
+struct Chunk;
+struct Scope;
+
 struct FunctionValue {
   struct Value value;
+  // the block is NULL until a lazy body is parsed from the function expression
+  FunctionExpression *function_expression;
+  // the main scope the function was defined in, so a function imported from a module reads the globals of the module
+  struct Scope *global_scope;
   Block *block;
+  struct Chunk *chunk;
+  // the symbols of the function expression, owned by the ast like the block
   char **arguments;
   size_t argument_count;
 };
@@ -85,7 +112,7 @@ struct SystemFunctionValue {
 struct GeneratorValue {
   struct Value value;
   GeneratorValueType generator_value_type;
-  struct Value **target_values;
+  struct Value *target_value;
   long long int start_value;
   long long int end_value;
   long long int index;
@@ -98,7 +125,6 @@ struct Variable {
 };
 
 typedef struct Value Value;
-typedef struct BoolValue BoolValue;
 typedef struct IntegerValue IntegerValue;
 typedef struct FloatValue FloatValue;
 typedef struct StringValue StringValue;
@@ -109,6 +135,66 @@ typedef struct SystemFunctionValue SystemFunctionValue;
 typedef struct GeneratorValue GeneratorValue;
 typedef struct Variable Variable;
 
+// null, the bools and the integers that fit in 63 bits live in the pointer itself and are never allocated,
+// an integer has its lowest bit set, null and the bools end with 10, and heap values are aligned so they end with 00
+#define NULL_VALUE ((Value *) 0x2u)
+#define FALSE_VALUE ((Value *) 0x6u)
+#define TRUE_VALUE ((Value *) 0xEu)
+
+// the empty string, the ascii strings of one char and the empty tuple are shared, they never change once made
+#define SHARED_CHAR_STRING_COUNT 128
+
+#define MIN_IMMEDIATE_INTEGER (-(1LL << 62))
+#define MAX_IMMEDIATE_INTEGER ((1LL << 62) - 1)
+
+
+static inline bool is_heap_value(Value *value) {
+  return ((uintptr_t) value & 0x3u) == 0;
+}
+
+
+// every value read out of a variable, a container or a module goes through here, it is never changed in place afterwards
+static inline Value *share_value(Value *value) {
+  if (is_heap_value(value) && !value->is_shared) value->is_shared = true;
+
+  return value;
+}
+
+
+static inline ValueType get_value_type(Value *value) {
+  uintptr_t bits = (uintptr_t) value;
+
+  if (bits & 0x1u) return ValueTypeIntegerValue;
+  if (bits & 0x2u) return value == NULL_VALUE ? ValueTypeNullValue : ValueTypeBoolValue;
+
+  return value->value_type;
+}
+
+
+// integers out of the immediate range are boxed in an IntegerValue
+static inline long long int get_integer_value(Value *value) {
+  if ((uintptr_t) value & 0x1u) return (long long int) ((intptr_t) value >> 1);
+
+  return ((IntegerValue *) value)->integer_value;
+}
+
+
+static inline bool get_bool_value(Value *value) {
+  return value == TRUE_VALUE;
+}
+
+
+char *flatten_string_value(StringValue *string_value);
+
+
+// every read of the chars of a string goes through here, so a rope is put together first
+static inline char *get_string_chars(StringValue *string_value) {
+  if (string_value->string_value == NULL) return flatten_string_value(string_value);
+
+  return string_value->string_value;
+}
+
+
 
 char *convert_to_string(Value *value);
 
@@ -148,7 +234,25 @@ Value *new_string_value(char *val, size_t length);
 Value *new_string_value_from_literal(StringLiteral *literal);
 
 
-Value *new_function_value(Block *block, char **arguments, size_t argument_count);
+Value *new_string_value_from_buffer(const char *buffer, size_t length);
+
+
+Value *new_char_string_value(char c);
+
+
+Value *new_rope_string_value(StringValue *left_string_value, StringValue *right_string_value);
+
+
+uint64_t get_string_value_hash(StringValue *string_value);
+
+
+void append_to_string_value(StringValue *string_value, const char *buffer, size_t length);
+
+
+void grow_list_value(ListValue *list_value, size_t length);
+
+
+Value *new_function_value(FunctionExpression *function_expression);
 
 
 Value *new_system_function_value(ValueType context_value_type, SystemFunctionCallback *callback);
@@ -166,6 +270,9 @@ Value *new_generator_value(GeneratorValueType generator_value_type, Value *first
 Value *fetch_value_from_generator_value(GeneratorValue *generator_value);
 
 
+Value **get_array_items(Value *value, size_t *length);
+
+
 
 Value *convert_to_generator_value(Value *value);
 
@@ -0,0 +1,441 @@
+#include "vm.h"
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "scope.h"
+#include "value.h"
+#include "gc.h"
+#include "compiler.h"
+#include "evaluator.h"
+#include "system.h"
+#include "module.h"
+#include "memory.h"
+
+#define INITIAL_STACK_CAPACITY 256
+
+// the value is computed before the stack grows, it may allocate and a collection must not see the slot it goes to
+#define VM_PUSH(vm, pushed_value) \
+  do { \
+    Value *_pushed_value = (pushed_value); \
+    if ((vm)->stack_length == (vm)->stack_capacity) vm_grow_stack(vm); \
+    (vm)->stack[(vm)->stack_length++] = _pushed_value; \
+  } while (false)
+
+#define VM_POP(vm) ((vm)->stack[--(vm)->stack_length])
+
+#define VM_PEEK(vm, distance) ((vm)->stack[(vm)->stack_length - 1 - (distance)])
+
+
+VM *new_vm() {
+  VM *vm = memory_allocate(MemorySubsystemCompiler, sizeof(VM));
+
+  vm->stack_length = 0;
+  vm->stack_capacity = INITIAL_STACK_CAPACITY;
+  vm->stack = memory_allocate(MemorySubsystemCompiler, vm->stack_capacity * sizeof(Value *));
+
+  gc_register_root_stack(&vm->stack, &vm->stack_length);
+
+  return vm;
+}
+
+
+void free_vm(VM *vm) {
+  gc_unregister_root_stack(&vm->stack);
+
+  memory_free(vm->stack);
+  memory_free(vm);
+}
+
+
+void vm_grow_stack(VM *vm) {
+  vm->stack_capacity *= 2;
+  vm->stack = memory_reallocate(MemorySubsystemCompiler, vm->stack, vm->stack_capacity * sizeof(Value *));
+}
+
+
+Value *vm_call_function(VM *vm, Scope *scope, FunctionValue *function_value, TupleValue *parameter_values) {
+  // a function of an imported module was made by the evaluator and has no chunk
+  if (function_value->chunk == NULL) return call_function(scope, function_value, parameter_values);
+
+  if (parameter_values->length > function_value->argument_count) return new_null_value();
+
+  Scope *function_scope = new_scope(scope, function_value->block, ScopeTypeFunctionScope);
+
+  Value *variable_value;
+
+  for (size_t i = 0; i < function_value->argument_count; i++) {
+    if (parameter_values->length <= i) {
+      variable_value = new_null_value();
+    }
+    else {
+      variable_value = share_value(parameter_values->items[i]);
+    }
+
+    // the resolver gives the arguments the first slots of the function block
+    scope_declare_slot(function_scope, i, variable_value);
+  }
+
+  Value *result = vm_execute_chunk(vm, function_value->chunk, function_scope);
+
+  // the instructions of the function dropped their temporary roots, keep the result alive for the caller
+  gc_push_root(result);
+  free_scope(function_scope);
+
+  return result;
+}
+
+
+Value *vm_execute_chunk(VM *vm, Chunk *chunk, Scope *scope) {
+  Instruction *instructions = chunk->instructions;
+  size_t ip = 0;
+
+  Scope *chunk_scope = scope;
+  size_t stack_base = vm->stack_length;
+  size_t root_count = gc_save_roots();
+
+  while (true) {
+    Instruction instruction = instructions[ip++];
+
+    // values still in use are on the stack, the temporaries of the previous instruction are not needed anymore
+    gc_restore_roots(root_count);
+
+    switch (GET_OPCODE(instruction)) {
+      case OpCodeEnd: {
+        return scope->return_value;
+      }
+
+      case OpCodeNull: {
+        VM_PUSH(vm, new_null_value());
+        break;
+      }
+
+      case OpCodeConstant: {
+        VM_PUSH(vm, chunk->constants[GET_AX(instruction)]);
+        break;
+      }
+
+      case OpCodePop: {
+        vm->stack_length--;
+        break;
+      }
+
+      case OpCodeDuplicate: {
+        Value *top_value = VM_PEEK(vm, 0);
+
+        VM_PUSH(vm, top_value);
+        break;
+      }
+
+      case OpCodeGetName: {
+        Variable *variable = scope_get_variable(scope, ValueTypeNullValue, chunk->names[GET_B(instruction)]);
+
+        // an operand is not kept, so it is not shared
+        if (variable == NULL) VM_PUSH(vm, new_null_value());
+        else VM_PUSH(vm, GET_A(instruction) ? variable->value : share_value(variable->value));
+        break;
+      }
+
+      case OpCodeAssignName: {
+        char *name = chunk->names[GET_B(instruction)];
+
+        Value *right_value = VM_PEEK(vm, 0);
+        Variable *variable = scope_get_variable(scope, ValueTypeNullValue, name);
+        Value *left_value = variable == NULL ? new_null_value() : variable->value;
+
+        Value *result_value = apply_assign_operation(left_value, right_value, GET_A(instruction));
+
+        scope_set_variable(scope, ValueTypeNullValue, name, result_value, false);
+
+        vm->stack[vm->stack_length - 1] = new_null_value();
+        break;
+      }
+
+      case OpCodeGetSlot: {
+        Variable *variable = scope_get_slot(scope, GET_DEPTH(instruction), GET_B(instruction));
+
+        VM_PUSH(vm, variable == NULL ? new_null_value() : share_value(variable->value));
+        break;
+      }
+
+      case OpCodeUpdateSlot:
+      case OpCodeReadSlot: {
+        Variable *variable = scope_get_slot(scope, GET_DEPTH(instruction), GET_B(instruction));
+
+        VM_PUSH(vm, variable == NULL ? new_null_value() : variable->value);
+        break;
+      }
+
+      case OpCodeSetSlot: {
+        scope_set_slot(scope, GET_DEPTH(instruction), GET_B(instruction), VM_POP(vm));
+
+        VM_PUSH(vm, new_null_value());
+        break;
+      }
+
+      case OpCodeAssignIndex: {
+        Operator operator = GET_A(instruction);
+
+        size_t operand_count = operator == ASSIGN_OP ? 3 : 4;
+
+        Value *right_value = VM_PEEK(vm, 0);
+        Value *left_value = operator == ASSIGN_OP ? NULL : VM_PEEK(vm, 1);
+        Value *index_value = VM_PEEK(vm, operand_count - 2);
+        Value *container_value = VM_PEEK(vm, operand_count - 1);
+
+        Value *result_value = apply_assign_operation(left_value, right_value, operator);
+
+        gc_push_root(result_value);
+
+        apply_index_operation(container_value, index_value, result_value);
+
+        vm->stack_length -= operand_count;
+
+        VM_PUSH(vm, new_null_value());
+        break;
+      }
+
+      case OpCodeMember: {
+        Value *left_value = VM_POP(vm);
+
+        Variable *variable = scope_get_variable(scope, get_value_type(left_value), chunk->names[GET_B(instruction)]);
+
+        if (variable == NULL) {
+          VM_PUSH(vm, new_null_value());
+        }
+        else {
+          variable->value->context_value = left_value;
+
+          VM_PUSH(vm, variable->value);
+        }
+        break;
+      }
+
+      case OpCodeIndex: {
+        Value *result_value;
+
+        result_value = apply_index_operation(VM_PEEK(vm, 1), VM_PEEK(vm, 0), NULL);
+
+        // the container and the index stay on the stack when the result is used for a compound assignment
+        if (!GET_A(instruction)) vm->stack_length -= 2;
+
+        VM_PUSH(vm, result_value);
+        break;
+      }
+
+      case OpCodeInfix: {
+        // the operands stay on the stack, and so rooted, while the result is allocated
+        Value *left_value = VM_PEEK(vm, 1);
+        Value *result_value;
+
+        // b is set for a compound assignment to a slot, whose value was pushed by UPDATE_SLOT
+        if (GET_B(instruction) && apply_in_place_operation(GET_A(instruction), left_value, VM_PEEK(vm, 0))) {
+          result_value = left_value;
+        }
+        else {
+          result_value = apply_infix_operation(GET_A(instruction), left_value, VM_PEEK(vm, 0));
+        }
+
+        vm->stack_length -= 2;
+
+        VM_PUSH(vm, result_value);
+        break;
+      }
+
+      case OpCodePrefix: {
+        Value *result_value = apply_prefix_operation(GET_A(instruction), VM_PEEK(vm, 0));
+
+        vm->stack[vm->stack_length - 1] = result_value;
+        break;
+      }
+
+      case OpCodeBuildTuple:
+      case OpCodeBuildList: {
+        size_t length = GET_AX(instruction) >> 1u;
+        bool has_finished = GET_AX(instruction) & 1u;
+
+        Value **items = memory_allocate_zeroed(MemorySubsystemCompiler, length, sizeof(Value *));
+
+        for (size_t i = 0; i < length; i++) {
+          items[i] = vm->stack[vm->stack_length - length + i];
+        }
+
+        // the items stay on the stack until the array that holds them is allocated
+        Value *array_value;
+
+        if (GET_OPCODE(instruction) == OpCodeBuildTuple) {
+          array_value = new_tuple_value(items, length, has_finished);
+        }
+        else {
+          array_value = new_list_value(items, length, has_finished);
+        }
+
+        vm->stack_length -= length;
+
+        VM_PUSH(vm, array_value);
+        break;
+      }
+
+      case OpCodeCall: {
+        Value *parameter_values = VM_PEEK(vm, 0);
+        Value *identifier_value = VM_PEEK(vm, 1);
+
+        Value *result_value = new_null_value();
+
+        if (get_value_type(parameter_values) == ValueTypeTupleValue) {
+          if (get_value_type(identifier_value) == ValueTypeFunctionValue) {
+            result_value = vm_call_function(vm, scope, (FunctionValue *) identifier_value, (TupleValue *) parameter_values);
+          }
+          else if (get_value_type(identifier_value) == ValueTypeSystemFunctionValue) {
+            result_value = call_system_function(scope, (SystemFunctionValue *) identifier_value, (TupleValue *) parameter_values);
+          }
+        }
+
+        vm->stack_length -= 2;
+
+        VM_PUSH(vm, result_value);
+        break;
+      }
+
+      case OpCodeFunction: {
+        ChunkFunction *chunk_function = &chunk->functions[GET_AX(instruction)];
+        FunctionExpression *function_expression = chunk_function->function_expression;
+
+        FunctionValue *function_value = (FunctionValue *) new_function_value(function_expression);
+        function_value->chunk = chunk_function->chunk;
+
+        VM_PUSH(vm, (Value *) function_value);
+        break;
+      }
+
+      case OpCodeReturn: {
+        scope_set_return_value(scope, VM_POP(vm));
+
+        // leave the blocks and the loop iterators that are still open in this chunk
+        while (scope != chunk_scope) {
+          Scope *inherited_scope = scope->inherited_scope;
+
+          free_scope(scope);
+          scope = inherited_scope;
+        }
+
+        vm->stack_length = stack_base;
+
+        return chunk_scope->return_value;
+      }
+
+      case OpCodeEnterScope: {
+        scope = new_scope(scope, chunk->blocks[GET_AX(instruction)], ScopeTypeNormalScope);
+        break;
+      }
+
+      case OpCodeLeaveScope: {
+        Scope *inherited_scope = scope->inherited_scope;
+
+        free_scope(scope);
+        scope = inherited_scope;
+        break;
+      }
+
+      case OpCodeJump: {
+        ip = GET_AX(instruction);
+        break;
+      }
+
+      case OpCodeJumpIfFalse: {
+        if (!convert_to_bool(VM_POP(vm))) ip = GET_AX(instruction);
+        break;
+      }
+
+      case OpCodeIterator: {
+        Value *value = VM_PEEK(vm, 0);
+
+        if (get_value_type(value) == ValueTypeGeneratorValue) {
+          vm->stack[vm->stack_length - 1] = new_null_value();
+          VM_PUSH(vm, value);
+        }
+        else {
+          VM_PUSH(vm, convert_to_generator_value(value));
+        }
+        break;
+      }
+
+      case OpCodeForIterator: {
+        Value *generator_value = VM_PEEK(vm, 0);
+
+        if (get_value_type(generator_value) != ValueTypeGeneratorValue) {
+          ip = GET_AX(instruction);
+          break;
+        }
+
+        Value *value = fetch_value_from_generator_value((GeneratorValue *) generator_value);
+
+        if (get_value_type(value) == ValueTypeNullValue) {
+          ip = GET_AX(instruction);
+        }
+        else {
+          VM_PUSH(vm, value);
+        }
+        break;
+      }
+
+      case OpCodeRangeIterator: {
+        // a range of anything else is null, which is not iterated
+        if (get_value_type(VM_PEEK(vm, 1)) != ValueTypeIntegerValue || get_value_type(VM_PEEK(vm, 0)) != ValueTypeIntegerValue) {
+          vm->stack[vm->stack_length - 1] = new_null_value();
+          vm->stack[vm->stack_length - 2] = new_null_value();
+        }
+        break;
+      }
+
+      case OpCodeForRange: {
+        Value *index_value = VM_PEEK(vm, 1);
+
+        if (get_value_type(index_value) != ValueTypeIntegerValue) {
+          ip = GET_AX(instruction);
+          break;
+        }
+
+        long long int index = get_integer_value(index_value);
+        long long int end_index = get_integer_value(VM_PEEK(vm, 0));
+
+        if (index == end_index) {
+          ip = GET_AX(instruction);
+          break;
+        }
+
+        vm->stack[vm->stack_length - 2] = new_integer_value(index < end_index ? index + 1 : index - 1);
+
+        VM_PUSH(vm, index_value);
+        break;
+      }
+
+      case OpCodeImport: {
+        Value *path_value = VM_POP(vm);
+
+        if (get_value_type(path_value) == ValueTypeStringValue) {
+          Module *module = import_module(get_string_chars((StringValue *) path_value));
+
+          if (module != NULL) bind_module(scope, module);
+        }
+        break;
+      }
+    }
+  }
+}
+
+
+void execute_chunk(Chunk *chunk) {
+  VM *vm = new_vm();
+  Scope *main_scope = new_scope(NULL, chunk->block, ScopeTypeNormalScope);
+
+  build_main_scope(main_scope);
+  register_main_module(main_scope);
+
+  vm_execute_chunk(vm, chunk, main_scope);
+
+  free_scope(main_scope);
+  free_vm(vm);
+  gc_collect();
+}
@@ -0,0 +1,34 @@
+#ifndef PIELANG_VM_H
+#define PIELANG_VM_H
+
+#include <stdlib.h>
+
+#include "bool.h"
+#include "ast.h"
+#include "scope.h"
+#include "value.h"
+#include "compiler.h"
+
+typedef struct {
+  Value **stack;
+  size_t stack_length;
+  size_t stack_capacity;
+} VM;
+
+
+VM *new_vm();
+
+
+void free_vm(VM *vm);
+
+
+Value *vm_call_function(VM *vm, Scope *scope, FunctionValue *function_value, TupleValue *parameter_values);
+
+
+Value *vm_execute_chunk(VM *vm, Chunk *chunk, Scope *scope);
+
+
+void execute_chunk(Chunk *chunk);
+
+
+#endif //PIELANG_VM_H